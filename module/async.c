@@ -42,6 +42,7 @@
 
 #include "object.h"
 #include "file.h"
+#include "process.h"
 #include "request.h"
 
 #ifdef CONFIG_UNIFIED_KERNEL
@@ -65,6 +66,10 @@ struct async
     async_data_t         data;            /* data for async I/O call */
 #ifdef CONFIG_UNIFIED_KERNEL
     void                *apc;
+    async_buffer_t      *buffers;         /* client buffers if the server does the transfer */
+    unsigned int         nb_buffers;      /* number of client buffers */
+    data_size_t          transferred;     /* bytes transferred so far by the server */
+    client_ptr_t         direct_apc;      /* user APC to queue when the server completes it */
 #endif
 };
 
@@ -147,6 +152,9 @@ static void async_destroy( struct object *obj )
 
     if (async->timeout) remove_timeout_user( async->timeout );
     if (async->event) release_object( async->event );
+#ifdef CONFIG_UNIFIED_KERNEL
+    free( async->buffers );
+#endif
     release_object( async->queue );
     release_object( async->thread );
 }
@@ -172,6 +180,20 @@ void async_terminate( struct async *async, unsigned int status )
 
     assert( status != STATUS_PENDING );
 
+#ifdef CONFIG_UNIFIED_KERNEL
+    /* the client callback would start the transfer over, so once the server
+     * has moved part of the data it finishes the async itself */
+    if (async->transferred && async->status == STATUS_PENDING)
+    {
+        if (status == STATUS_ALERTED) return;  /* the server carries on with it */
+        grab_object( async );
+        async_complete( async, status );
+        async_reselect( async );
+        release_object( async );
+        return;
+    }
+#endif
+
     spin_lock_bh(&async_lock);
     if (async->status != STATUS_PENDING)
     {
@@ -256,6 +278,10 @@ struct async *create_async( struct thread *thread, struct async_queue *queue, co
     async->queue   = (struct async_queue *)grab_object( queue );
 #ifdef CONFIG_UNIFIED_KERNEL
     async->apc     = async_alloc_apc();
+    async->buffers = NULL;
+    async->nb_buffers  = 0;
+    async->transferred = 0;
+    async->direct_apc  = 0;
 #endif
 
     wine_list_add_tail( &queue->queue, &async->queue_entry );
@@ -395,3 +421,128 @@ void async_wake_up( struct async_queue *queue, unsigned int status )
         if (status == STATUS_ALERTED) break;  /* only wake up the first one */
     }
 }
+
+#ifdef CONFIG_UNIFIED_KERNEL
+/* Direct asyncs: the client passes its buffers along with the async, and the
+ * fd moves the data between them and the unix file itself once it is ready,
+ * instead of waking the client up to do it. The I/O status block, completion
+ * port, event and user APC are then updated exactly as they would be after
+ * the client callback has run. */
+
+/* hand the client buffers of an async to the server; the data is the user
+ * APC to queue once the transfer is done, followed by the buffers */
+int async_set_buffers( struct async *async, const void *data, data_size_t size )
+{
+    const async_buffer_t *buffers = (const async_buffer_t *)((const client_ptr_t *)data + 1);
+    unsigned int count;
+    client_ptr_t apc;
+
+    if (size < sizeof(apc)) return 0;
+    memcpy( &apc, data, sizeof(apc) );
+    count = (size - sizeof(apc)) / sizeof(*buffers);
+    if (!count) return 0;
+    if (!(async->buffers = memdup( buffers, count * sizeof(*buffers) ))) return 0;
+    async->nb_buffers = count;
+    async->direct_apc = apc;
+    return 1;
+}
+
+/* get the first async of a queue if it is still pending and the server does its transfer */
+struct async *async_get_direct( struct async_queue *queue )
+{
+    struct list_head *ptr;
+    struct async *async;
+
+    if (!queue || !(ptr = list_head( &queue->queue ))) return NULL;
+    async = LIST_ENTRY( ptr, struct async, queue_entry );
+    if (async->status != STATUS_PENDING || !async->buffers) return NULL;
+    return async;
+}
+
+/* size of the client buffers not transferred yet */
+data_size_t async_direct_remaining( struct async *async )
+{
+    data_size_t total = 0;
+    unsigned int i;
+
+    for (i = 0; i < async->nb_buffers; i++) total += async->buffers[i].size;
+    return total - async->transferred;
+}
+
+/* copy data between a kernel buffer and the client buffers, starting where the
+ * transfer stopped; returns the size copied, short if a client page is bad */
+data_size_t async_direct_copy( struct async *async, void *data, data_size_t size, int write )
+{
+    struct process *process = async->thread->process;
+    data_size_t offset = async->transferred, done = 0, len, ret;
+    unsigned int i;
+
+    for (i = 0; i < async->nb_buffers && done < size; i++)
+    {
+        if (offset >= async->buffers[i].size)
+        {
+            offset -= async->buffers[i].size;
+            continue;
+        }
+        len = async->buffers[i].size - offset;
+        if (len > size - done) len = size - done;
+        ret = copy_async_memory( process, async->buffers[i].ptr + offset, len,
+                                 (char *)data + done, write );
+        done += ret;
+        if (ret < len) break;
+        offset = 0;
+    }
+    return done;
+}
+
+/* account for data transferred by the server; returns the size still remaining */
+data_size_t async_direct_advance( struct async *async, data_size_t size )
+{
+    async->transferred += size;
+    return async_direct_remaining( async );
+}
+
+/* complete an async whose transfer was done by the server */
+void async_complete( struct async *async, unsigned int status )
+{
+    struct process *process = async->thread->process;
+    union
+    {
+        struct { unsigned int status; unsigned int info; } iosb32;
+        struct { unsigned int status; unsigned int pad; unsigned long long info; } iosb64;
+    } iosb;
+
+    assert( status != STATUS_PENDING );
+
+    spin_lock_bh(&async_lock);
+    if (async->status != STATUS_PENDING)
+    {
+        /* terminated in the meantime, the client callback takes over */
+        spin_unlock_bh(&async_lock);
+        return;
+    }
+    async->status = status;
+    spin_unlock_bh(&async_lock);
+
+    memset( &iosb, 0, sizeof(iosb) );
+    if (CPU_FLAG(process->cpu) & CPU_64BIT_MASK)
+    {
+        iosb.iosb64.status = status;
+        iosb.iosb64.info   = async->transferred;
+        copy_async_memory( process, async->data.iosb, sizeof(iosb.iosb64), &iosb, 1 );
+    }
+    else
+    {
+        iosb.iosb32.status = status;
+        iosb.iosb32.info   = async->transferred;
+        copy_async_memory( process, async->data.iosb, sizeof(iosb.iosb32), &iosb, 1 );
+    }
+
+    /* the async I/O APC is never going to be queued */
+    if (async->apc) release_object( async->apc );
+    async->apc = NULL;
+
+    async_set_result( &async->obj, status, async->transferred, async->direct_apc );
+    release_object( async );  /* the reference async_terminate would have dropped */
+}
+#endif
@@ -54,6 +54,7 @@
 struct window_class
 {
     struct list_head     entry;           /* entry in process list */
+    struct window_class *hash_next;       /* next class in the hash chain */
     struct process *process;         /* process owning the class */
     int             count;           /* reference count */
     int             local;           /* local class? */
@@ -66,6 +67,37 @@ struct window_class
     char            extra_bytes[1];  /* extra bytes storage */
 };
 
+#define CLASS_HASH_SIZE 256
+
+/* classes of all processes, hashed by process and atom; within a chain the
+ * classes of a given process and atom are in the same order as in the
+ * process list, so that lookups return the same class as a list walk */
+static struct window_class *class_hash[CLASS_HASH_SIZE];
+
+static inline unsigned int class_hash_index( const struct process *process, atom_t atom )
+{
+    return ((unsigned long)process / sizeof(void *) ^ atom * 31) % CLASS_HASH_SIZE;
+}
+
+/* add a class to the hash table once its atom is known */
+static void hash_class( struct window_class *class )
+{
+    struct window_class **ptr = &class_hash[class_hash_index( class->process, class->atom )];
+
+    /* local classes have priority so we put them first */
+    if (!class->local) while (*ptr) ptr = &(*ptr)->hash_next;
+    class->hash_next = *ptr;
+    *ptr = class;
+}
+
+static void unhash_class( struct window_class *class )
+{
+    struct window_class **ptr = &class_hash[class_hash_index( class->process, class->atom )];
+
+    while (*ptr != class) ptr = &(*ptr)->hash_next;
+    *ptr = class->hash_next;
+}
+
 static struct window_class *create_class( struct process *process, int extra_bytes, int local )
 {
     struct window_class *class;
@@ -87,6 +119,7 @@ static struct window_class *create_class( struct process *process, int extra_byt
 
 static void destroy_class( struct window_class *class )
 {
+    unhash_class( class );
     list_remove( &class->entry );
     release_object( class->process );
     free( class );
@@ -105,12 +138,11 @@ void destroy_process_classes( struct process *process )
 
 static struct window_class *find_class( struct process *process, atom_t atom, mod_handle_t instance )
 {
-    struct list_head *ptr;
+    struct window_class *class;
 
-    LIST_FOR_EACH( ptr, &process->classes )
+    for (class = class_hash[class_hash_index( process, atom )]; class; class = class->hash_next)
     {
-        struct window_class *class = LIST_ENTRY( ptr, struct window_class, entry );
-        if (class->atom != atom) continue;
+        if (class->process != process || class->atom != atom) continue;
         if (!instance || !class->local || class->instance == instance) return class;
     }
     return NULL;
@@ -202,6 +234,7 @@ DECL_HANDLER(create_class)
     class->style      = req->style;
     class->win_extra  = req->win_extra;
     class->client_ptr = req->client_ptr;
+    hash_class( class );
     reply->atom = atom;
 }
 
@@ -272,7 +305,9 @@ DECL_HANDLER(set_class_info)
     {
         if (!grab_global_atom( NULL, req->atom )) return;
         release_global_atom( NULL, class->atom );
+        unhash_class( class );
         class->atom = req->atom;
+        hash_class( class );
     }
     if (req->flags & SET_CLASS_STYLE) class->style = req->style;
     if (req->flags & SET_CLASS_WINEXTRA) class->win_extra = req->win_extra;
@@ -31,11 +31,15 @@
  * The authors can be reached at linux@insigma.com.cn.
  */
 
-/* FIXMEs:
- *  - built-in wait queues used which means:
- *    + threads are awaken FIFO and not LIFO as native does
- *    + "max concurrent active threads" parameter not used
- *    + completion handle is waitable, while native isn't
+/* Waiters are queued LIFO so that the thread that waited last, whose stack and
+ * data are most likely still in the cache, gets the next message. A thread
+ * that dequeues messages counts as active on the port until it comes back to
+ * it, waits on anything else or exits; no more messages are handed out while
+ * the port has as many active threads as its concurrency value.
+ *
+ * FIXMEs:
+ *  - blocking in unix calls doesn't make a thread inactive
+ *  - completion handle is waitable, while native isn't
  */
 
 #include "config.h"
@@ -55,16 +59,20 @@
 #include "handle.h"
 #include "request.h"
 
+#include <linux/cpumask.h>
 
 struct uk_completion
 {
     struct object  obj;
     struct list_head    queue;
     unsigned int   depth;
+    unsigned int   concurrent;  /* max number of active threads */
+    unsigned int   active;      /* threads working on dequeued messages */
 };
 
 static void completion_dump( struct object*, int );
 static struct object_type *completion_get_type( struct object *obj );
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry );
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int completion_map_access( struct object *obj, unsigned int access );
 static void completion_destroy( struct object * );
@@ -74,7 +82,7 @@ static const struct object_ops completion_ops =
     sizeof(struct uk_completion), /* size */
     completion_dump,           /* dump */
     completion_get_type,       /* get_type */
-    add_queue,                 /* add_queue */
+    completion_add_queue,      /* add_queue */
     remove_queue,              /* remove_queue */
     completion_signaled,       /* signaled */
     no_satisfied,              /* satisfied */
@@ -126,11 +134,20 @@ static struct object_type *completion_get_type( struct object *obj )
     return get_object_type( &str );
 }
 
+/* same as add_queue, but at the head of the wait queue */
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    grab_object( obj );
+    entry->obj = obj;
+    wine_list_add_head( &obj->wait_queue, &entry->entry );
+    return 1;
+}
+
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct uk_completion *completion = (struct uk_completion *)obj;
 
-    return !list_empty( &completion->queue );
+    return !list_empty( &completion->queue ) && completion->active < completion->concurrent;
 }
 
 static unsigned int completion_map_access( struct object *obj, unsigned int access )
@@ -152,6 +169,8 @@ static struct uk_completion *create_completion( struct directory *root, const st
         {
             list_init( &completion->queue );
             completion->depth = 0;
+            completion->concurrent = concurrent ? concurrent : num_online_cpus();
+            completion->active = 0;
         }
     }
 
@@ -181,6 +200,25 @@ void add_completion( struct uk_completion *completion, apc_param_t ckey, apc_par
     uk_wake_up( &completion->obj, 1 );
 }
 
+/* the thread is no longer working on messages of its port */
+void completion_thread_idle( struct thread *thread )
+{
+    struct uk_completion *completion = thread->io_completion;
+
+    if (!completion) return;
+    thread->io_completion = NULL;
+    completion->active--;
+    if (!list_empty( &completion->queue )) uk_wake_up( &completion->obj, 1 );
+    release_object( completion );
+}
+
+/* the current thread got messages from a port */
+static void completion_thread_active( struct uk_completion *completion )
+{
+    current_thread->io_completion = (struct uk_completion *)grab_object( completion );
+    completion->active++;
+}
+
 /* create a completion */
 DECL_HANDLER(create_completion)
 {
@@ -247,8 +285,10 @@ DECL_HANDLER(remove_completion)
 
     if (!completion) return;
 
+    completion_thread_idle( current_thread );
+
     entry = list_head( &completion->queue );
-    if (!entry)
+    if (!entry || completion->active >= completion->concurrent)
         set_error( STATUS_PENDING );
     else
     {
@@ -260,6 +300,48 @@ DECL_HANDLER(remove_completion)
         reply->status = msg->status;
         reply->information = msg->information;
         free( msg );
+        completion_thread_active( completion );
+    }
+
+    release_object( completion );
+}
+
+/* get as many completions from completion port as fit in the reply */
+DECL_HANDLER(remove_completions)
+{
+    struct uk_completion* completion = get_completion_obj( current_thread->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+    data_size_t count = get_reply_max_size() / sizeof(completion_msg_t);
+    completion_msg_t *msgs;
+    struct list_head *entry;
+    struct comp_msg *msg;
+    data_size_t i;
+
+    if (!completion) return;
+
+    completion_thread_idle( current_thread );
+
+    if (!completion->depth || completion->active >= completion->concurrent) set_error( STATUS_PENDING );
+    else if (!count) set_error( STATUS_BUFFER_TOO_SMALL );
+    else
+    {
+        if (count > completion->depth) count = completion->depth;
+        if ((msgs = set_reply_data_size( count * sizeof(*msgs) )))
+        {
+            for (i = 0; i < count; i++)
+            {
+                entry = list_head( &completion->queue );
+                list_remove( entry );
+                completion->depth--;
+                msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
+                msgs[i].ckey        = msg->ckey;
+                msgs[i].cvalue      = msg->cvalue;
+                msgs[i].information = msg->information;
+                msgs[i].status      = msg->status;
+                msgs[i].__pad       = 0;
+                free( msg );
+            }
+            completion_thread_active( completion );
+        }
     }
 
     release_object( completion );
@@ -48,11 +48,18 @@
 #include "request.h"
 #include "security.h"
 
+#ifdef CONFIG_UNIFIED_KERNEL
+#include "wine/server.h"  /* for struct __server_sync_slot */
+#endif
+
 struct event
 {
     struct object  obj;             /* object header */
     int            manual_reset;    /* is it a manual reset event? */
     int            signaled;        /* event has been signaled */
+#ifdef CONFIG_UNIFIED_KERNEL
+    struct list_head sync_views;    /* copies of the state in process sync pages */
+#endif
 };
 
 static void event_dump( struct object *obj, int verbose );
@@ -61,6 +68,11 @@ static int event_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int event_map_access( struct object *obj, unsigned int access );
 static int event_signal( struct object *obj, unsigned int access);
+#ifdef CONFIG_UNIFIED_KERNEL
+static void event_destroy( struct object *obj );
+#else
+#define event_destroy no_destroy
+#endif
 
 static const struct object_ops event_ops =
 {
@@ -79,7 +91,7 @@ static const struct object_ops event_ops =
     no_lookup_name,            /* lookup_name */
     no_open_file,              /* open_file */
     no_close_handle,           /* close_handle */
-    no_destroy                 /* destroy */
+    event_destroy              /* destroy */
 };
 
 
@@ -114,6 +126,14 @@ static const struct object_ops keyed_event_ops =
 };
 
 
+static inline void set_event_state( struct event *event, int signaled )
+{
+    event->signaled = signaled;
+#ifdef CONFIG_UNIFIED_KERNEL
+    publish_sync_state( &event->sync_views, signaled ? SERVER_SYNC_SIGNALED : 0 );
+#endif
+}
+
 struct event *create_event( struct directory *root, const struct unicode_str *name,
                             unsigned int attr, int manual_reset, int initial_state,
                             const struct security_descriptor *sd )
@@ -127,6 +147,9 @@ struct event *create_event( struct directory *root, const struct unicode_str *na
             /* initialize it if it didn't already exist */
             event->manual_reset = manual_reset;
             event->signaled     = initial_state;
+#ifdef CONFIG_UNIFIED_KERNEL
+            list_init( &event->sync_views );
+#endif
             if (sd) default_set_sd( &event->obj, sd, OWNER_SECURITY_INFORMATION|
                                                      GROUP_SECURITY_INFORMATION|
                                                      DACL_SECURITY_INFORMATION|
@@ -143,22 +166,22 @@ struct event *get_event_obj( struct process *process, obj_handle_t handle, unsig
 
 void pulse_event( struct event *event )
 {
-    event->signaled = 1;
+    event->signaled = 1;  /* not worth publishing, it's reset right away */
     /* wake up all waiters if manual reset, a single one otherwise */
     uk_wake_up( &event->obj, !event->manual_reset );
-    event->signaled = 0;
+    set_event_state( event, 0 );
 }
 
 void set_event( struct event *event )
 {
-    event->signaled = 1;
+    set_event_state( event, 1 );
     /* wake up all waiters if manual reset, a single one otherwise */
     uk_wake_up( &event->obj, !event->manual_reset );
 }
 
 void reset_event( struct event *event )
 {
-    event->signaled = 0;
+    set_event_state( event, 0 );
 }
 
 static void event_dump( struct object *obj, int verbose )
@@ -190,7 +213,7 @@ static void event_satisfied( struct object *obj, struct wait_queue_entry *entry
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
     /* Reset if it's an auto-reset event */
-    if (!event->manual_reset) event->signaled = 0;
+    if (!event->manual_reset) set_event_state( event, 0 );
 }
 
 static unsigned int event_map_access( struct object *obj, unsigned int access )
@@ -216,6 +239,27 @@ static int event_signal( struct object *obj, unsigned int access )
     return 1;
 }
 
+#ifdef CONFIG_UNIFIED_KERNEL
+static void event_destroy( struct object *obj )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    free_sync_views( &event->sync_views );
+}
+
+/* return the slot of an event in the sync page of a process;
+ * 0 if the object isn't an event or if no slot is available */
+unsigned int get_event_sync_slot( struct object *obj, struct process *process )
+{
+    struct event *event = (struct event *)obj;
+
+    if (obj->ops != &event_ops) return 0;
+    return get_sync_view( &event->sync_views, process,
+                          event->manual_reset ? SERVER_SYNC_MANUAL_EVENT : SERVER_SYNC_AUTO_EVENT,
+                          event->signaled ? SERVER_SYNC_SIGNALED : 0, 0 );
+}
+#endif
+
 
 struct keyed_event *create_keyed_event( struct directory *root, const struct unicode_str *name,
                                         unsigned int attr, const struct security_descriptor *sd )
@@ -118,6 +118,8 @@
 #include <linux/kthread.h>
 #include <linux/poll.h>
 #include <linux/version.h>
+#include <linux/hrtimer.h>
+#include <linux/workqueue.h>
 
 #define FD_UNINIT 0x1
 #define FD_ADDED  0x2
@@ -149,7 +151,6 @@ struct pid_fd_map
     int   unix_fd;
 };
 
-extern struct task_struct* timer_kernel_task;
 extern void destroy_map_tbl(struct uk_fd *fd);
 extern int get_unix_fd_by_pid(struct uk_fd *fd, pid_t pid);
 extern int find_unix_fd_by_pid(struct uk_fd* fd, pid_t pid);
@@ -421,42 +422,273 @@ struct timeout_user
     timeout_t             when;       /* timeout expiry (absolute time) */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
+#ifdef CONFIG_UNIFIED_KERNEL
+    int                   index;      /* position in timeout_heap, or TIMEOUT_RUNNING */
+#endif
 };
 
-static struct list_head timeout_list = LIST_INIT(timeout_list);   /* sorted timeouts list */
 #ifdef CONFIG_UNIFIED_KERNEL
+/*
+ * Pending timeouts are kept in a binary min-heap ordered by expiry time, so
+ * that adding and removing a timeout is O(log n).  An hrtimer is armed for
+ * the first expiry; it queues timeout_work, which runs the callbacks of the
+ * expired timeouts with uk_lock held.
+ *
+ * Timeouts can be removed from softirq context (socket events waking up
+ * waiting threads), so the heap is protected by timeout_lock, with bottom
+ * halves disabled; see lock ordering in lib.c.
+ */
+
+#define TIMEOUT_RUNNING  -1   /* index of a timeout whose callback is about to run */
+#define TIMEOUT_MAX_ARM  (KTIME_MAX / 100)  /* longest hrtimer delay, in timeout_t units */
+
+static struct timeout_user **timeout_heap;
+static unsigned int timeout_count;      /* number of pending timeouts */
+static unsigned int timeout_alloc;      /* allocated size of timeout_heap */
+static DEFINE_SPINLOCK(timeout_lock);
+static struct hrtimer timeout_timer;
+static int timeouts_stopped;            /* module exit, the timer must stay off */
+
+static int get_next_timeout(void);
+static void timeout_work_func( struct work_struct *work );
+static DECLARE_WORK(timeout_work, timeout_work_func);
+
 static inline void set_current_time(void)
 {
 }
-#else
-timeout_t current_time;
 
-static inline void set_current_time(void)
+static inline void heap_set( unsigned int pos, struct timeout_user *user )
 {
-    static const timeout_t ticks_1601_to_1970 = (timeout_t)86400 * (369 * 365 + 89) * TICKS_PER_SEC;
-    struct timeval now;
-    gettimeofday( &now, NULL );
-    current_time = (timeout_t)now.tv_sec * TICKS_PER_SEC + now.tv_usec * 10 + ticks_1601_to_1970;
+    timeout_heap[pos] = user;
+    user->index = pos;
+}
+
+static void heap_sift_up( unsigned int pos )
+{
+    struct timeout_user *user = timeout_heap[pos];
+
+    while (pos)
+    {
+        unsigned int parent = (pos - 1) / 2;
+        if (timeout_heap[parent]->when <= user->when) break;
+        heap_set( pos, timeout_heap[parent] );
+        pos = parent;
+    }
+    heap_set( pos, user );
+}
+
+static void heap_sift_down( unsigned int pos )
+{
+    struct timeout_user *user = timeout_heap[pos];
+
+    for (;;)
+    {
+        unsigned int child = 2 * pos + 1;
+
+        if (child >= timeout_count) break;
+        if (child + 1 < timeout_count && timeout_heap[child + 1]->when < timeout_heap[child]->when)
+            child++;
+        if (user->when <= timeout_heap[child]->when) break;
+        heap_set( pos, timeout_heap[child] );
+        pos = child;
+    }
+    heap_set( pos, user );
+}
+
+static int heap_insert( struct timeout_user *user )
+{
+    if (timeout_count == timeout_alloc)
+    {
+        unsigned int new_alloc = timeout_alloc ? timeout_alloc * 2 : 64;
+        struct timeout_user **new_heap;
+
+        /* may be called with thread_lock held */
+        if (!(new_heap = malloc_atomic( new_alloc * sizeof(*new_heap) ))) return 0;
+        if (timeout_count) memcpy( new_heap, timeout_heap, timeout_count * sizeof(*new_heap) );
+        free( timeout_heap );
+        timeout_heap = new_heap;
+        timeout_alloc = new_alloc;
+    }
+    heap_set( timeout_count++, user );
+    heap_sift_up( user->index );
+    return 1;
+}
+
+static void heap_remove( struct timeout_user *user )
+{
+    unsigned int pos = user->index;
+    struct timeout_user *last = timeout_heap[--timeout_count];
+
+    user->index = TIMEOUT_RUNNING;
+    if (last == user) return;
+    heap_set( pos, last );
+    if (pos && timeout_heap[(pos - 1) / 2]->when > last->when) heap_sift_up( pos );
+    else heap_sift_down( pos );
+}
+
+/* arm the hrtimer for the first pending timeout; called with timeout_lock held */
+static void arm_timeout_timer(void)
+{
+    timeout_t delta;
+
+    if (!timeout_count || timeouts_stopped)
+    {
+        hrtimer_try_to_cancel( &timeout_timer );
+        return;
+    }
+    delta = timeout_heap[0]->when - current_time;
+    if (delta < 0) delta = 0;
+    /* a far away timeout would overflow the ktime; the timer then simply fires
+     * early, finds nothing expired and is armed again */
+    if (delta > TIMEOUT_MAX_ARM) delta = TIMEOUT_MAX_ARM;
+    hrtimer_start( &timeout_timer, ns_to_ktime( delta * 100 ), HRTIMER_MODE_REL );
+}
+
+static enum hrtimer_restart timeout_timer_func( struct hrtimer *timer )
+{
+    schedule_work( &timeout_work );
+    return HRTIMER_NORESTART;
+}
+
+static void timeout_work_func( struct work_struct *work )
+{
+    uk_lock();
+    get_next_timeout();
+    uk_unlock();
 }
-#endif
 
-#ifdef CONFIG_UNIFIED_KERNEL
 extern struct timeout_user *parse_private( timeout_callback func, void *private);
 struct timeout_user *alloc_timeout_user(void)
 {
     return (struct timeout_user *)mem_alloc( sizeof(struct timeout_user) );
 }
-#endif
 
 /* add a timeout user */
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list_head *ptr;
+    int prealloc = 1;
 
-#ifdef CONFIG_UNIFIED_KERNEL
     if (!(user = parse_private(func, private))) /*only for thread_timeout()*/
-#endif
+    {
+        if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
+        prealloc = 0;
+    }
+    user->when     = (when > 0) ? when : current_time - when;
+    user->callback = func;
+    user->private  = private;
+
+    spin_lock_bh( &timeout_lock );
+    if (!heap_insert( user ))
+    {
+        spin_unlock_bh( &timeout_lock );
+        set_error( STATUS_NO_MEMORY );
+        if (!prealloc) free( user );  /* otherwise freed by the caller */
+        return NULL;
+    }
+    if (!user->index) arm_timeout_timer();
+    spin_unlock_bh( &timeout_lock );
+    return user;
+}
+
+/* remove a timeout user */
+void remove_timeout_user( struct timeout_user *user )
+{
+    int first;
+
+    spin_lock_bh( &timeout_lock );
+    if (user->index == TIMEOUT_RUNNING)
+    {
+        /* already expired, freed once its callback returns */
+        spin_unlock_bh( &timeout_lock );
+        return;
+    }
+    first = !user->index;
+    heap_remove( user );
+    if (first) arm_timeout_timer();
+    spin_unlock_bh( &timeout_lock );
+    free( user );
+}
+
+/* run the expired timeouts and return the time until the next timeout, in
+ * milliseconds; called with uk_lock held */
+static int get_next_timeout(void)
+{
+    struct timeout_user *user;
+    timeout_t now = current_time;
+    int diff = -1;
+
+    for (;;)
+    {
+        spin_lock_bh( &timeout_lock );
+        if (!timeout_count || timeout_heap[0]->when > now) break;
+        user = timeout_heap[0];
+        heap_remove( user );
+        spin_unlock_bh( &timeout_lock );
+
+        user->callback( user->private );
+        free( user );
+    }
+
+    if (timeout_count)
+    {
+        u64 tmp = (timeout_heap[0]->when - now + 9999);
+        do_div(tmp, 10000);
+        diff = (int)min_t( u64, tmp, INT_MAX );
+    }
+    arm_timeout_timer();
+    spin_unlock_bh( &timeout_lock );
+    return diff;
+}
+
+void init_timeouts(void)
+{
+    hrtimer_init( &timeout_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL );
+    timeout_timer.function = timeout_timer_func;
+}
+
+/* stop running timeouts at module exit; they can still be added and removed */
+void stop_timeouts(void)
+{
+    spin_lock_bh( &timeout_lock );
+    timeouts_stopped = 1;
+    spin_unlock_bh( &timeout_lock );
+    hrtimer_cancel( &timeout_timer );
+    cancel_work_sync( &timeout_work );
+    hrtimer_cancel( &timeout_timer );  /* the work may have armed it before it was stopped */
+}
+
+/* free the pending timeouts; runs last at module exit, since tearing down
+ * the other objects can still remove timeouts */
+void release_timeouts(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < timeout_count; i++) free( timeout_heap[i] );
+    free( timeout_heap );
+    timeout_heap = NULL;
+    timeout_count = timeout_alloc = 0;
+}
+
+#else /* CONFIG_UNIFIED_KERNEL */
+
+static struct list_head timeout_list = LIST_INIT(timeout_list);   /* sorted timeouts list */
+timeout_t current_time;
+
+static inline void set_current_time(void)
+{
+    static const timeout_t ticks_1601_to_1970 = (timeout_t)86400 * (369 * 365 + 89) * TICKS_PER_SEC;
+    struct timeval now;
+    gettimeofday( &now, NULL );
+    current_time = (timeout_t)now.tv_sec * TICKS_PER_SEC + now.tv_usec * 10 + ticks_1601_to_1970;
+}
+
+/* add a timeout user */
+struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
+{
+    struct timeout_user *user;
+    struct list_head *ptr;
+
     if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
     user->when     = (when > 0) ? when : current_time - when;
     user->callback = func;
@@ -470,9 +702,6 @@ struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, vo
         if (timeout->when >= user->when) break;
     }
     wine_list_add_before( ptr, &user->entry );
-#ifdef CONFIG_UNIFIED_KERNEL
-    wake_up_process(timer_kernel_task);
-#endif
     return user;
 }
 
@@ -482,6 +711,7 @@ void remove_timeout_user( struct timeout_user *user )
     list_remove( &user->entry );
     free( user );
 }
+#endif /* CONFIG_UNIFIED_KERNEL */
 
 /* return a text description of a timeout for debugging purposes */
 const char *get_timeout_str( timeout_t timeout )
@@ -1144,32 +1374,7 @@ static void remove_poll_user( struct uk_fd *fd, int user )
     active_users--;
 }
 
-#ifdef CONFIG_UNIFIED_KERNEL
-int timer_loop(void *data)
-{
-    unsigned int msecs, timeout, next;
-
-    while (1)
-    {
-        uk_lock();
-        next = get_next_timeout();
-        uk_unlock();
-        if (kthread_should_stop())
-        {
-            return 0;
-        }
-
-        msecs = (next==-1) ? 10000 : next;
-        timeout = msecs_to_jiffies(msecs) + 1;
-
-        set_current_state(TASK_INTERRUPTIBLE);
-        schedule_timeout(timeout);
-    }
-
-    return 0;
-}
-#endif
-
+#ifndef CONFIG_UNIFIED_KERNEL
 /* process pending timeouts and return the time until the next timeout, in milliseconds */
 static int get_next_timeout(void)
 {
@@ -1205,20 +1410,14 @@ static int get_next_timeout(void)
         if ((ptr = list_head( &timeout_list )) != NULL)
         {
             struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-#ifndef CONFIG_UNIFIED_KERNEL
             int diff = (timeout->when - current_time + 9999) / 10000;
-#else
-            int diff = 0;
-            u64 tmp = (timeout->when - current_time + 9999);
-            do_div(tmp, 10000);
-            diff = (int)tmp;
-#endif
             if (diff < 0) diff = 0;
             return diff;
         }
     }
     return -1;  /* no pending timeouts */
 }
+#endif
 
 /* server main poll() loop */
 void main_loop(void)
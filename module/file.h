@@ -158,6 +158,7 @@ extern struct dir *get_dir_obj( struct process *process, obj_handle_t handle, un
 extern struct uk_completion *get_completion_obj( struct process *process, obj_handle_t handle, unsigned int access );
 extern void add_completion( struct uk_completion *completion, apc_param_t ckey, apc_param_t cvalue,
                             unsigned int status, apc_param_t information );
+extern void completion_thread_idle( struct thread *thread );
 
 /* serial port functions */
 
@@ -178,6 +179,14 @@ extern void async_terminate( struct async *async, unsigned int status );
 extern int async_wake_up_by( struct async_queue *queue, struct process *process,
                              struct thread *thread, client_ptr_t iosb, unsigned int status );
 extern void async_wake_up( struct async_queue *queue, unsigned int status );
+#ifdef CONFIG_UNIFIED_KERNEL
+extern int async_set_buffers( struct async *async, const void *data, data_size_t size );
+extern struct async *async_get_direct( struct async_queue *queue );
+extern data_size_t async_direct_remaining( struct async *async );
+extern data_size_t async_direct_copy( struct async *async, void *data, data_size_t size, int write );
+extern data_size_t async_direct_advance( struct async *async, data_size_t size );
+extern void async_complete( struct async *async, unsigned int status );
+#endif
 extern struct uk_completion *fd_get_completion( struct uk_fd *fd, apc_param_t *p_key );
 extern void fd_copy_completion( struct uk_fd *src, struct uk_fd *dst );
 
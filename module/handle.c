@@ -54,7 +54,7 @@
 struct handle_entry
 {
     struct object *ptr;       /* object */
-    unsigned int   access;    /* access rights */
+    unsigned int   access;    /* access rights, or next free entry if ptr is NULL */
 };
 
 struct handle_table
@@ -63,8 +63,10 @@ struct handle_table
     struct process      *process;     /* process owning this table */
     int                  count;       /* number of allocated entries */
     int                  last;        /* last used entry */
-    int                  free;        /* first entry that may be free */
-    struct handle_entry *entries;     /* handle entries */
+    int                  top;         /* entries from this one on have never been used */
+    int                  free;        /* head of the free entry list, or -1 */
+    int                  dir_size;    /* size of the page directory */
+    struct handle_entry **pages;      /* page directory; pages never move once allocated */
 };
 
 static struct handle_table *global_table;
@@ -78,6 +80,15 @@ static struct handle_table *global_table;
 #define MIN_HANDLE_ENTRIES  32
 #define MAX_HANDLE_ENTRIES  0x00ffffff
 
+#define HANDLE_PAGE_SHIFT   6
+#define HANDLE_PAGE_ENTRIES (1 << HANDLE_PAGE_SHIFT)
+
+/* entries live in fixed-size pages so that growing the table never moves them */
+static inline struct handle_entry *get_entry( const struct handle_table *table, int index )
+{
+    return &table->pages[index >> HANDLE_PAGE_SHIFT][index & (HANDLE_PAGE_ENTRIES - 1)];
+}
+
 
 /* handle to table index conversion */
 
@@ -145,9 +156,9 @@ static void handle_table_dump( struct object *obj, int verbose )
     fprintf( stderr, "Handle table last=%d count=%d process=%p\n",
              table->last, table->count, table->process );
     if (!verbose) return;
-    entry = table->entries;
-    for (i = 0; i <= table->last; i++, entry++)
+    for (i = 0; i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         fprintf( stderr, "    %04x: %p %08x ",
                  index_to_handle(i), entry->ptr, entry->access );
@@ -167,20 +178,23 @@ static void handle_table_destroy( struct object *obj )
     /* first notify all objects that handles are being closed */
     if (table->process)
     {
-        for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+        for (i = 0; i <= table->last; i++)
         {
-            struct object *obj = entry->ptr;
+            struct object *obj = get_entry( table, i )->ptr;
             if (obj) obj->ops->close_handle( obj, table->process, index_to_handle(i) );
         }
     }
 
-    for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+    for (i = 0; i <= table->last; i++)
     {
-        struct object *obj = entry->ptr;
+        struct object *obj;
+        entry = get_entry( table, i );
+        obj = entry->ptr;
         entry->ptr = NULL;
         if (obj) release_object( obj );
     }
-    free( table->entries );
+    for (i = 0; i < table->count >> HANDLE_PAGE_SHIFT; i++) free( table->pages[i] );
+    free( table->pages );
 }
 
 /* close all the process handles and free the handle table */
@@ -192,6 +206,47 @@ void close_process_handles( struct process *process )
     if (table) release_object( table );
 }
 
+/* add pages to a handle table until it holds at least count entries */
+static int grow_handle_table( struct handle_table *table, int count )
+{
+    int pages = (count + HANDLE_PAGE_ENTRIES - 1) >> HANDLE_PAGE_SHIFT;
+    int i = table->count >> HANDLE_PAGE_SHIFT;
+
+    if (pages > table->dir_size)
+    {
+        /* only the directory is reallocated, the entries themselves stay put */
+        int size = max( table->dir_size * 2, pages );
+        struct handle_entry **dir;
+
+        if (!(dir = malloc( size * sizeof(*dir) ))) return 0;
+        if (i) memcpy( dir, table->pages, i * sizeof(*dir) );
+        free( table->pages );
+        table->pages    = dir;
+        table->dir_size = size;
+    }
+    for ( ; i < pages; i++)
+    {
+        if (!(table->pages[i] = malloc( HANDLE_PAGE_ENTRIES * sizeof(struct handle_entry) ))) return 0;
+        table->count += HANDLE_PAGE_ENTRIES;
+    }
+    return 1;
+}
+
+/* rebuild the free list so that the lowest free entries get reused first */
+static void rebuild_free_list( struct handle_table *table )
+{
+    int i;
+
+    table->free = -1;
+    for (i = table->top - 1; i >= 0; i--)
+    {
+        struct handle_entry *entry = get_entry( table, i );
+        if (entry->ptr) continue;
+        entry->access = table->free;
+        table->free = i;
+    }
+}
+
 /* allocate a new handle table */
 struct handle_table *alloc_handle_table( struct process *process, int count )
 {
@@ -200,47 +255,43 @@ struct handle_table *alloc_handle_table( struct process *process, int count )
     if (count < MIN_HANDLE_ENTRIES) count = MIN_HANDLE_ENTRIES;
     if (!(table = alloc_object( &handle_table_ops )))
         return NULL;
-    table->process = process;
-    table->count   = count;
-    table->last    = -1;
-    table->free    = 0;
-    if ((table->entries = mem_alloc( count * sizeof(*table->entries) ))) return table;
+    table->process  = process;
+    table->count    = 0;
+    table->last     = -1;
+    table->top      = 0;
+    table->free     = -1;
+    table->dir_size = 0;
+    table->pages    = NULL;
+    if (grow_handle_table( table, count )) return table;
+    set_error( STATUS_NO_MEMORY );
     release_object( table );
     return NULL;
 }
 
-/* grow a handle table */
-static int grow_handle_table( struct handle_table *table )
-{
-    struct handle_entry *new_entries;
-    int count = min( table->count * 2, MAX_HANDLE_ENTRIES );
-
-    if (count == table->count ||
-        !(new_entries = realloc( table->entries, count * sizeof(struct handle_entry) )))
-    {
-        set_error( STATUS_INSUFFICIENT_RESOURCES );
-        return 0;
-    }
-    table->entries = new_entries;
-    table->count   = count;
-    return 1;
-}
-
-/* allocate the first free entry in the handle table */
+/* allocate a free entry in the handle table */
 static obj_handle_t alloc_entry( struct handle_table *table, void *obj, unsigned int access )
 {
-    struct handle_entry *entry = table->entries + table->free;
+    struct handle_entry *entry;
     int i;
 
-    for (i = table->free; i <= table->last; i++, entry++) if (!entry->ptr) goto found;
-    if (i >= table->count)
+    if (table->free != -1)
     {
-        if (!grow_handle_table( table )) return 0;
-        entry = table->entries + i;  /* the entries may have moved */
+        i = table->free;
+        entry = get_entry( table, i );
+        table->free = entry->access;
     }
-    table->last = i;
- found:
-    table->free = i + 1;
+    else
+    {
+        if (table->top >= MAX_HANDLE_ENTRIES ||
+            (table->top >= table->count && !grow_handle_table( table, table->count * 2 )))
+        {
+            set_error( STATUS_INSUFFICIENT_RESOURCES );
+            return 0;
+        }
+        i = table->top++;
+        entry = get_entry( table, i );
+    }
+    if (i > table->last) table->last = i;
     entry->ptr    = grab_object( obj );
     entry->access = access;
     return index_to_handle(i);
@@ -320,7 +371,7 @@ static struct handle_entry *get_handle( struct process *process, obj_handle_t ha
     index = handle_to_index( handle );
     if (index < 0) return NULL;
     if (index > table->last) return NULL;
-    entry = table->entries + index;
+    entry = get_entry( table, index );
     if (!entry->ptr) return NULL;
     return entry;
 }
@@ -328,22 +379,19 @@ static struct handle_entry *get_handle( struct process *process, obj_handle_t ha
 /* attempt to shrink a table */
 static void shrink_handle_table( struct handle_table *table )
 {
-    struct handle_entry *entry = table->entries + table->last;
-    struct handle_entry *new_entries;
-    int count = table->count;
+    int i, count = table->count;
+
+    while (table->last >= 0 && !get_entry( table, table->last )->ptr) table->last--;
 
-    while (table->last >= 0)
-    {
-        if (entry->ptr) break;
-        table->last--;
-        entry--;
-    }
     if (table->last >= count / 4) return;  /* no need to shrink */
-    if (count < MIN_HANDLE_ENTRIES * 2) return;  /* too small to shrink */
-    count /= 2;
-    if (!(new_entries = realloc( table->entries, count * sizeof(*new_entries) ))) return;
-    table->count   = count;
-    table->entries = new_entries;
+    if (count < max( MIN_HANDLE_ENTRIES, HANDLE_PAGE_ENTRIES ) * 2) return;  /* too small to shrink */
+    count = ((count / 2 + HANDLE_PAGE_ENTRIES - 1) >> HANDLE_PAGE_SHIFT) << HANDLE_PAGE_SHIFT;
+    for (i = count >> HANDLE_PAGE_SHIFT; i < table->count >> HANDLE_PAGE_SHIFT; i++)
+        free( table->pages[i] );
+    table->count = count;
+    if (table->top > count) table->top = count;
+    /* the free list may point into the released pages */
+    rebuild_free_list( table );
 }
 
 /* copy the handle table of the parent process */
@@ -357,20 +405,20 @@ struct handle_table *copy_handle_table( struct process *process, struct process
     assert( parent_table );
     assert( parent_table->obj.ops == &handle_table_ops );
 
-    if (!(table = alloc_handle_table( process, parent_table->count )))
+    if (!(table = alloc_handle_table( process, parent_table->last + 1 )))
         return NULL;
 
-    if ((table->last = parent_table->last) >= 0)
+    for (i = 0; i <= parent_table->last; i++)
     {
-        struct handle_entry *ptr = table->entries;
-        memcpy( ptr, parent_table->entries, (table->last + 1) * sizeof(struct handle_entry) );
-        for (i = 0; i <= table->last; i++, ptr++)
-        {
-            if (!ptr->ptr) continue;
-            if (ptr->access & RESERVED_INHERIT) grab_object( ptr->ptr );
-            else ptr->ptr = NULL; /* don't inherit this entry */
-        }
+        struct handle_entry *ptr = get_entry( table, i );
+        *ptr = *get_entry( parent_table, i );
+        if (!ptr->ptr) continue;
+        if (ptr->access & RESERVED_INHERIT) grab_object( ptr->ptr );
+        else ptr->ptr = NULL; /* don't inherit this entry */
     }
+    table->last = parent_table->last;
+    table->top  = parent_table->last + 1;
+    rebuild_free_list( table );
     /* attempt to shrink the table */
     shrink_handle_table( table );
     return table;
@@ -382,15 +430,18 @@ unsigned int close_handle( struct process *process, obj_handle_t handle )
     struct handle_table *table;
     struct handle_entry *entry;
     struct object *obj;
+    int index;
 
     if (!(entry = get_handle( process, handle ))) return STATUS_INVALID_HANDLE;
     if (entry->access & RESERVED_CLOSE_PROTECT) return STATUS_HANDLE_NOT_CLOSABLE;
     obj = entry->ptr;
     if (!obj->ops->close_handle( obj, process, handle )) return STATUS_HANDLE_NOT_CLOSABLE;
-    entry->ptr = NULL;
     table = handle_is_global(handle) ? global_table : process->handles;
-    if (entry < table->entries + table->free) table->free = entry - table->entries;
-    if (entry == table->entries + table->last) shrink_handle_table( table );
+    index = handle_to_index( handle_is_global(handle) ? handle_global_to_local(handle) : handle );
+    entry->ptr    = NULL;
+    entry->access = table->free;
+    table->free   = index;
+    if (index == table->last) shrink_handle_table( table );
     release_object( obj );
     return STATUS_SUCCESS;
 }
@@ -464,8 +515,9 @@ obj_handle_t find_inherited_handle( struct process *process, const struct object
 
     if (!table) return 0;
 
-    for (i = 0, ptr = table->entries; i <= table->last; i++, ptr++)
+    for (i = 0; i <= table->last; i++)
     {
+        ptr = get_entry( table, i );
         if (!ptr->ptr) continue;
         if (ptr->ptr->ops != ops) continue;
         if (ptr->access & RESERVED_INHERIT) return index_to_handle(i);
@@ -484,8 +536,9 @@ obj_handle_t enumerate_handles( struct process *process, const struct object_ops
 
     if (!table) return 0;
 
-    for (i = *index, entry = &table->entries[i]; i <= table->last; i++, entry++)
+    for (i = *index; (int)i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         if (entry->ptr->ops != ops) continue;
         *index = i + 1;
@@ -328,6 +328,8 @@ extern void *syscall_array[UK_NR_SYSCALLS];
 extern void init_uk_lock(void);
 extern void uk_lock(void);
 extern void uk_unlock(void);
+extern void uk_lock_shared(void);
+extern void uk_unlock_shared(void);
 
 typedef struct recursive_spinlock
 {
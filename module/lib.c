@@ -23,6 +23,7 @@
 #include <linux/slab.h>
 #include <linux/module.h>
 #include <linux/spinlock.h>
+#include <linux/rwsem.h>
 #include <linux/cred.h> /* for getuid() */
 #include <linux/file.h>
 #include <linux/fdtable.h>
@@ -233,6 +234,7 @@ void* get_kernel_proc_address(char *funcname)
 
 #ifdef MEM_LEAK_CHECK
 static LIST_HEAD(mem_leak_list);
+static DEFINE_SPINLOCK(mem_leak_lock);  /* shared requests allocate concurrently */
 
 #define NAME_LEN 32
 struct mem_leak
@@ -260,6 +262,7 @@ char *strrchr(const char *s, int c)
 void add_to_list(gfp_t flags, void *ptr, size_t size, const char *func, const char *filename, int line)
 {
     char *p;
+    unsigned long irqflags;
     struct mem_leak *mem_leak = kzalloc(sizeof(struct mem_leak), flags);
     if(!mem_leak)
     {
@@ -275,14 +278,18 @@ void add_to_list(gfp_t flags, void *ptr, size_t size, const char *func, const ch
     p = strrchr(filename, '/');
     strcpy(mem_leak->filename,p+1);
 
+    spin_lock_irqsave(&mem_leak_lock, irqflags);
     list_add(&mem_leak->entry, &mem_leak_list);
+    spin_unlock_irqrestore(&mem_leak_lock, irqflags);
 }
 
 void remove_from_list(void *ptr)
 {
     struct mem_leak *mem_leak = NULL;
     struct list_head *pos = NULL, *pos1 = NULL;
+    unsigned long irqflags;
 
+    spin_lock_irqsave(&mem_leak_lock, irqflags);
     LIST_FOR_EACH_SAFE(pos, pos1, &mem_leak_list)
     {
         mem_leak = (struct mem_leak *)pos;
@@ -293,6 +300,7 @@ void remove_from_list(void *ptr)
             kfree(mem_leak);
         }
     }
+    spin_unlock_irqrestore(&mem_leak_lock, irqflags);
 }
 
 void print_mem_list(void)
@@ -301,7 +309,9 @@ void print_mem_list(void)
     struct mem_leak *mem_leak = NULL;
     struct list_head *pos = NULL;
     struct list_head *pos1 = NULL;
+    unsigned long irqflags;
 
+    spin_lock_irqsave(&mem_leak_lock, irqflags);
     LIST_FOR_EACH_SAFE(pos, pos1, &mem_leak_list)
     {
         mem_leak = (struct mem_leak *)pos;
@@ -313,6 +323,7 @@ void print_mem_list(void)
         list_del(&mem_leak->entry);
         kfree((void*)mem_leak);
     }
+    spin_unlock_irqrestore(&mem_leak_lock, irqflags);
     printk("total %08lx\n",total);
 }
 
@@ -884,6 +895,59 @@ char *fgets(char* buf, int len, FILE *fp) /* for registry.c */
     return buf;
 }
 
+size_t fread(void *buf, size_t size, size_t nmemb, FILE *fp)
+{
+    struct file *filp;
+    size_t len = size * nmemb, done = 0;
+    ssize_t nread;
+
+    if (!len)
+        return 0;
+
+    filp = fp->filp;
+    while (done < len)
+    {
+        nread = kernel_read(filp, filp->f_pos, (char *)buf + done, len - done);
+        if (nread <= 0)
+            break;
+        filp->f_pos += nread;
+        done += nread;
+    }
+
+    return done / size;
+}
+
+int fseek(FILE *fp, long offset, int whence)
+{
+    struct file *filp = fp->filp;
+    loff_t pos;
+
+    switch (whence)
+    {
+        case SEEK_SET:
+            pos = offset;
+            break;
+        case SEEK_CUR:
+            pos = filp->f_pos + offset;
+            break;
+        case SEEK_END:
+            pos = i_size_read(file_inode(filp)) + offset;
+            break;
+        default:
+            return -1;
+    }
+    if (pos < 0)
+        return -1;
+
+    filp->f_pos = pos;
+    return 0;
+}
+
+long ftell(FILE *fp)
+{
+    return fp->filp->f_pos;
+}
+
 int vfprintf(FILE* fp, const char* fmt, va_list args)
 {
     klog(0,"NOT IMPLEMENT!\n");
@@ -3570,29 +3634,70 @@ int tcflush(int fd, int queue_selector)
 
 /* uk_lock / uk_unlock*/
 
-static struct semaphore uk_sem;
+/*
+ * Lock ordering
+ *
+ * Locks must be taken in the order below (outermost first); never acquire a
+ * lock while holding one that appears after it in this list.
+ *
+ *   uk_rwsem           server state lock (rw_semaphore, may sleep).
+ *                      Held for writing by every request that modifies
+ *                      objects, handle tables, the registry, window/user
+ *                      handles or wait queues, by timeout callbacks and by
+ *                      the registry saver.  Held for reading by the
+ *                      read-mostly requests listed in request.c
+ *                      (req_is_shared), which therefore only look up
+ *                      handles and read object state; the only shared
+ *                      state they write are object reference counts, which
+ *                      are updated atomically in grab_object/release_object.
+ *                      Errors go to the calling thread (set_error), and
+ *                      tracing (debug_level) forces the exclusive lock.
+ *   thread_lock        thread wait/wakeup state (thread.c, recursive, bh)
+ *   thread_hash_lock   unix pid -> thread lookup (thread.c, rwlock)
+ *   timeout_lock       pending timeout heap (fd.c, spinlock, bh)
+ *   mem_leak_lock      MEM_LEAK_CHECK allocation list (lib.c, spinlock, irq)
+ *
+ * thread_hash_lock, timeout_lock and mem_leak_lock are leaf locks: no other
+ * lock and no sleeping function may be used while they are held.
+ */
+
+static struct rw_semaphore uk_rwsem;
 
 struct uk_lock_operations
 {
     void (*lock)(void);
     void (*unlock)(void);
+    void (*lock_shared)(void);
+    void (*unlock_shared)(void);
 };
 
 static struct uk_lock_operations *uk_lock_ops;
 
 void biglock_lock(void)
 {
-    down(&uk_sem);
+    down_write(&uk_rwsem);
 }
 
 void biglock_unlock(void)
 {
-    up(&uk_sem);
+    up_write(&uk_rwsem);
+}
+
+void biglock_lock_shared(void)
+{
+    down_read(&uk_rwsem);
+}
+
+void biglock_unlock_shared(void)
+{
+    up_read(&uk_rwsem);
 }
 
 static struct uk_lock_operations uk_biglock_ops = {
     .lock = biglock_lock,
     .unlock = biglock_unlock,
+    .lock_shared = biglock_lock_shared,
+    .unlock_shared = biglock_unlock_shared,
 };
 
 void dummy_lock(void)
@@ -3606,12 +3711,14 @@ void dummy_unlock(void)
 static struct uk_lock_operations uk_nolock_ops = {
     .lock = dummy_lock,
     .unlock = dummy_unlock,
+    .lock_shared = dummy_lock,
+    .unlock_shared = dummy_unlock,
 };
 
 
 void init_uk_lock(void)
 {
-    sema_init(&uk_sem, 1);
+    init_rwsem(&uk_rwsem);
 
     if (nr_cpu_ids == 1)
     {
@@ -3634,6 +3741,16 @@ void uk_unlock(void)
     uk_lock_ops->unlock();
 }
 
+void uk_lock_shared(void)
+{
+    uk_lock_ops->lock_shared();
+}
+
+void uk_unlock_shared(void)
+{
+    uk_lock_ops->unlock_shared();
+}
+
 
 extern struct file *get_unix_file( struct uk_fd *fd );
 int uk_sock_error( struct uk_fd *fd )
@@ -3700,6 +3817,41 @@ int check_fin( struct uk_fd *fd )
     return 0;
 }
 
+/* non-blocking recv on the socket of a fd, returns the size or a negative errno */
+int uk_sock_recv( struct uk_fd *fd, void *buf, size_t size )
+{
+    struct file *file;
+    struct socket *sock;
+    struct msghdr msg;
+    struct kvec iov;
+
+    if (!(file = get_unix_file(fd))) return -EBADF;
+    if (!(sock = file->private_data)) return -ENOTSOCK;
+
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = buf;
+    iov.iov_len = size;
+    return kernel_recvmsg(sock, &msg, &iov, 1, size, MSG_DONTWAIT);
+}
+
+/* non-blocking send on the socket of a fd, returns the size or a negative errno */
+int uk_sock_send( struct uk_fd *fd, const void *buf, size_t size )
+{
+    struct file *file;
+    struct socket *sock;
+    struct msghdr msg;
+    struct kvec iov;
+
+    if (!(file = get_unix_file(fd))) return -EBADF;
+    if (!(sock = file->private_data)) return -ENOTSOCK;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+    iov.iov_base = (void *)buf;
+    iov.iov_len = size;
+    return kernel_sendmsg(sock, &msg, &iov, 1, size);
+}
+
 
 /* recursive spin_lock */
 
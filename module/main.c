@@ -170,12 +170,17 @@ extern void init_thread_hash_table(void);
 extern int create_syscall_chardev(void);
 extern void destroy_syscall_chardev(void);
 extern void get_kallsyms_lookup_name(void);
-extern int timer_loop(void*);
+extern void init_timeouts(void);
+extern void stop_timeouts(void);
+extern void release_timeouts(void);
 extern void destroy_reg_name( void );
+extern void release_registry_saver(void);
 extern void register_pe_binfmt(void);
 extern void unregister_pe_binfmt(void);
-
-struct task_struct* timer_kernel_task = NULL;
+extern void release_pipe_flushes(void);
+extern void release_region_cache(void);
+extern void init_sock_work(void);
+extern void release_sock_work(void);
 
 /* module entry*/
 static int __init unifiedkernel_init(void)
@@ -183,16 +188,14 @@ static int __init unifiedkernel_init(void)
     server_start_time = current_time;
     get_kallsyms_lookup_name();
     init_thread_hash_table();
+    init_req_stats();
+    init_req_buffers();
     create_syscall_chardev();
     init_directories();
     init_uk_lock();
     register_pe_binfmt();
-
-    timer_kernel_task = kthread_run(timer_loop, NULL, "timer_thread");
-    if(IS_ERR(timer_kernel_task))
-    {
-        klog(0, "create timer_thread failed \n");
-    }
+    init_timeouts();
+    init_sock_work();
 
     return 0;
 }
@@ -200,13 +203,20 @@ static int __init unifiedkernel_init(void)
 static void __exit unifiedkernel_exit(void)
 {
     destroy_syscall_chardev();
+    release_req_stats();
     unregister_pe_binfmt();
-    kthread_stop(timer_kernel_task);
+    release_sock_work();
+    stop_timeouts();
+    release_pipe_flushes();
     flush_registry();
+    release_registry_saver();
 #ifdef DEBUG_OBJECTS
     close_objects();  /* shut down everything properly */
 #endif
+    release_req_buffers();
+    release_region_cache();
     destroy_reg_name();
+    release_timeouts();
 #ifdef MEM_LEAK_CHECK
     void print_mem_list(void);
     print_mem_list();
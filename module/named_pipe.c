@@ -65,6 +65,12 @@
 #include "thread.h"
 #include "request.h"
 
+#ifdef CONFIG_UNIFIED_KERNEL
+#include <linux/poll.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+#endif
+
 enum pipe_state
 {
     ps_idle_server,
@@ -76,6 +82,7 @@ enum pipe_state
 };
 
 struct named_pipe;
+struct pipe_flush;
 
 struct pipe_server
 {
@@ -86,7 +93,11 @@ struct pipe_server
     enum pipe_state      state;      /* server state */
     struct pipe_client  *client;     /* client that this server is connected to */
     struct named_pipe   *pipe;
+#ifdef CONFIG_UNIFIED_KERNEL
+    struct pipe_flush   *flush;      /* pending flush, waiting for the client to read */
+#else
     struct timeout_user *flush_poll;
+#endif
     struct event        *event;
     unsigned int         options;    /* pipe options */
 };
@@ -359,6 +370,53 @@ static struct uk_fd *pipe_server_get_fd( struct object *obj )
 }
 
 
+#ifdef CONFIG_UNIFIED_KERNEL
+/* a flush waiting for the client to read everything. The client reading
+ * releases the write space of the server socket, which wakes up its wait
+ * queue, so we sit on that queue and check the pipe from a work item. If
+ * the socket gives us no queue, the work item polls the pipe instead. */
+struct pipe_flush
+{
+    poll_table           pt;       /* used to get on the server socket wait queue */
+    wait_queue_t         wait;     /* entry in the server socket wait queue */
+    wait_queue_head_t   *head;     /* wait queue we are on, NULL if none */
+    struct file         *file;     /* server socket file, holds the wait queue */
+    struct delayed_work  work;     /* checks the pipe with uk_lock held */
+    struct pipe_server  *server;   /* flushing server, NULL once the flush is over */
+    struct list_head     entry;    /* entry in the list of flushes not freed yet */
+    int                  exiting;  /* the module is unloading, release_pipe_flushes frees us */
+};
+
+#define FLUSH_POLL_DELAY (HZ / 10)  /* fallback polling interval */
+
+static struct list_head pipe_flushes = LIST_INIT(pipe_flushes);
+
+/* take a flush off the socket wait queue; no wakeup can queue the work after this */
+static void detach_flush( struct pipe_flush *flush )
+{
+    if (!flush->head) return;
+    remove_wait_queue( flush->head, &flush->wait );
+    flush->head = NULL;
+    fput( flush->file );
+}
+
+static void notify_empty( struct pipe_server *server )
+{
+    if (!server->flush)
+        return;
+    assert( server->state == ps_connected_server );
+    assert( server->event );
+    /* the work item may be queued or running, it frees the flush; we can't
+     * wait for it here since it needs uk_lock */
+    detach_flush( server->flush );
+    server->flush->server = NULL;
+    schedule_delayed_work( &server->flush->work, 0 );
+    server->flush = NULL;
+    set_event( server->event );
+    release_object( server->event );
+    server->event = NULL;
+}
+#else
 static void notify_empty( struct pipe_server *server )
 {
     if (!server->flush_poll)
@@ -371,6 +429,7 @@ static void notify_empty( struct pipe_server *server )
     release_object( server->event );
     server->event = NULL;
 }
+#endif
 
 static void do_disconnect( struct pipe_server *server )
 {
@@ -493,7 +552,7 @@ static void named_pipe_device_destroy( struct object *obj )
     struct named_pipe_device *device = (struct named_pipe_device*)obj;
     assert( obj->ops == &named_pipe_device_ops );
     if (device->fd) release_object( device->fd );
-    free( device->pipes );
+    free_namespace( device->pipes );
 }
 
 static enum server_fd_type named_pipe_device_get_fd_type( struct uk_fd *fd )
@@ -560,6 +619,109 @@ static int pipe_data_remaining( struct pipe_server *server )
 }
 #endif
 
+#ifdef CONFIG_UNIFIED_KERNEL
+static void flush_work_func( struct work_struct *work )
+{
+    struct pipe_flush *flush = container_of( work, struct pipe_flush, work.work );
+
+    uk_lock();
+    if (flush->server && !pipe_data_remaining( flush->server )) notify_empty( flush->server );
+    if (flush->server)
+    {
+        /* nothing will wake us up, check again later */
+        if (!flush->head) schedule_delayed_work( &flush->work, FLUSH_POLL_DELAY );
+    }
+    else if (!flush->exiting && !delayed_work_pending( &flush->work ))
+    {
+        /* otherwise a wakeup that came in while we were running queued us again */
+        list_remove( &flush->entry );
+        free( flush );
+    }
+    uk_unlock();
+}
+
+/* called from the socket wakeup, in atomic context */
+static int flush_wake( wait_queue_t *wait, unsigned mode, int sync, void *key )
+{
+    struct pipe_flush *flush = container_of( wait, struct pipe_flush, wait );
+
+    if (key && !((unsigned long)key & (POLLOUT | POLLWRNORM | POLLERR | POLLHUP))) return 0;
+    schedule_delayed_work( &flush->work, 0 );
+    return 0;
+}
+
+static void flush_queue_proc( struct file *file, wait_queue_head_t *head, poll_table *pt )
+{
+    struct pipe_flush *flush = container_of( pt, struct pipe_flush, pt );
+
+    if (flush->head) return;
+    flush->file = get_file( file );
+    flush->head = head;
+    init_waitqueue_func_entry( &flush->wait, flush_wake );
+    add_wait_queue( head, &flush->wait );
+}
+
+static void pipe_server_flush( struct uk_fd *fd, struct event **event )
+{
+    struct pipe_server *server = get_fd_user( fd );
+    struct pipe_flush *flush;
+    struct file *filp;
+
+    if (!server || server->state != ps_connected_server) return;
+
+    /* FIXME: if multiple threads flush the same pipe,
+              maybe should create a list of processes to notify */
+    if (server->flush) return;
+
+    if (!pipe_data_remaining( server )) return;
+
+    if (!(flush = mem_alloc( sizeof(*flush) ))) return;
+    if (!(server->event = create_event( NULL, NULL, 0, 0, 0, NULL )))
+    {
+        free( flush );
+        return;
+    }
+    flush->head    = NULL;
+    flush->file    = NULL;
+    flush->server  = server;
+    flush->exiting = 0;
+    INIT_DELAYED_WORK( &flush->work, flush_work_func );
+    init_poll_funcptr( &flush->pt, flush_queue_proc );
+    wine_list_add_tail( &pipe_flushes, &flush->entry );
+
+    filp = get_unix_file( server->fd );
+    if (filp && filp->f_op && filp->f_op->poll) filp->f_op->poll( filp, &flush->pt );
+
+    server->flush = flush;
+    *event = server->event;
+
+    /* the client may have read everything before we got on the queue; the
+     * check is done by the work item since the caller still needs the event */
+    if (!flush->head || !pipe_data_remaining( server )) schedule_delayed_work( &flush->work, 0 );
+}
+
+/* wait for the flush work items and free the flushes, at module unload */
+void release_pipe_flushes(void)
+{
+    struct pipe_flush *flush, *next;
+
+    uk_lock();
+    LIST_FOR_EACH_ENTRY( flush, &pipe_flushes, struct pipe_flush, entry )
+    {
+        flush->exiting = 1;
+        detach_flush( flush );
+    }
+    uk_unlock();
+
+    /* the work items no longer touch the list, and nothing can queue them but themselves */
+    LIST_FOR_EACH_ENTRY_SAFE( flush, next, &pipe_flushes, struct pipe_flush, entry )
+    {
+        cancel_delayed_work_sync( &flush->work );
+        list_remove( &flush->entry );
+        free( flush );
+    }
+}
+#else
 static void check_flushed( void *arg )
 {
     struct pipe_server *server = (struct pipe_server*) arg;
@@ -599,6 +761,7 @@ static void pipe_server_flush( struct uk_fd *fd, struct event **event )
         *event = server->event;
     }
 }
+#endif
 
 static void pipe_client_flush( struct uk_fd *fd, struct event **event )
 {
@@ -781,7 +944,11 @@ static struct pipe_server *create_pipe_server( struct named_pipe *pipe, unsigned
     server->fd = NULL;
     server->pipe = pipe;
     server->client = NULL;
+#ifdef CONFIG_UNIFIED_KERNEL
+    server->flush = NULL;
+#else
     server->flush_poll = NULL;
+#endif
     server->options = options;
 
     wine_list_add_head( &pipe->servers, &server->entry );
@@ -55,8 +55,11 @@
 struct object_name
 {
     struct list_head         entry;           /* entry in the hash list */
+    struct list_head         order;           /* entry in the namespace enumeration list */
+    struct namespace   *namespace;       /* namespace holding this name */
     struct object      *obj;             /* object owning this name */
     struct object      *parent;          /* parent object */
+    unsigned int        hash;            /* case-folded hash of the name */
     data_size_t         len;             /* name length in bytes */
     WCHAR               name[1];
 };
@@ -64,9 +67,20 @@ struct object_name
 struct namespace
 {
     unsigned int        hash_size;       /* size of hash table */
-    struct list_head         names[1];        /* array of hash entry lists */
+    unsigned int        count;           /* number of names in the namespace */
+    struct list_head   *names;           /* array of hash entry lists */
+    unsigned int        old_size;        /* size of the table being migrated from */
+    unsigned int        migrate_pos;     /* first old bucket not migrated yet */
+    struct list_head   *old_names;       /* table being migrated from, or NULL */
+    struct list_head         order;           /* all names, in enumeration order */
+    struct object_name *cursor;          /* name last returned by find_object_index */
+    unsigned int        cursor_index;    /* index of the cursor name */
 };
 
+#define NAMESPACE_LOAD_FACTOR   2        /* grow when count exceeds this times hash_size */
+#define NAMESPACE_MAX_SIZE      65521    /* don't grow the hash table beyond this */
+#define NAMESPACE_MIGRATE_STEP  8        /* old buckets migrated per insertion/removal */
+
 
 #ifdef DEBUG_OBJECTS
 static struct list_head object_list = LIST_INIT(object_list);
@@ -151,12 +165,83 @@ void *memdup( const void *data, size_t len )
 
 /*****************************************************************/
 
-static int get_name_hash( const struct namespace *namespace, const WCHAR *name, data_size_t len )
+/* case-folding FNV-1a hash of a name */
+static unsigned int get_name_hash( const WCHAR *name, data_size_t len )
 {
-    WCHAR hash = 0;
+    unsigned int hash = 2166136261u;
     len /= sizeof(WCHAR);
-    while (len--) hash ^= tolowerW(*name++);
-    return hash % namespace->hash_size;
+    while (len--)
+    {
+        WCHAR ch = tolowerW(*name++);
+        hash = (hash ^ (ch & 0xff)) * 16777619u;
+        hash = (hash ^ (ch >> 8)) * 16777619u;
+    }
+    return hash;
+}
+
+/* get the bucket holding a given hash; old buckets are used until they have been migrated */
+static struct list_head *get_hash_bucket( const struct namespace *namespace, unsigned int hash )
+{
+    if (namespace->old_names)
+    {
+        unsigned int old = hash % namespace->old_size;
+        if (old >= namespace->migrate_pos) return &namespace->old_names[old];
+    }
+    return &namespace->names[hash % namespace->hash_size];
+}
+
+static struct list_head *alloc_hash_table( unsigned int size )
+{
+    struct list_head *table;
+    unsigned int i;
+
+    if ((table = malloc( size * sizeof(*table) )))
+        for (i = 0; i < size; i++) list_init( &table[i] );
+    return table;
+}
+
+/* move a few buckets of the old table into the new one */
+static void migrate_namespace( struct namespace *namespace )
+{
+    unsigned int end;
+
+    if (!namespace->old_names) return;
+
+    end = min( namespace->migrate_pos + NAMESPACE_MIGRATE_STEP, namespace->old_size );
+    while (namespace->migrate_pos < end)
+    {
+        struct list_head *old = &namespace->old_names[namespace->migrate_pos++];
+        struct object_name *ptr, *next;
+
+        LIST_FOR_EACH_ENTRY_SAFE( ptr, next, old, struct object_name, entry )
+        {
+            list_remove( &ptr->entry );
+            wine_list_add_head( &namespace->names[ptr->hash % namespace->hash_size], &ptr->entry );
+        }
+    }
+    if (namespace->migrate_pos < namespace->old_size) return;
+    free( namespace->old_names );
+    namespace->old_names = NULL;
+}
+
+/* start growing the hash table once it gets too loaded; buckets move over incrementally */
+static void grow_namespace( struct namespace *namespace )
+{
+    struct list_head *names;
+    unsigned int size;
+
+    if (namespace->old_names) return;
+    if (namespace->count <= namespace->hash_size * NAMESPACE_LOAD_FACTOR) return;
+    if (namespace->hash_size >= NAMESPACE_MAX_SIZE) return;
+
+    size = min( namespace->hash_size * 2 + 1, (unsigned int)NAMESPACE_MAX_SIZE );
+    if (!(names = alloc_hash_table( size ))) return;  /* keep using the current table */
+
+    namespace->old_names   = namespace->names;
+    namespace->old_size    = namespace->hash_size;
+    namespace->migrate_pos = 0;
+    namespace->names       = names;
+    namespace->hash_size   = size;
 }
 
 /* allocate a name for an object */
@@ -177,7 +262,13 @@ static struct object_name *alloc_name( const struct unicode_str *name )
 static void free_name( struct object *obj )
 {
     struct object_name *ptr = obj->name;
+    struct namespace *namespace = ptr->namespace;
+
     list_remove( &ptr->entry );
+    list_remove( &ptr->order );
+    namespace->count--;
+    namespace->cursor = NULL;  /* indices after the removed name have shifted */
+    migrate_namespace( namespace );
     if (ptr->parent) release_object( ptr->parent );
     free( ptr );
 }
@@ -186,9 +277,13 @@ static void free_name( struct object *obj )
 static void set_object_name( struct namespace *namespace,
                              struct object *obj, struct object_name *ptr )
 {
-    int hash = get_name_hash( namespace, ptr->name, ptr->len );
-
-    wine_list_add_head( &namespace->names[hash], &ptr->entry );
+    migrate_namespace( namespace );
+    ptr->hash = get_name_hash( ptr->name, ptr->len );
+    wine_list_add_head( get_hash_bucket( namespace, ptr->hash ), &ptr->entry );
+    wine_list_add_tail( &namespace->order, &ptr->order );
+    ptr->namespace = namespace;
+    namespace->count++;
+    grow_namespace( namespace );
     ptr->obj = obj;
     obj->name = ptr;
 }
@@ -326,7 +421,12 @@ struct object *grab_object( void *ptr )
 {
     struct object *obj = (struct object *)ptr;
     assert( obj->refcount < INT_MAX );
+#ifdef CONFIG_UNIFIED_KERNEL
+    /* requests holding uk_lock shared may grab the same object concurrently */
+    __sync_add_and_fetch( &obj->refcount, 1 );
+#else
     obj->refcount++;
+#endif
     return obj;
 }
 
@@ -335,7 +435,11 @@ void release_object( void *ptr )
 {
     struct object *obj = (struct object *)ptr;
     assert( obj->refcount );
+#ifdef CONFIG_UNIFIED_KERNEL
+    if (!__sync_sub_and_fetch( &obj->refcount, 1 ))
+#else
     if (!--obj->refcount)
+#endif
     {
         /* if the refcount is 0, nobody can be in the wait queue */
         assert( list_empty( &obj->wait_queue ));
@@ -356,14 +460,16 @@ struct object *find_object( const struct namespace *namespace, const struct unic
 {
     const struct list_head *list;
     struct list_head *p;
+    unsigned int hash;
 
     if (!name || !name->len) return NULL;
 
-    list = &namespace->names[ get_name_hash( namespace, name->str, name->len ) ];
+    hash = get_name_hash( name->str, name->len );
+    list = get_hash_bucket( namespace, hash );
     LIST_FOR_EACH( p, list )
     {
         const struct object_name *ptr = LIST_ENTRY( p, struct object_name, entry );
-        if (ptr->len != name->len) continue;
+        if (ptr->hash != hash || ptr->len != name->len) continue;
         if (attributes & OBJ_CASE_INSENSITIVE)
         {
             if (!strncmpiW( ptr->name, name->str, name->len/sizeof(WCHAR) ))
@@ -379,38 +485,65 @@ struct object *find_object( const struct namespace *namespace, const struct unic
 }
 
 /* find an object by its index; the refcount is incremented */
-struct object *find_object_index( const struct namespace *namespace, unsigned int index )
+/* the position of the last lookup is cached so that sequential enumeration is O(1) */
+struct object *find_object_index( struct namespace *namespace, unsigned int index )
 {
-    unsigned int i;
+    struct object_name *ptr;
+    struct list_head *p;
+    unsigned int i = 0;
 
-    /* FIXME: not efficient at all */
-    for (i = 0; i < namespace->hash_size; i++)
+    if (index >= namespace->count)
     {
-        const struct object_name *ptr;
-        LIST_FOR_EACH_ENTRY( ptr, &namespace->names[i], const struct object_name, entry )
-        {
-            if (!index--) return grab_object( ptr->obj );
-        }
+        set_error( STATUS_NO_MORE_ENTRIES );
+        return NULL;
     }
-    set_error( STATUS_NO_MORE_ENTRIES );
-    return NULL;
+    if (namespace->cursor && index >= namespace->cursor_index)
+    {
+        p = &namespace->cursor->order;
+        i = namespace->cursor_index;
+    }
+    else p = list_head( &namespace->order );
+
+    for (; i < index; i++) p = list_next( &namespace->order, p );
+
+    ptr = LIST_ENTRY( p, struct object_name, order );
+    namespace->cursor = ptr;
+    namespace->cursor_index = index;
+    return grab_object( ptr->obj );
 }
 
 /* allocate a namespace */
 struct namespace *create_namespace( unsigned int hash_size )
 {
     struct namespace *namespace;
-    unsigned int i;
 
-    namespace = mem_alloc( sizeof(*namespace) + (hash_size - 1) * sizeof(namespace->names[0]) );
-    if (namespace)
+    if (!(namespace = mem_alloc( sizeof(*namespace) ))) return NULL;
+    if (!(namespace->names = alloc_hash_table( hash_size )))
     {
-        namespace->hash_size      = hash_size;
-        for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
+        set_error( STATUS_NO_MEMORY );
+        free( namespace );
+        return NULL;
     }
+    namespace->hash_size = hash_size;
+    namespace->count     = 0;
+    namespace->old_names = NULL;
+    namespace->old_size  = 0;
+    namespace->migrate_pos = 0;
+    namespace->cursor    = NULL;
+    namespace->cursor_index = 0;
+    list_init( &namespace->order );
     return namespace;
 }
 
+/* free a namespace; it must not contain any names anymore */
+void free_namespace( struct namespace *namespace )
+{
+    if (!namespace) return;
+    free( namespace->old_names );
+    free( namespace->names );
+    free( namespace );
+}
+
 /* functions for unimplemented/default object operations */
 
 struct object_type *no_get_type( struct object *obj )
@@ -143,13 +143,14 @@ extern void *create_named_object( struct namespace *namespace, const struct obje
 extern void unlink_named_object( struct object *obj );
 extern void make_object_static( struct object *obj );
 extern struct namespace *create_namespace( unsigned int hash_size );
+extern void free_namespace( struct namespace *namespace );
 /* grab/release_object can take any pointer, but you better make sure */
 /* that the thing pointed to starts with a struct object... */
 extern struct object *grab_object( void *obj );
 extern void release_object( void *obj );
 extern struct object *find_object( const struct namespace *namespace, const struct unicode_str *name,
                                    unsigned int attributes );
-extern struct object *find_object_index( const struct namespace *namespace, unsigned int index );
+extern struct object *find_object_index( struct namespace *namespace, unsigned int index );
 extern struct object_type *no_get_type( struct object *obj );
 extern int no_add_queue( struct object *obj, struct wait_queue_entry *entry );
 extern void no_satisfied( struct object *obj, struct wait_queue_entry *entry );
@@ -184,6 +185,28 @@ extern void pulse_event( struct event *event );
 extern void set_event( struct event *event );
 extern void reset_event( struct event *event );
 
+#ifdef CONFIG_UNIFIED_KERNEL
+/* shared sync page functions */
+
+extern unsigned int get_sync_view( struct list_head *views, struct process *process,
+                                   unsigned int type, unsigned int state, unsigned int max );
+extern unsigned int get_sync_view_seq( struct process *process, unsigned int index );
+extern void publish_sync_state( struct list_head *views, unsigned int state );
+extern void free_sync_views( struct list_head *views );
+extern void release_process_sync( struct process *process );
+extern unsigned int get_event_sync_slot( struct object *obj, struct process *process );
+extern unsigned int get_semaphore_sync_slot( struct object *obj, struct process *process );
+
+/* shared queue status page functions */
+
+struct __server_queue_slot;
+struct queue_page;
+
+extern struct __server_queue_slot *get_queue_slot( struct queue_page *page, unsigned int index );
+extern unsigned int alloc_queue_slot( struct process *process, struct queue_page **page );
+extern void free_queue_slot( struct queue_page *page, unsigned int index );
+#endif
+
 /* mutex functions */
 
 extern void abandon_mutexes( struct thread *thread );
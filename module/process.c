@@ -412,6 +412,10 @@ struct thread *create_process( int fd, struct thread *parent_thread, int inherit
     process->trace_data      = 0;
     process->rawinput_mouse  = NULL;
     process->rawinput_kbd    = NULL;
+#ifdef CONFIG_UNIFIED_KERNEL
+    process->sync_page       = NULL;
+    process->queue_page      = NULL;
+#endif
     list_init( &process->thread_list );
     list_init( &process->locks );
     list_init( &process->classes );
@@ -506,6 +510,9 @@ static void process_destroy( struct object *obj )
     assert( !process->sigkill_timeout );  /* timeout should hold a reference to the process */
 
     close_process_handles( process );
+#ifdef CONFIG_UNIFIED_KERNEL
+    release_process_sync( process );
+#endif
     set_process_startup_state( process, STARTUP_ABORTED );
     if (process->console) release_object( process->console );
     if (process->parent) release_object( process->parent );
@@ -1260,7 +1267,12 @@ DECL_HANDLER(read_process_memory)
         char *buffer = mem_alloc( len );
         if (buffer)
         {
+#ifdef CONFIG_UNIFIED_KERNEL
+            /* return what could be read along with STATUS_PARTIAL_COPY */
+            if ((len = copy_process_memory( process, req->addr, len, buffer, 0 )))
+#else
             if (read_process_memory( process, req->addr, len, buffer ))
+#endif
                 set_reply_data_ptr( buffer, len );
             else
                 free( buffer );
@@ -1277,7 +1289,14 @@ DECL_HANDLER(write_process_memory)
     if ((process = get_process_from_handle( req->handle, PROCESS_VM_WRITE )))
     {
         data_size_t len = get_req_data_size();
-        if (len) write_process_memory( process, req->addr, len, get_req_data() );
+#ifdef CONFIG_UNIFIED_KERNEL
+        if (len) reply->written = copy_process_memory( process, req->addr, len, (void *)get_req_data(), 1 );
+#else
+        if (len)
+        {
+            if (write_process_memory( process, req->addr, len, get_req_data() )) reply->written = len;
+        }
+#endif
         else set_error( STATUS_INVALID_PARAMETER );
         release_object( process );
     }
@@ -103,6 +103,10 @@ struct process
     struct list_head          rawinput_devices;/* list of registered rawinput devices */
     const struct rawinput_device *rawinput_mouse; /* rawinput mouse device, if any */
     const struct rawinput_device *rawinput_kbd;   /* rawinput keyboard device, if any */
+#ifdef CONFIG_UNIFIED_KERNEL
+    struct sync_page    *sync_page;       /* sync page mapped by the process, if any */
+    struct queue_page   *queue_page;      /* queue status page of the process, if any */
+#endif
 };
 
 struct process_snapshot
@@ -165,6 +169,12 @@ extern void init_process_tracing( struct process *process );
 extern void finish_process_tracing( struct process *process );
 extern int read_process_memory( struct process *process, client_ptr_t ptr, data_size_t size, char *dest );
 extern int write_process_memory( struct process *process, client_ptr_t ptr, data_size_t size, const char *src );
+#ifdef CONFIG_UNIFIED_KERNEL
+extern data_size_t copy_process_memory( struct process *process, client_ptr_t ptr, data_size_t size,
+                                        void *buf, int write );
+extern data_size_t copy_async_memory( struct process *process, client_ptr_t ptr, data_size_t size,
+                                      void *buf, int write );
+#endif
 
 static inline process_id_t get_process_id( struct process *process ) { return process->id; }
 
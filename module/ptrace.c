@@ -66,6 +66,19 @@
 #include "process.h"
 #include "thread.h"
 
+#ifdef CONFIG_UNIFIED_KERNEL
+#include <linux/version.h>
+#include <linux/sched.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,11,0)
+#include <linux/sched/task.h>
+#include <linux/sched/signal.h>
+#endif
+#include <linux/mm.h>
+#include <linux/pid.h>
+#include <linux/ptrace.h>
+#include <linux/mutex.h>
+#endif
+
 #ifdef USE_PTRACE
 
 #ifndef PTRACE_CONT
@@ -347,6 +360,150 @@ static struct thread *get_ptrace_thread( struct process *process )
     return NULL;
 }
 
+#ifdef CONFIG_UNIFIED_KERNEL
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,9,0)
+typedef int (*access_process_vm_func)( struct task_struct *tsk, unsigned long addr, void *buf,
+                                       int len, unsigned int gup_flags );
+#define VM_ACCESS_FLAGS(write) ((write) ? FOLL_FORCE | FOLL_WRITE : FOLL_FORCE)
+#else
+typedef int (*access_process_vm_func)( struct task_struct *tsk, unsigned long addr, void *buf,
+                                       int len, int write );
+#define VM_ACCESS_FLAGS(write) (write)
+#endif
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,5,0)
+#define VM_ACCESS_MODE PTRACE_MODE_ATTACH_REALCREDS
+#else
+#define VM_ACCESS_MODE PTRACE_MODE_ATTACH
+#endif
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36)
+#define TASK_CRED_GUARD(task) ((task)->signal->cred_guard_mutex)
+#else
+#define TASK_CRED_GUARD(task) ((task)->cred_guard_mutex)
+#endif
+
+#define VM_ACCESS_CHUNK 0x100000  /* bytes copied per access_process_vm call */
+
+typedef bool (*ptrace_may_access_func)( struct task_struct *task, unsigned int mode );
+
+extern void *get_kernel_proc_address( char *funcname );
+
+static access_process_vm_func access_vm;
+static ptrace_may_access_func may_access;
+
+/* get a reference to the task of a process, with the helpers needed to access it */
+static struct task_struct *get_process_task( struct process *process )
+{
+    struct thread *thread = get_ptrace_thread( process );
+    struct task_struct *task;
+
+    if (!thread) return NULL;
+
+    if (!access_vm && !(access_vm = get_kernel_proc_address( "access_process_vm" )))
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return NULL;
+    }
+    if (!may_access && !(may_access = get_kernel_proc_address( "ptrace_may_access" )))
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return NULL;
+    }
+
+    rcu_read_lock();
+    if ((task = pid_task( find_vpid( thread->unix_pid ), PIDTYPE_PID ))) get_task_struct( task );
+    rcu_read_unlock();
+    if (!task) set_error( STATUS_PROCESS_IS_TERMINATING );
+    return task;
+}
+
+/* copy a range of a task address space in chunks; sets STATUS_PARTIAL_COPY if it stopped short */
+static data_size_t access_task_memory( struct task_struct *task, client_ptr_t ptr, data_size_t size,
+                                       void *buf, int write )
+{
+    data_size_t done = 0;
+    int len, ret;
+
+    while (done < size)
+    {
+        len = min( size - done, (data_size_t)VM_ACCESS_CHUNK );
+        ret = access_vm( task, (unsigned long)ptr + done, (char *)buf + done, len, VM_ACCESS_FLAGS(write) );
+        if (ret > 0) done += ret;
+        if (ret < len) break;  /* hit an unmapped or protected page */
+    }
+    if (done < size) set_error( STATUS_PARTIAL_COPY );
+    return done;
+}
+
+/* copy a range of a process address space from or to a kernel buffer on
+ * behalf of the calling process, which needs the same rights over the target
+ * as ptrace would; the process does not need to be stopped or traced.
+ * Returns the number of bytes copied, and sets STATUS_PARTIAL_COPY if it
+ * stopped short of size. */
+data_size_t copy_process_memory( struct process *process, client_ptr_t ptr, data_size_t size,
+                                 void *buf, int write )
+{
+    struct task_struct *task;
+    data_size_t done = 0;
+
+    if ((unsigned long)ptr != ptr)
+    {
+        set_error( STATUS_ACCESS_DENIED );
+        return 0;
+    }
+    if (!(task = get_process_task( process ))) return 0;
+
+    /* keep the target from changing credentials through exec until the copy is done */
+    if (mutex_lock_killable( &TASK_CRED_GUARD(task) ))
+    {
+        put_task_struct( task );
+        set_error( STATUS_THREAD_IS_TERMINATING );
+        return 0;
+    }
+    if (may_access( task, VM_ACCESS_MODE )) done = access_task_memory( task, ptr, size, buf, write );
+    else set_error( STATUS_ACCESS_DENIED );
+    mutex_unlock( &TASK_CRED_GUARD(task) );
+
+    put_task_struct( task );
+    return done;
+}
+
+/* copy data between a kernel buffer and memory the process handed to the
+ * server for an I/O operation; unlike copy_process_memory there is no access
+ * check, the caller may be any process completing the I/O. */
+data_size_t copy_async_memory( struct process *process, client_ptr_t ptr, data_size_t size,
+                               void *buf, int write )
+{
+    struct task_struct *task;
+    data_size_t done;
+
+    if ((unsigned long)ptr != ptr)
+    {
+        set_error( STATUS_ACCESS_DENIED );
+        return 0;
+    }
+    if (!(task = get_process_task( process ))) return 0;
+    done = access_task_memory( task, ptr, size, buf, write );
+    put_task_struct( task );
+    return done;
+}
+
+/* read data from a process memory space */
+int read_process_memory( struct process *process, client_ptr_t ptr, data_size_t size, char *dest )
+{
+    return copy_process_memory( process, ptr, size, dest, 0 ) == size;
+}
+
+/* write data to a process memory space */
+int write_process_memory( struct process *process, client_ptr_t ptr, data_size_t size, const char *src )
+{
+    return copy_process_memory( process, ptr, size, (void *)src, 1 ) == size;
+}
+
+#else  /* CONFIG_UNIFIED_KERNEL */
+
 /* read data from a process memory space */
 int read_process_memory( struct process *process, client_ptr_t ptr, data_size_t size, char *dest )
 {
@@ -520,6 +677,8 @@ int write_process_memory( struct process *process, client_ptr_t ptr, data_size_t
     return ret;
 }
 
+#endif  /* CONFIG_UNIFIED_KERNEL */
+
 /* retrieve an LDT selector entry */
 void get_selector_entry( struct thread *thread, int entry, unsigned int *base,
                          unsigned int *limit, unsigned char *flags )
@@ -53,6 +53,10 @@
 #include "request.h"
 #include "user.h"
 
+#ifdef CONFIG_UNIFIED_KERNEL
+#include "wine/server.h"  /* for struct __server_queue_slot */
+#endif
+
 #define WM_NCMOUSEFIRST WM_NCMOUSEMOVE
 #define WM_NCMOUSELAST  (WM_NCMOUSEFIRST+(WM_MOUSELAST-WM_MOUSEFIRST))
 
@@ -91,6 +95,21 @@ struct message
     unsigned int           data_size; /* size of message data */
     unsigned int           unique_id; /* unique id for nested hw message waits */
     struct message_result *result;    /* result in sender queue */
+    struct post_group     *group;     /* group of a posted message, NULL if not indexed */
+    struct list_head       group_entry; /* entry in group list */
+    unsigned int           seq;       /* posting order of a posted message */
+};
+
+#define POST_HASH_SIZE 32
+
+/* posted messages for the same window and message code, in posting order */
+struct post_group
+{
+    struct list_head       entry;     /* entry in queue list of groups */
+    struct list_head       hash_entry; /* entry in queue hash table */
+    struct list_head       msgs;      /* messages of the group */
+    user_handle_t          win;       /* window handle */
+    unsigned int           msg;       /* message code */
 };
 
 struct timer
@@ -137,6 +156,10 @@ struct msg_queue
     int                    exit_code;       /* exit code of pending quit message */
     int                    cursor_count;    /* per-queue cursor show count */
     struct list_head            msg_list[NB_MSG_KINDS];  /* lists of messages */
+    struct list_head            post_groups;     /* groups of posted messages */
+    struct list_head            post_hash[POST_HASH_SIZE]; /* hash table of the groups */
+    unsigned int           post_seq;        /* sequence number of the next posted message */
+    unsigned int           post_unindexed;  /* posted messages that couldn't get a group */
     struct list_head            send_result;     /* stack of sent messages waiting for result */
     struct list_head            callback_result; /* list of callback messages waiting for result */
     struct message_result *recv_result;     /* stack of received messages waiting for result */
@@ -147,6 +170,10 @@ struct msg_queue
     struct thread_input   *input;           /* thread input descriptor */
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
+#ifdef CONFIG_UNIFIED_KERNEL
+    struct queue_page     *slot_page;       /* queue status page of the thread process */
+    unsigned int           slot;            /* slot in the queue status page, 0 if none */
+#endif
 };
 
 struct hotkey
@@ -301,11 +328,19 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->input           = (struct thread_input *)grab_object( input );
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
+#ifdef CONFIG_UNIFIED_KERNEL
+        queue->slot_page       = NULL;
+        queue->slot            = alloc_queue_slot( thread->process, &queue->slot_page );
+#endif
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
         list_init( &queue->expired_timers );
         for (i = 0; i < NB_MSG_KINDS; i++) list_init( &queue->msg_list[i] );
+        list_init( &queue->post_groups );
+        for (i = 0; i < POST_HASH_SIZE; i++) list_init( &queue->post_hash[i] );
+        queue->post_seq       = 0;
+        queue->post_unindexed = 0;
 
         thread->queue = queue;
     }
@@ -428,11 +463,25 @@ static inline int is_signaled( struct msg_queue *queue )
     return ((queue->wake_bits & queue->wake_mask) || (queue->changed_bits & queue->changed_mask));
 }
 
+/* publish the queue bits in the queue status page */
+static inline void publish_queue_bits( struct msg_queue *queue )
+{
+#ifdef CONFIG_UNIFIED_KERNEL
+    if (queue->slot)
+    {
+        struct __server_queue_slot *slot = get_queue_slot( queue->slot_page, queue->slot );
+        ACCESS_ONCE( slot->wake_bits )    = queue->wake_bits;
+        ACCESS_ONCE( slot->changed_bits ) = queue->changed_bits;
+    }
+#endif
+}
+
 /* set some queue bits */
 static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
 {
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    publish_queue_bits( queue );
     if (is_signaled( queue )) uk_wake_up( &queue->obj, 0 );
 }
 
@@ -441,6 +490,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    publish_queue_bits( queue );
 }
 
 /* check whether msg is a keyboard message */
@@ -608,6 +658,59 @@ static void free_message( struct message *msg )
     free( msg );
 }
 
+/* hash bucket of the posted messages for a window and message code */
+static inline unsigned int post_hash( user_handle_t win, unsigned int msg )
+{
+    return (win ^ (win >> 5) ^ msg ^ (msg >> 5)) % POST_HASH_SIZE;
+}
+
+/* add a message to the posted messages of a queue, and to the group of its window and code */
+static void add_posted_message( struct msg_queue *queue, struct message *msg )
+{
+    struct list_head *bucket = &queue->post_hash[post_hash( msg->win, msg->msg )];
+    struct post_group *group;
+
+    msg->seq = queue->post_seq++;
+    wine_list_add_tail( &queue->msg_list[POST_MESSAGE], &msg->entry );
+
+    LIST_FOR_EACH_ENTRY( group, bucket, struct post_group, hash_entry )
+        if (group->win == msg->win && group->msg == msg->msg) goto found;
+
+    /* messages can be posted from softirq context */
+    if (!(group = malloc_atomic( sizeof(*group) )))
+    {
+        /* get_posted_message falls back to scanning the whole list */
+        msg->group = NULL;
+        queue->post_unindexed++;
+        return;
+    }
+    group->win = msg->win;
+    group->msg = msg->msg;
+    list_init( &group->msgs );
+    wine_list_add_tail( &queue->post_groups, &group->entry );
+    wine_list_add_head( bucket, &group->hash_entry );
+found:
+    msg->group = group;
+    wine_list_add_tail( &group->msgs, &msg->group_entry );
+}
+
+/* remove a posted message from its group, freeing the group once empty */
+static void remove_posted_message_group( struct msg_queue *queue, struct message *msg )
+{
+    struct post_group *group = msg->group;
+
+    if (!group)
+    {
+        queue->post_unindexed--;
+        return;
+    }
+    list_remove( &msg->group_entry );
+    if (!list_empty( &group->msgs )) return;
+    list_remove( &group->entry );
+    list_remove( &group->hash_entry );
+    free( group );
+}
+
 /* remove (and free) a message from a message list */
 static void remove_queue_message( struct msg_queue *queue, struct message *msg,
                                   enum message_kind kind )
@@ -619,6 +722,7 @@ static void remove_queue_message( struct msg_queue *queue, struct message *msg,
         if (list_empty( &queue->msg_list[kind] )) clear_queue_bits( queue, QS_SENDMESSAGE );
         break;
     case POST_MESSAGE:
+        remove_posted_message_group( queue, msg );
         if (list_empty( &queue->msg_list[kind] ) && !queue->quit_message)
             clear_queue_bits( queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
         if (msg->msg == WM_HOTKEY && --queue->hotkey_count == 0)
@@ -770,7 +874,23 @@ static int get_posted_message( struct msg_queue *queue, user_handle_t win,
                                unsigned int first, unsigned int last, unsigned int flags,
                                struct get_message_reply *reply )
 {
-    struct message *msg;
+    struct message *msg, *head;
+    struct post_group *group;
+
+    if (!queue->post_unindexed && (win || first || last != ~0U))
+    {
+        /* the oldest message of each matching group is a candidate, take the oldest of them */
+        msg = NULL;
+        LIST_FOR_EACH_ENTRY( group, &queue->post_groups, struct post_group, entry )
+        {
+            if (!check_msg_filter( group->msg, first, last )) continue;
+            if (!match_window( win, group->win )) continue;
+            head = LIST_ENTRY( list_head( &group->msgs ), struct message, group_entry );
+            if (!msg || (int)(head->seq - msg->seq) < 0) msg = head;
+        }
+        if (msg) goto found;
+        return 0;
+    }
 
     /* check against the filters */
     LIST_FOR_EACH_ENTRY( msg, &queue->msg_list[POST_MESSAGE], struct message, entry )
@@ -948,10 +1068,13 @@ static void msg_queue_destroy( struct object *obj )
     struct msg_queue *queue = (struct msg_queue *)obj;
     struct list_head *ptr;
     struct hotkey *hotkey, *hotkey2;
+    struct post_group *group, *group2;
     int i;
 
     cleanup_results( queue );
     for (i = 0; i < NB_MSG_KINDS; i++) empty_msg_list( &queue->msg_list[i] );
+    LIST_FOR_EACH_ENTRY_SAFE( group, group2, &queue->post_groups, struct post_group, entry )
+        free( group );
 
     LIST_FOR_EACH_ENTRY_SAFE( hotkey, hotkey2, &queue->input->desktop->hotkeys, struct hotkey, entry )
     {
@@ -979,6 +1102,9 @@ static void msg_queue_destroy( struct object *obj )
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+#ifdef CONFIG_UNIFIED_KERNEL
+    if (queue->slot) free_queue_slot( queue->slot_page, queue->slot );
+#endif
 }
 
 static void msg_queue_poll_event( struct uk_fd *fd, int event )
@@ -1376,7 +1502,7 @@ found:
     msg->data      = NULL;
     msg->data_size = 0;
 
-    wine_list_add_tail( &hotkey->queue->msg_list[POST_MESSAGE], &msg->entry );
+    add_posted_message( hotkey->queue, msg );
     set_queue_bits( hotkey->queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE|QS_HOTKEY );
     hotkey->queue->hotkey_count++;
     return 1;
@@ -2076,7 +2202,7 @@ void post_message_atomic( user_handle_t win, unsigned int message, lparam_t wpar
         msg->data      = NULL;
         msg->data_size = 0;
 
-        wine_list_add_tail( &thread->queue->msg_list[POST_MESSAGE], &msg->entry );
+        add_posted_message( thread->queue, msg );
         set_queue_bits( thread->queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
         if (message == WM_HOTKEY)
         {
@@ -2109,7 +2235,7 @@ void post_message( user_handle_t win, unsigned int message, lparam_t wparam, lpa
         msg->data      = NULL;
         msg->data_size = 0;
 
-        wine_list_add_tail( &thread->queue->msg_list[POST_MESSAGE], &msg->entry );
+        add_posted_message( thread->queue, msg );
         set_queue_bits( thread->queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
         if (message == WM_HOTKEY)
         {
@@ -2199,7 +2325,12 @@ DECL_HANDLER(get_msg_queue)
     struct msg_queue *queue = get_current_queue();
 
     reply->handle = 0;
-    if (queue) reply->handle = alloc_handle( current_thread->process, queue, SYNCHRONIZE, 0 );
+    reply->slot = reply->slot_seq = 0;
+    if (!queue) return;
+    reply->handle = alloc_handle( current_thread->process, queue, SYNCHRONIZE, 0 );
+#ifdef CONFIG_UNIFIED_KERNEL
+    if ((reply->slot = queue->slot)) reply->slot_seq = get_queue_slot( queue->slot_page, queue->slot )->seq;
+#endif
 }
 
 
@@ -2257,7 +2388,11 @@ DECL_HANDLER(get_queue_status)
     {
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
-        if (req->clear) queue->changed_bits = 0;
+        if (req->clear)
+        {
+            queue->changed_bits = 0;
+            publish_queue_bits( queue );
+        }
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -2322,7 +2457,7 @@ DECL_HANDLER(send_message)
             set_queue_bits( recv_queue, QS_SENDMESSAGE );
             break;
         case MSG_POSTED:
-            wine_list_add_tail( &recv_queue->msg_list[POST_MESSAGE], &msg->entry );
+            add_posted_message( recv_queue, msg );
             set_queue_bits( recv_queue, QS_POSTMESSAGE|QS_ALLPOSTMESSAGE );
             if (msg->msg == WM_HOTKEY)
             {
@@ -2432,6 +2567,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    publish_queue_bits( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
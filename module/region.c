@@ -103,6 +103,8 @@ struct region
 
 
 #define RGN_DEFAULT_RECTS 2
+#define RGN_CACHE_SIZE    16   /* number of freed regions kept for reuse */
+#define RGN_CACHE_RECTS   64   /* regions with bigger buffers are really freed */
 
 #define EXTENTCHECK(r1, r2) \
     ((r1)->right > (r2)->left && \
@@ -117,6 +119,11 @@ typedef int (*non_overlap_func_t)( struct region *reg, const rectangle_t *r,
 
 static const rectangle_t empty_rect;  /* all-zero rectangle for empty regions */
 
+/* regions freed by previous operations, reused to avoid an allocation for each
+ * temporary region; like the rest of the window code this runs under uk_lock */
+static struct region *region_cache[RGN_CACHE_SIZE];
+static int region_cache_count;
+
 /* add a rectangle to a region */
 static inline rectangle_t *add_rect( struct region *reg )
 {
@@ -231,14 +238,18 @@ static int region_op( struct region *newReg, const struct region *reg1, const st
     const rectangle_t *r1End = r1 + reg1->num_rects;
     const rectangle_t *r2End = r2 + reg2->num_rects;
 
-    rectangle_t *new_rects, *old_rects = newReg->rects;
+    rectangle_t *new_rects, *old_rects = NULL;
     int new_size, ret = 0;
 
     new_size = max( reg1->num_rects, reg2->num_rects ) * 2;
-    if (!(new_rects = mem_alloc( new_size * sizeof(*newReg->rects) ))) return 0;
-
-    newReg->size = new_size;
-    newReg->rects = new_rects;
+    if (newReg == reg1 || newReg == reg2 || newReg->size < new_size)
+    {
+        /* the result can't be built in place */
+        if (!(new_rects = mem_alloc( new_size * sizeof(*newReg->rects) ))) return 0;
+        old_rects = newReg->rects;
+        newReg->size = new_size;
+        newReg->rects = new_rects;
+    }
     newReg->num_rects = 0;
 
     if (reg1->extents.top < reg2->extents.top)
@@ -333,7 +344,8 @@ static int region_op( struct region *newReg, const struct region *reg1, const st
 
     if (newReg->num_rects != curBand) coalesce_region(newReg, prevBand, curBand);
 
-    if ((newReg->num_rects < (newReg->size / 2)) && (newReg->size > 2))
+    /* only give memory back when a lot of it is unused, regions get reused */
+    if ((newReg->num_rects < (newReg->size / 4)) && (newReg->size > RGN_CACHE_RECTS))
     {
         new_size = max( newReg->num_rects, RGN_DEFAULT_RECTS );
         if ((new_rects = realloc( newReg->rects, sizeof(*newReg->rects) * new_size )))
@@ -577,13 +589,17 @@ struct region *create_empty_region(void)
 {
     struct region *region;
 
-    if (!(region = mem_alloc( sizeof(*region) ))) return NULL;
-    if (!(region->rects = mem_alloc( RGN_DEFAULT_RECTS * sizeof(*region->rects) )))
+    if (region_cache_count) region = region_cache[--region_cache_count];
+    else
     {
-        free( region );
-        return NULL;
+        if (!(region = mem_alloc( sizeof(*region) ))) return NULL;
+        if (!(region->rects = mem_alloc( RGN_DEFAULT_RECTS * sizeof(*region->rects) )))
+        {
+            free( region );
+            return NULL;
+        }
+        region->size = RGN_DEFAULT_RECTS;
     }
-    region->size = RGN_DEFAULT_RECTS;
     region->num_rects = 0;
     region->extents.left = 0;
     region->extents.top = 0;
@@ -627,10 +643,28 @@ struct region *create_region_from_req_data( const void *data, data_size_t size )
 /* free a region */
 void free_region( struct region *region )
 {
+    if (region_cache_count < RGN_CACHE_SIZE && region->size <= RGN_CACHE_RECTS)
+    {
+        region_cache[region_cache_count++] = region;
+        return;
+    }
     free( region->rects );
     free( region );
 }
 
+/* free the regions kept for reuse, on module unload */
+void release_region_cache(void)
+{
+    struct region *region;
+
+    while (region_cache_count)
+    {
+        region = region_cache[--region_cache_count];
+        free( region->rects );
+        free( region );
+    }
+}
+
 /* set region to a simple rectangle */
 void set_region_rect( struct region *region, const rectangle_t *rect )
 {
@@ -768,6 +802,61 @@ struct region *copy_region( struct region *dst, const struct region *src )
     return dst;
 }
 
+/* check whether a rectangle contains another one */
+static inline int rect_contains( const rectangle_t *outer, const rectangle_t *inner )
+{
+    return (outer->left <= inner->left && outer->top <= inner->top &&
+            outer->right >= inner->right && outer->bottom >= inner->bottom);
+}
+
+/* set dst to the subtraction of two overlapping rectangles, banded the same way as region_op */
+static struct region *subtract_rects( struct region *dst, const rectangle_t *rect1,
+                                      const rectangle_t *rect2 )
+{
+    const rectangle_t r1 = *rect1, r2 = *rect2;  /* dst can hold one of them */
+    rectangle_t *rect;
+    int top, bottom;
+
+    if (dst->size < 4)
+    {
+        if (!(rect = realloc( dst->rects, 4 * sizeof(*rect) )))
+        {
+            set_error( STATUS_NO_MEMORY );
+            return NULL;
+        }
+        dst->rects = rect;
+        dst->size = 4;
+    }
+
+    /* the middle band can't be coalesced with the others since it is narrower */
+    top = max( r1.top, r2.top );
+    bottom = min( r1.bottom, r2.bottom );
+    rect = dst->rects;
+    if (r2.top > r1.top)
+    {
+        rect->left = r1.left; rect->top = r1.top; rect->right = r1.right; rect->bottom = top;
+        rect++;
+    }
+    if (r2.left > r1.left)
+    {
+        rect->left = r1.left; rect->top = top; rect->right = r2.left; rect->bottom = bottom;
+        rect++;
+    }
+    if (r2.right < r1.right)
+    {
+        rect->left = r2.right; rect->top = top; rect->right = r1.right; rect->bottom = bottom;
+        rect++;
+    }
+    if (r2.bottom < r1.bottom)
+    {
+        rect->left = r1.left; rect->top = bottom; rect->right = r1.right; rect->bottom = r1.bottom;
+        rect++;
+    }
+    dst->num_rects = rect - dst->rects;
+    set_region_extents( dst );
+    return dst;
+}
+
 /* compute the intersection of two regions into dst, which can be one of the source regions */
 struct region *intersect_region( struct region *dst, const struct region *src1,
                                  const struct region *src2 )
@@ -781,6 +870,21 @@ struct region *intersect_region( struct region *dst, const struct region *src1,
         dst->extents.bottom = 0;
         return dst;
     }
+
+    /* fast paths for rectangles, which are the most common case */
+    if (src1->num_rects == 1 && src2->num_rects == 1)
+    {
+        rectangle_t rect;
+
+        intersect_rect( &rect, &src1->extents, &src2->extents );
+        set_region_rect( dst, &rect );
+        return dst;
+    }
+    if (src2->num_rects == 1 && rect_contains( &src2->extents, &src1->extents ))
+        return copy_region( dst, src1 );
+    if (src1->num_rects == 1 && rect_contains( &src1->extents, &src2->extents ))
+        return copy_region( dst, src2 );
+
     if (!region_op( dst, src1, src2, intersect_overlapping, NULL, NULL )) return NULL;
     set_region_extents( dst );
     return dst;
@@ -793,6 +897,17 @@ struct region *subtract_region( struct region *dst, const struct region *src1,
     if (!src1->num_rects || !src2->num_rects || !EXTENTCHECK(&src1->extents, &src2->extents))
         return copy_region( dst, src1 );
 
+    /* fast paths for rectangles, which are the most common case */
+    if (src2->num_rects == 1)
+    {
+        if (rect_contains( &src2->extents, &src1->extents ))
+        {
+            set_region_rect( dst, &empty_rect );
+            return dst;
+        }
+        if (src1->num_rects == 1) return subtract_rects( dst, &src1->extents, &src2->extents );
+    }
+
     if (!region_op( dst, src1, src2, subtract_overlapping,
                     subtract_non_overlapping, NULL )) return NULL;
     set_region_extents( dst );
@@ -62,6 +62,15 @@
 #include "winternl.h"
 #include "wine/library.h"
 
+#ifdef CONFIG_UNIFIED_KERNEL
+#include <linux/moduleparam.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#endif
+
 struct notify
 {
     struct list_head       entry;    /* entry in list of notifications */
@@ -123,6 +132,7 @@ static const timeout_t ticks_1601_to_1970 = (timeout_t)86400 * (369 * 365 + 89)
 static const timeout_t save_period = 30 * -TICKS_PER_SEC;  /* delay between periodic saves */
 static struct timeout_user *save_timeout_user;  /* saving timer */
 static enum prefix_type { PREFIX_UNKNOWN, PREFIX_32BIT, PREFIX_64BIT } prefix_type;
+static unsigned int load_generation;  /* journal generation of the last file loaded */
 
 static const WCHAR root_name[] = { '\\','R','e','g','i','s','t','r','y','\\' };
 static const WCHAR wow6432node[] = {'W','o','w','6','4','3','2','N','o','d','e'};
@@ -130,6 +140,9 @@ static const WCHAR symlink_value[] = {'S','y','m','b','o','l','i','c','L','i','n
 static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_value) };
 
 static void set_periodic_save_timer(void);
+#ifdef CONFIG_UNIFIED_KERNEL
+static void init_registry_saver(void);
+#endif
 static struct reg_key_value *find_value( const struct reg_key *key, const struct unicode_str *name, int *index );
 
 /* information about where to save a registry branch */
@@ -137,6 +150,16 @@ struct save_branch_info
 {
     struct reg_key  *key;
     const char  *path;
+    int          binary;  /* file is a binary hive */
+    int          saving;  /* a snapshot is being written out */
+    int          failed;  /* the last write failed, the file is out of date */
+    int          compact; /* the next save must rewrite the whole file */
+    char        *journal;       /* journal records not written out yet */
+    data_size_t  journal_size;  /* size of the pending records */
+    data_size_t  journal_alloc; /* allocated size of the journal buffer */
+    size_t       journal_file;  /* size of the journal file since the last full save */
+    size_t       file_size;     /* size of the file at the last full save */
+    unsigned int generation;    /* journal generation of the file */
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
@@ -157,6 +180,115 @@ struct file_load_info
 };
 
 
+/* binary registry hive: a header followed by the key array, the value array
+ * and a pool holding the names, classes and value data. Keys are stored
+ * breadth first starting with the base key, so the subkeys of a key are
+ * contiguous and sorted like the in-memory subkeys array, and the whole
+ * hive can be read in one go and loaded without any lookup. */
+
+#define HIVE_MAGIC    "WINEHIVE"
+#define HIVE_VERSION  1
+#define HIVE_ALIGN(size) (((size) + 3) & ~3)  /* alignment of pool entries */
+
+struct hive_header
+{
+    char         magic[8];    /* HIVE_MAGIC */
+    unsigned int version;     /* HIVE_VERSION */
+    unsigned int arch;        /* prefix type, PREFIX_UNKNOWN if not known */
+    unsigned int size;        /* total file size */
+    unsigned int nb_keys;     /* number of keys, including the base key */
+    unsigned int nb_values;   /* number of values */
+    unsigned int keys;        /* file offset of the key array */
+    unsigned int values;      /* file offset of the value array */
+    unsigned int pool;        /* file offset of the pool */
+    unsigned int pool_size;   /* size of the pool */
+    unsigned int generation;  /* journal generation, see struct journal_header */
+};
+
+struct hive_key
+{
+    timeout_t      modif;       /* last modification time */
+    unsigned int   name;        /* pool offset of the name */
+    unsigned int   class;       /* pool offset of the class */
+    unsigned short namelen;     /* length of the name in bytes */
+    unsigned short classlen;    /* length of the class in bytes */
+    unsigned int   flags;       /* KEY_SYMLINK */
+    unsigned int   subkeys;     /* index of the first subkey */
+    unsigned int   nb_subkeys;  /* number of subkeys */
+    unsigned int   values;      /* index of the first value */
+    unsigned int   nb_values;   /* number of values */
+};
+
+struct hive_value
+{
+    unsigned int   name;        /* pool offset of the name */
+    unsigned short namelen;     /* length of the name in bytes */
+    unsigned short type;        /* value type */
+    unsigned int   data;        /* pool offset of the data */
+    data_size_t    len;         /* length of the data in bytes */
+};
+
+/* registry journal: the changes made to a branch since its file was last
+ * written in full, appended to <file>.journal at each periodic save. The
+ * journal is replayed when the branch is loaded, and is folded back into
+ * the file once it has grown past a fraction of the file size.
+ *
+ * Each full save bumps the generation of the branch and stores it in the
+ * file; a journal only applies to the file of the same generation. A crash
+ * between the rename of a new file and the removal of the journal leaves
+ * a journal from the previous generation, which is ignored on load and
+ * started over by the next append. */
+
+#define JOURNAL_MAGIC       "WINEJRNL"
+#define JOURNAL_VERSION     2
+#define JOURNAL_MAX_BUFFER  (1024 * 1024)  /* pending records beyond which we compact instead */
+#define JOURNAL_MIN_COMPACT (1024 * 1024)  /* journal size below which we never compact */
+#define JOURNAL_ALIGN(size) (((size) + 7) & ~7)  /* alignment of records */
+
+enum journal_op
+{
+    JOURNAL_CREATE_KEY = 1,    /* name is the key class, type the key flags */
+    JOURNAL_DELETE_KEY,        /* modif is for the parent key */
+    JOURNAL_SET_VALUE,
+    JOURNAL_DELETE_VALUE
+};
+
+struct journal_header
+{
+    char         magic[8];    /* JOURNAL_MAGIC */
+    unsigned int version;     /* JOURNAL_VERSION */
+    unsigned int generation;  /* generation of the file the records apply to */
+};
+
+/* a journal record, followed by the key path relative to the branch key,
+ * the name and the data, each aligned with HIVE_ALIGN */
+struct journal_record
+{
+    unsigned int op;          /* JOURNAL_* */
+    unsigned int size;        /* size of the whole record */
+    timeout_t    modif;       /* new modification time of the key */
+    data_size_t  pathlen;     /* length of the key path in bytes */
+    data_size_t  namelen;     /* length of the value name or key class in bytes */
+    data_size_t  len;         /* length of the value data in bytes */
+    unsigned int type;        /* value type or key flags */
+};
+
+#ifdef CONFIG_UNIFIED_KERNEL
+/* format used when saving the registry branches: 0 keeps the format of each
+ * file, 1 converts them to text and 2 to binary hives on the next save */
+static int reg_format;
+module_param( reg_format, int, 0644 );
+MODULE_PARM_DESC( reg_format, "registry file format: 0 keep, 1 text, 2 binary hive" );
+
+static inline void *alloc_hive_image( size_t size ) { return vmalloc( size ); }
+static inline void free_hive_image( void *ptr ) { vfree( ptr ); }
+#else
+static int reg_format;
+
+static inline void *alloc_hive_image( size_t size ) { return malloc( size ); }
+static inline void free_hive_image( void *ptr ) { free( ptr ); }
+#endif
+
 static void key_dump( struct object *obj, int verbose );
 static unsigned int key_map_access( struct object *obj, unsigned int access );
 static struct security_descriptor *key_get_sd( struct object *obj );
@@ -264,6 +396,18 @@ static void dump_value( const struct reg_key_value *value, FILE *f )
     fputc( '\n', f );
 }
 
+/* convert a key modification time to the seconds since 1970 saved in text files */
+static unsigned int get_modif_seconds( timeout_t modif )
+{
+#ifndef CONFIG_UNIFIED_KERNEL
+    return (unsigned int)((modif - ticks_1601_to_1970) / TICKS_PER_SEC);
+#else
+    u64 tmp = (modif - ticks_1601_to_1970);
+    do_div(tmp, TICKS_PER_SEC);
+    return (unsigned int)tmp;
+#endif
+}
+
 /* save a registry and all its subkeys to a text file */
 static void save_subkeys( const struct reg_key *key, const struct reg_key *base, FILE *f )
 {
@@ -276,15 +420,7 @@ static void save_subkeys( const struct reg_key *key, const struct reg_key *base,
     {
         fprintf( f, "\n[" );
         if (key != base) dump_path( key, base, f );
-#ifndef CONFIG_UNIFIED_KERNEL
-        fprintf( f, "] %u\n", (unsigned int)((key->modif - ticks_1601_to_1970) / TICKS_PER_SEC) );
-#else
-        {
-        u64 tmp = (key->modif - ticks_1601_to_1970);
-        do_div(tmp, TICKS_PER_SEC);
-        fprintf( f, "] %u\n", (unsigned int)(tmp) );
-        }
-#endif
+        fprintf( f, "] %u\n", get_modif_seconds( key->modif ) );
         if (key->class)
         {
             fprintf( f, "#class=\"" );
@@ -560,6 +696,111 @@ static void touch_key( struct reg_key *key, unsigned int change )
         check_notify( k, change & ~REG_NOTIFY_CHANGE_LAST_SET, 0 );
 }
 
+/* find the saved branch a key belongs to, and the length of its path from the branch key */
+static struct save_branch_info *get_branch_info( const struct reg_key *key, data_size_t *pathlen )
+{
+    int i;
+
+    *pathlen = 0;
+    for ( ; key; key = key->parent)
+    {
+        for (i = 0; i < save_branch_count; i++)
+        {
+            if (save_branch_info[i].key != key) continue;
+            if (*pathlen) *pathlen -= sizeof(WCHAR);  /* no separator before the first name */
+            return &save_branch_info[i];
+        }
+        *pathlen += key->namelen + sizeof(WCHAR);
+    }
+    return NULL;
+}
+
+/* drop the journal of a branch, the next save will write the whole file */
+static void reset_journal( struct save_branch_info *info )
+{
+    free( info->journal );
+    info->journal = NULL;
+    info->journal_size = info->journal_alloc = 0;
+    info->compact = 1;
+}
+
+/* the key was changed behind the journal's back, e.g. by loading a file into it */
+static void journal_full_save( const struct reg_key *key )
+{
+    struct save_branch_info *info;
+    data_size_t pathlen;
+
+    if ((info = get_branch_info( key, &pathlen ))) reset_journal( info );
+}
+
+/* record a change to a saved key in the journal of its branch */
+static void journal_change( const struct reg_key *key, enum journal_op op, timeout_t modif,
+                            const WCHAR *name, data_size_t namelen, unsigned int type,
+                            const void *data, data_size_t len )
+{
+    struct save_branch_info *info;
+    struct journal_record *rec;
+    const struct reg_key *k;
+    data_size_t pathlen, size;
+    WCHAR *path;
+    char *ptr;
+
+    if (key->flags & KEY_VOLATILE) return;
+    if (!(info = get_branch_info( key, &pathlen )) || info->compact) return;
+    if (op == JOURNAL_DELETE_KEY && key == info->key)
+    {
+        reset_journal( info );
+        return;
+    }
+
+    size = JOURNAL_ALIGN( sizeof(*rec) + HIVE_ALIGN( pathlen ) + HIVE_ALIGN( namelen ) + HIVE_ALIGN( len ) );
+    if (size > JOURNAL_MAX_BUFFER - info->journal_size)
+    {
+        reset_journal( info );  /* cheaper to rewrite the file */
+        return;
+    }
+    if (info->journal_size + size > info->journal_alloc)
+    {
+        data_size_t alloc = max( info->journal_alloc * 2, info->journal_size + size );
+        char *journal;
+
+        if (alloc < 4096) alloc = 4096;
+        if (!(journal = malloc( alloc )))
+        {
+            reset_journal( info );
+            return;
+        }
+        if (info->journal_size) memcpy( journal, info->journal, info->journal_size );
+        free( info->journal );
+        info->journal = journal;
+        info->journal_alloc = alloc;
+    }
+
+    rec = (struct journal_record *)(info->journal + info->journal_size);
+    memset( rec, 0, size );
+    rec->op      = op;
+    rec->size    = size;
+    rec->modif   = modif;
+    rec->pathlen = pathlen;
+    rec->namelen = namelen;
+    rec->len     = len;
+    rec->type    = type;
+
+    ptr = (char *)(rec + 1);
+    path = (WCHAR *)(ptr + pathlen);
+    for (k = key; k != info->key; k = k->parent)
+    {
+        path -= k->namelen / sizeof(WCHAR);
+        memcpy( path, k->name, k->namelen );
+        if (k->parent != info->key) *--path = '\\';
+    }
+    ptr += HIVE_ALIGN( pathlen );
+    if (namelen) memcpy( ptr, name, namelen );
+    ptr += HIVE_ALIGN( namelen );
+    if (len) memcpy( ptr, data, len );
+    info->journal_size += size;
+}
+
 /* try to grow the array of subkeys; return 1 if OK, 0 on error */
 static int grow_subkeys( struct reg_key *key )
 {
@@ -833,6 +1074,8 @@ static struct reg_key *create_key( struct reg_key *key, const struct unicode_str
         free(key->class);
         if (!(key->class = memdup( class->str, key->classlen ))) key->classlen = 0;
     }
+    journal_change( key, JOURNAL_CREATE_KEY, key->modif, key->class, key->classlen,
+                    key->flags & KEY_SYMLINK, NULL, 0 );
     grab_object( key );
     return key;
 }
@@ -994,6 +1237,7 @@ static int delete_key( struct reg_key *key, int recurse )
     }
 
     if (debug_level > 1) dump_operation( key, NULL, "Delete" );
+    journal_change( key, JOURNAL_DELETE_KEY, current_time, NULL, 0, 0, NULL, 0 );
     free_subkey( parent, index );
     touch_key( parent, REG_NOTIFY_CHANGE_NAME );
     return 0;
@@ -1121,6 +1365,7 @@ static void set_value( struct reg_key *key, const struct unicode_str *name,
     value->len   = len;
     value->data  = ptr;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
+    journal_change( key, JOURNAL_SET_VALUE, key->modif, name->str, name->len, type, data, len );
     if (debug_level > 1) dump_operation( key, value, "Set" );
 }
 
@@ -1212,6 +1457,7 @@ static void delete_value( struct reg_key *key, const struct unicode_str *name )
     for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
     key->last_value--;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
+    journal_change( key, JOURNAL_DELETE_VALUE, key->modif, name->str, name->len, 0, NULL, 0 );
 
     /* try to shrink the array */
     nb_values = key->nb_values;
@@ -1402,6 +1648,10 @@ static int load_global_option( const char *buffer, struct file_load_info *info )
             return 0;
         }
     }
+    else if (!strncmp( buffer, "#generation=", 12 ))
+    {
+        load_generation = strtoul( buffer + 12, NULL, 10 );
+    }
     /* ignore unknown options */
     return 1;
 }
@@ -1643,6 +1893,235 @@ static void load_keys( struct reg_key *key, const char *filename, FILE *f, int p
     free( info.tmp );
 }
 
+/* compare two key or value names the way the sorted arrays are ordered */
+static inline int compare_names( const WCHAR *name1, data_size_t len1, const WCHAR *name2, data_size_t len2 )
+{
+    int res = memicmpW( name1, name2, min( len1, len2 ) / sizeof(WCHAR) );
+    if (!res) res = len1 - len2;
+    return res;
+}
+
+/* check that the hive header describes a consistent file of the given size */
+static int check_hive_header( const struct hive_header *header, size_t size )
+{
+    if (size < sizeof(*header) || memcmp( header->magic, HIVE_MAGIC, sizeof(header->magic) )) return 0;
+    if (header->version != HIVE_VERSION || header->size != size || !header->nb_keys) return 0;
+    if (header->arch > PREFIX_64BIT) return 0;
+    if ((header->keys % sizeof(timeout_t)) || (header->values % sizeof(int)) || (header->pool % sizeof(int)))
+        return 0;
+    if (header->keys > size || (size - header->keys) / sizeof(struct hive_key) < header->nb_keys) return 0;
+    if (header->values > size || (size - header->values) / sizeof(struct hive_value) < header->nb_values)
+        return 0;
+    if (header->pool > size || header->pool_size > size - header->pool) return 0;
+    return 1;
+}
+
+/* get a pointer to a pool entry, or NULL if it doesn't fit in the pool */
+static const void *get_hive_data( const struct hive_header *header, unsigned int offset, data_size_t len )
+{
+    if (offset > header->pool_size || len > header->pool_size - offset) return NULL;
+    return (const char *)header + header->pool + offset;
+}
+
+/* get a name from the pool */
+static int get_hive_name( const struct hive_header *header, unsigned int offset, data_size_t len,
+                          data_size_t max_len, struct unicode_str *name )
+{
+    if ((offset | len) % sizeof(WCHAR) || len > max_len * sizeof(WCHAR)) return 0;
+    if (!(name->str = get_hive_data( header, offset, len ))) return 0;
+    name->len = len;
+    return 1;
+}
+
+/* load the values of a key; a key without values gets them appended in order */
+static int load_hive_values( struct reg_key *key, const struct hive_header *header,
+                             const struct hive_value *hvalues, unsigned int count )
+{
+    struct reg_key_value *value, *new_val;
+    struct unicode_str name;
+    const void *data;
+    void *ptr;
+    unsigned int i;
+    int index, append = (key->last_value == -1);
+
+    if (append && key->nb_values < count)
+    {
+        if (!(new_val = mem_alloc( max( count, (unsigned int)MIN_VALUES ) * sizeof(*new_val) ))) return 0;
+        free( key->values );
+        key->values    = new_val;
+        key->nb_values = max( count, (unsigned int)MIN_VALUES );
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (!get_hive_name( header, hvalues[i].name, hvalues[i].namelen, MAX_VALUE_LEN, &name )) return 0;
+        if (!(data = get_hive_data( header, hvalues[i].data, hvalues[i].len ))) return 0;
+
+        if (append)
+        {
+            if (i && compare_names( key->values[i - 1].name, key->values[i - 1].namelen,
+                                    name.str, name.len ) >= 0) return 0;
+            value = &key->values[i];
+            value->name    = NULL;
+            value->namelen = 0;
+            value->type    = REG_NONE;
+            value->len     = 0;
+            value->data    = NULL;
+            key->last_value = i;
+            if (name.len && !(value->name = memdup( name.str, name.len ))) return 0;
+            value->namelen = name.len;
+        }
+        else if (!(value = find_value( key, &name, &index )) &&
+                 !(value = insert_value( key, &name, index ))) return 0;
+
+        if (!hvalues[i].len) ptr = NULL;
+        else if (!(ptr = memdup( data, hvalues[i].len ))) return 0;
+
+        free( value->data );
+        value->data = ptr;
+        value->len  = hvalues[i].len;
+        value->type = hvalues[i].type;
+    }
+    return 1;
+}
+
+/* load the subkeys of a key; a key without subkeys gets them appended in
+ * order, otherwise they are merged with the existing ones */
+static int load_hive_subkeys( struct reg_key *key, const struct hive_header *header,
+                              const struct hive_key *hkeys, unsigned int count, struct reg_key **keys )
+{
+    struct reg_key *subkey, **new_subkeys;
+    struct unicode_str name;
+    unsigned int i;
+    int index, append = (key->last_subkey == -1);
+
+    if (append && key->nb_subkeys < count)
+    {
+        if (!(new_subkeys = mem_alloc( max( count, (unsigned int)MIN_SUBKEYS ) * sizeof(*new_subkeys) ))) return 0;
+        free( key->subkeys );
+        key->subkeys    = new_subkeys;
+        key->nb_subkeys = max( count, (unsigned int)MIN_SUBKEYS );
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (!get_hive_name( header, hkeys[i].name, hkeys[i].namelen, MAX_NAME_LEN, &name ) || !name.len)
+            return 0;
+
+        if (append)
+        {
+            if (i && compare_names( key->subkeys[i - 1]->name, key->subkeys[i - 1]->namelen,
+                                    name.str, name.len ) >= 0) return 0;
+            if (!(subkey = alloc_key( &name, hkeys[i].modif ))) return 0;
+            subkey->parent = key;
+            key->subkeys[i] = subkey;
+            key->last_subkey = i;
+            if (is_wow6432node( subkey->name, subkey->namelen ) && !is_wow6432node( key->name, key->namelen ))
+                key->flags |= KEY_WOW64;
+        }
+        else if (!(subkey = find_subkey( key, &name, &index )) &&
+                 !(subkey = alloc_subkey( key, &name, index, hkeys[i].modif ))) return 0;
+
+        keys[i] = subkey;
+    }
+    return 1;
+}
+
+/* load a binary hive into a given key */
+static void load_hive( struct reg_key *base, const char *filename, FILE *f )
+{
+    struct hive_header *header;
+    const struct hive_key *hkeys;
+    const struct hive_value *hvalues;
+    struct reg_key **keys = NULL;
+    unsigned int i, next_key = 1, next_value = 0;
+    long size;
+
+    if (fseek( f, 0, SEEK_END ) || (size = ftell( f )) < (long)sizeof(*header) || fseek( f, 0, SEEK_SET ))
+    {
+        set_error( STATUS_NOT_REGISTRY_FILE );
+        return;
+    }
+    if (!(header = alloc_hive_image( size )))
+    {
+        set_error( STATUS_NO_MEMORY );
+        return;
+    }
+    if (fread( header, size, 1, f ) != 1 || !check_hive_header( header, size ))
+    {
+        set_error( STATUS_NOT_REGISTRY_FILE );
+        goto done;
+    }
+
+    load_generation = header->generation;
+    if (header->arch != PREFIX_UNKNOWN)
+    {
+        if (prefix_type == PREFIX_UNKNOWN) prefix_type = header->arch;
+        else if (header->arch != prefix_type)
+        {
+            fprintf( stderr, "%s: mismatched architecture\n", filename ? filename : "registry" );
+            set_error( STATUS_NOT_REGISTRY_FILE );
+            goto done;
+        }
+    }
+
+    if (!(keys = alloc_hive_image( header->nb_keys * sizeof(*keys) )))
+    {
+        set_error( STATUS_NO_MEMORY );
+        goto done;
+    }
+    hkeys   = (const struct hive_key *)((const char *)header + header->keys);
+    hvalues = (const struct hive_value *)((const char *)header + header->values);
+    keys[0] = base;
+
+    /* each key must claim the next range of keys and values, which keeps the tree well-formed */
+    for (i = 0; i < header->nb_keys; i++)
+    {
+        const struct hive_key *hkey = &hkeys[i];
+        struct reg_key *key = keys[i];
+        const void *class;
+
+        if (i >= next_key) break;  /* not a subkey of any key */
+        if (hkey->subkeys != next_key || hkey->nb_subkeys > header->nb_keys - next_key) break;
+        if (hkey->values != next_value || hkey->nb_values > header->nb_values - next_value) break;
+        next_key   += hkey->nb_subkeys;
+        next_value += hkey->nb_values;
+
+        if (hkey->classlen)
+        {
+            if (!(class = get_hive_data( header, hkey->class, hkey->classlen ))) break;
+            free( key->class );
+            if (!(key->class = memdup( class, hkey->classlen ))) key->classlen = 0;
+            else key->classlen = hkey->classlen;
+        }
+        if (hkey->flags & KEY_SYMLINK) key->flags |= KEY_SYMLINK;
+
+        if (!load_hive_values( key, header, hvalues + hkey->values, hkey->nb_values )) break;
+        if (!load_hive_subkeys( key, header, hkeys + hkey->subkeys, hkey->nb_subkeys,
+                                keys + hkey->subkeys )) break;
+    }
+    if (i < header->nb_keys || next_value != header->nb_values)
+    {
+        fprintf( stderr, "%s: corrupted registry hive\n", filename ? filename : "registry" );
+        if (!get_error()) set_error( STATUS_REGISTRY_CORRUPT );
+    }
+
+done:
+    if (keys) free_hive_image( keys );
+    free_hive_image( header );
+}
+
+/* load a registry file in either text or binary hive format */
+static void load_file( struct reg_key *key, const char *filename, FILE *f, int prefix_len, int *binary )
+{
+    char magic[sizeof(HIVE_MAGIC) - 1];
+
+    *binary = (fread( magic, sizeof(magic), 1, f ) == 1 && !memcmp( magic, HIVE_MAGIC, sizeof(magic) ));
+    fseek( f, 0, SEEK_SET );
+    if (*binary) load_hive( key, filename, f );
+    else load_keys( key, filename, f, prefix_len );
+}
+
 /* load a part of the registry from a file */
 static void load_registry( struct reg_key *key, obj_handle_t handle )
 {
@@ -1655,23 +2134,165 @@ static void load_registry( struct reg_key *key, obj_handle_t handle )
     if (fd != -1)
     {
         FILE *f = fdopen( fd, "r" );
+        int binary;
+
         if (f)
         {
-            load_keys( key, NULL, f, -1 );
+            load_file( key, NULL, f, -1, &binary );
             fclose( f );
+            journal_full_save( key );
         }
         else file_set_error();
     }
 }
 
+/* get the name of the journal of a registry file */
+static char *get_journal_path( const char *path )
+{
+    static const char suffix[] = ".journal";
+    char *ret;
+
+    if ((ret = malloc( strlen( path ) + sizeof(suffix) )))
+    {
+        strcpy( ret, path );
+        strcat( ret, suffix );
+    }
+    return ret;
+}
+
+/* find a key from its path in a journal record, optionally creating it */
+static struct reg_key *get_journal_key( struct reg_key *base, const struct unicode_str *path,
+                                        int create, timeout_t modif )
+{
+    struct reg_key *key = base, *subkey;
+    struct unicode_str token;
+    int index;
+
+    token.str = NULL;
+    if (!get_path_token( path, &token )) return NULL;
+    while (token.len)
+    {
+        if (!(subkey = find_subkey( key, &token, &index )))
+        {
+            if (!create || !(subkey = alloc_subkey( key, &token, index, modif ))) return NULL;
+            make_dirty( subkey );
+        }
+        key = subkey;
+        get_path_token( path, &token );
+    }
+    return key;
+}
+
+/* apply a journal record; the branch is not registered yet so nothing gets journaled again */
+static void replay_record( struct reg_key *base, const struct journal_record *rec )
+{
+    struct reg_key *key, *parent;
+    struct unicode_str path, name;
+    const void *data;
+    int index;
+
+    path.str = (const WCHAR *)(rec + 1);
+    path.len = rec->pathlen;
+    name.str = (const WCHAR *)((const char *)path.str + HIVE_ALIGN( rec->pathlen ));
+    name.len = rec->namelen;
+    data = (const char *)name.str + HIVE_ALIGN( rec->namelen );
+
+    switch (rec->op)
+    {
+    case JOURNAL_CREATE_KEY:
+        if (!(key = get_journal_key( base, &path, 1, rec->modif ))) break;
+        key->flags |= rec->type & KEY_SYMLINK;
+        if (name.len && !key->class && (key->class = memdup( name.str, name.len )))
+            key->classlen = name.len;
+        key->modif = rec->modif;
+        break;
+    case JOURNAL_DELETE_KEY:
+        if (!(key = get_journal_key( base, &path, 0, 0 )) || key == base) break;
+        parent = key->parent;
+        if (!delete_key( key, 1 )) parent->modif = rec->modif;
+        break;
+    case JOURNAL_SET_VALUE:
+        if (!(key = get_journal_key( base, &path, 1, rec->modif ))) break;
+        set_value( key, &name, rec->type, data, rec->len );
+        key->modif = rec->modif;
+        break;
+    case JOURNAL_DELETE_VALUE:
+        if (!(key = get_journal_key( base, &path, 0, 0 ))) break;
+        if (find_value( key, &name, &index )) delete_value( key, &name );
+        key->modif = rec->modif;
+        break;
+    }
+}
+
+/* replay the journal of a registry file over the loaded branch, if it
+ * belongs to the given file generation; returns the journal size */
+static size_t replay_journal( struct reg_key *base, const char *filename, unsigned int generation )
+{
+    const struct journal_header *header;
+    const struct journal_record *rec;
+    char *path, *data = NULL;
+    size_t pos = sizeof(*header), end;
+    long size = 0;
+    FILE *f;
+
+    if (!(path = get_journal_path( filename ))) return 0;
+    f = fopen( path, "r" );
+    free( path );
+    if (!f) return 0;
+
+    if (fseek( f, 0, SEEK_END ) || (size = ftell( f )) < (long)sizeof(*header) || fseek( f, 0, SEEK_SET ) ||
+        !(data = alloc_hive_image( size )) || fread( data, size, 1, f ) != 1)
+        goto done;
+
+    end = size;
+    header = (const struct journal_header *)data;
+    if (memcmp( header->magic, JOURNAL_MAGIC, sizeof(header->magic) ) || header->version != JOURNAL_VERSION)
+    {
+        fprintf( stderr, "%s: ignoring invalid registry journal\n", filename );
+        size = 0;
+        goto done;
+    }
+    if (header->generation != generation)
+    {
+        /* left behind by a crash after the file was rewritten, it is already in the file */
+        if (debug_level) fprintf( stderr, "%s: ignoring stale registry journal\n", filename );
+        size = 0;
+        goto done;
+    }
+
+    /* a crash can leave a partial record at the end, stop at the first one that does not check out */
+    while (pos + sizeof(*rec) <= end)
+    {
+        rec = (const struct journal_record *)(data + pos);
+        if (rec->size > end - pos || rec->pathlen > rec->size || rec->namelen > rec->size ||
+            rec->len > rec->size || ((rec->pathlen | rec->namelen) & 1) ||
+            rec->size != JOURNAL_ALIGN( sizeof(*rec) + HIVE_ALIGN( rec->pathlen ) +
+                                        HIVE_ALIGN( rec->namelen ) + HIVE_ALIGN( rec->len ) ))
+            break;
+        replay_record( base, rec );
+        pos += rec->size;
+    }
+    if (pos < end) fprintf( stderr, "%s: registry journal is truncated\n", filename );
+    clear_error();
+
+done:
+    if (data) free_hive_image( data );
+    fclose( f );
+    return size > 0 ? size : 0;
+}
+
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct reg_key *key )
 {
     FILE *f;
+    int binary = 0;
+    size_t file_size = 0, journal_size;
 
+    load_generation = 0;
     if ((f = fopen( filename, "r" )))
     {
-        load_keys( key, filename, f, 0 );
+        load_file( key, filename, f, 0, &binary );
+        file_size = ftell( f );
         fclose( f );
         if (get_error() == STATUS_NOT_REGISTRY_FILE)
         {
@@ -1679,10 +2300,16 @@ static int load_init_registry_from_file( const char *filename, struct reg_key *k
             return 1;
         }
     }
+    journal_size = replay_journal( key, filename, load_generation );
 
     assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
 
     save_branch_info[save_branch_count].path = filename;
+    save_branch_info[save_branch_count].binary = binary;
+    save_branch_info[save_branch_count].file_size = file_size;
+    save_branch_info[save_branch_count].generation = load_generation;
+    save_branch_info[save_branch_count].journal_file = journal_size;
+    save_branch_info[save_branch_count].compact = (journal_size != 0);  /* fold it in on the next save */
     save_branch_info[save_branch_count++].key = (struct reg_key *)grab_object( key );
     make_object_static( &key->obj );
     return (f != NULL);
@@ -1852,6 +2479,7 @@ void uk_init_registry(const char __user *config_dir, int len)
     release_object( hkcu );
 
     /* start the periodic save timer */
+    init_registry_saver();
     set_periodic_save_timer();
 }
 #endif
@@ -1977,20 +2605,289 @@ static void save_registry( struct reg_key *key, obj_handle_t handle )
     }
 }
 
-/* save a registry branch to a file */
-static int save_branch( struct reg_key *key, const char *path )
+/* count the keys, values and pool space needed to save a branch as a hive */
+static void get_hive_size( const struct reg_key *key, unsigned int *nb_keys, unsigned int *nb_values,
+                           data_size_t *pool_size )
 {
-    struct stat st;
-    char *p, *tmp = NULL;
-    int fd, count = 0, ret = 0;
+    int i;
+
+    (*nb_keys)++;
+    *pool_size += HIVE_ALIGN( key->namelen ) + HIVE_ALIGN( key->classlen );
+    for (i = 0; i <= key->last_value; i++)
+        *pool_size += HIVE_ALIGN( key->values[i].namelen ) + HIVE_ALIGN( key->values[i].len );
+    *nb_values += key->last_value + 1;
+    for (i = 0; i <= key->last_subkey; i++)
+        if (!(key->subkeys[i]->flags & KEY_VOLATILE))
+            get_hive_size( key->subkeys[i], nb_keys, nb_values, pool_size );
+}
+
+/* copy a name or a value data into the pool and return its offset */
+static unsigned int add_hive_data( char *pool, data_size_t *pos, const void *data, data_size_t len )
+{
+    unsigned int offset = *pos;
+
+    if (len) memcpy( pool + offset, data, len );
+    *pos += HIVE_ALIGN( len );
+    return offset;
+}
+
+/* build the binary hive image of a registry branch; this only copies memory,
+ * so it is also the snapshot the periodic save works from */
+static struct hive_header *build_hive( const struct reg_key *base )
+{
+    struct hive_header *header;
+    struct hive_key *hkeys;
+    struct hive_value *hvalues;
+    const struct reg_key **order;
+    unsigned int i, nb_keys = 0, nb_values = 0, next_key = 1, next_value = 0;
+    data_size_t pool_size = 0, pool_pos = 0;
+    size_t size;
+    char *pool;
+    int j;
+
+    get_hive_size( base, &nb_keys, &nb_values, &pool_size );
+    pool_size -= HIVE_ALIGN( base->namelen );  /* the base key name is not saved */
+    size = sizeof(*header) + nb_keys * sizeof(*hkeys) + nb_values * sizeof(*hvalues) + pool_size;
+
+    if (!(header = alloc_hive_image( size ))) return NULL;
+    if (!(order = alloc_hive_image( nb_keys * sizeof(*order) )))
+    {
+        free_hive_image( header );
+        return NULL;
+    }
+    memset( header, 0, size );
+
+    memcpy( header->magic, HIVE_MAGIC, sizeof(header->magic) );
+    header->version   = HIVE_VERSION;
+    header->arch      = prefix_type;
+    header->size      = size;
+    header->nb_keys   = nb_keys;
+    header->nb_values = nb_values;
+    header->keys      = sizeof(*header);
+    header->values    = header->keys + nb_keys * sizeof(*hkeys);
+    header->pool      = header->values + nb_values * sizeof(*hvalues);
+    header->pool_size = pool_size;
+    hkeys   = (struct hive_key *)((char *)header + header->keys);
+    hvalues = (struct hive_value *)((char *)header + header->values);
+    pool    = (char *)header + header->pool;
+
+    /* breadth first, the keys array doubles as the queue of keys to save */
+    order[0] = base;
+    for (i = 0; i < nb_keys; i++)
+    {
+        const struct reg_key *key = order[i];
+        struct hive_key *hkey = &hkeys[i];
+
+        hkey->modif = key->modif;
+        hkey->flags = key->flags & KEY_SYMLINK;
+        if (i)
+        {
+            hkey->name    = add_hive_data( pool, &pool_pos, key->name, key->namelen );
+            hkey->namelen = key->namelen;
+        }
+        hkey->class    = add_hive_data( pool, &pool_pos, key->class, key->classlen );
+        hkey->classlen = key->classlen;
+
+        hkey->values    = next_value;
+        hkey->nb_values = key->last_value + 1;
+        for (j = 0; j <= key->last_value; j++)
+        {
+            const struct reg_key_value *value = &key->values[j];
+            struct hive_value *hvalue = &hvalues[next_value++];
+
+            hvalue->name    = add_hive_data( pool, &pool_pos, value->name, value->namelen );
+            hvalue->namelen = value->namelen;
+            hvalue->type    = value->type;
+            hvalue->data    = add_hive_data( pool, &pool_pos, value->data, value->len );
+            hvalue->len     = value->len;
+        }
+
+        hkey->subkeys = next_key;
+        for (j = 0; j <= key->last_subkey; j++)
+            if (!(key->subkeys[j]->flags & KEY_VOLATILE)) order[next_key++] = key->subkeys[j];
+        hkey->nb_subkeys = next_key - hkey->subkeys;
+    }
+    free_hive_image( order );
+    return header;
+}
+
+/* get the full path of a key, as dump_path prints it from the root */
+static WCHAR *get_key_path( const struct reg_key *key, data_size_t *len )
+{
+    const struct reg_key *k;
+    WCHAR *path, *p;
+
+    *len = key->namelen;
+    for (k = key->parent; k; k = k->parent) *len += k->namelen + sizeof(WCHAR);
+    if (!(path = mem_alloc( *len + sizeof(WCHAR) ))) return NULL;
+
+    p = (WCHAR *)((char *)path + *len);
+    for (k = key; k; k = k->parent)
+    {
+        p -= k->namelen / sizeof(WCHAR);
+        memcpy( p, k->name, k->namelen );
+        if (k->parent) *--p = '\\';
+    }
+    return path;
+}
+
+/* a snapshot of a registry branch on its way to disk */
+struct save_work
+{
+#ifdef CONFIG_UNIFIED_KERNEL
+    struct work_struct       work;
+#endif
+    struct save_branch_info *info;       /* branch being saved */
+    struct hive_header      *image;      /* snapshot of the branch, NULL to append to the journal */
+    WCHAR                   *base_path;  /* full path of the branch key */
+    data_size_t              base_len;   /* length of the path in bytes */
+    int                      binary;     /* save as a binary hive */
+    char                    *journal;    /* journal records to append */
+    data_size_t              journal_size; /* size of the records */
+    unsigned int             generation; /* generation of the file the records apply to */
+};
+
+/* path of a key in a hive image, relative to the base key */
+struct hive_path
+{
+    const struct hive_path *parent;  /* NULL for a subkey of the base key */
+    const struct hive_key  *key;
+};
+
+static void dump_hive_path( const struct hive_header *header, const struct hive_path *path, FILE *f )
+{
+    if (path->parent)
+    {
+        dump_hive_path( header, path->parent, f );
+        fprintf( f, "\\\\" );
+    }
+    dump_strW( get_hive_data( header, path->key->name, path->key->namelen ),
+               path->key->namelen / sizeof(WCHAR), f, "[]" );
+}
+
+/* save a key of a hive image and all its subkeys to a text file, like save_subkeys */
+static void save_hive_subkeys( const struct hive_header *header, const struct hive_key *key,
+                               const struct hive_path *path, FILE *f )
+{
+    const struct hive_key *hkeys = (const struct hive_key *)((const char *)header + header->keys);
+    const struct hive_value *hvalues = (const struct hive_value *)((const char *)header + header->values);
+    struct reg_key_value value;
+    struct hive_path subpath;
+    unsigned int i;
+
+    if (key->nb_values || !key->nb_subkeys || key->classlen || (key->flags & KEY_SYMLINK))
+    {
+        fprintf( f, "\n[" );
+        if (path) dump_hive_path( header, path, f );
+        fprintf( f, "] %u\n", get_modif_seconds( key->modif ) );
+        if (key->classlen)
+        {
+            fprintf( f, "#class=\"" );
+            dump_strW( get_hive_data( header, key->class, key->classlen ),
+                       key->classlen / sizeof(WCHAR), f, "\"\"" );
+            fprintf( f, "\"\n" );
+        }
+        if (key->flags & KEY_SYMLINK) fputs( "#link\n", f );
+        for (i = 0; i < key->nb_values; i++)
+        {
+            const struct hive_value *hvalue = &hvalues[key->values + i];
+
+            value.name    = (WCHAR *)get_hive_data( header, hvalue->name, hvalue->namelen );
+            value.namelen = hvalue->namelen;
+            value.type    = hvalue->type;
+            value.len     = hvalue->len;
+            value.data    = (void *)get_hive_data( header, hvalue->data, hvalue->len );
+            dump_value( &value, f );
+        }
+    }
+
+    subpath.parent = path;
+    for (i = 0; i < key->nb_subkeys; i++)
+    {
+        subpath.key = &hkeys[key->subkeys + i];
+        save_hive_subkeys( header, subpath.key, &subpath, f );
+    }
+}
+
+/* save a snapshot to a text file, like save_all_subkeys */
+static void save_hive_text( const struct save_work *work, FILE *f )
+{
+    const struct hive_header *header = work->image;
+
+    fprintf( f, "WINE REGISTRY Version 2\n" );
+    fprintf( f, ";; All keys relative to " );
+    dump_strW( work->base_path, work->base_len / sizeof(WCHAR), f, "[]" );
+    fprintf( f, "\n" );
+    switch (header->arch)
+    {
+    case PREFIX_32BIT:
+        fprintf( f, "\n#arch=win32\n" );
+        break;
+    case PREFIX_64BIT:
+        fprintf( f, "\n#arch=win64\n" );
+        break;
+    default:
+        break;
+    }
+    if (header->generation) fprintf( f, "#generation=%u\n", header->generation );
+    save_hive_subkeys( header, (const struct hive_key *)((const char *)header + header->keys), NULL, f );
+}
+
+/* write a snapshot to an open file in the requested format */
+static int write_snapshot( int fd, const struct save_work *work )
+{
+    const struct hive_header *header = work->image;
+    size_t pos;
+    ssize_t res;
     FILE *f;
 
-    if (!(key->flags & KEY_DIRTY))
+    if (work->binary)
     {
-        if (debug_level > 1) dump_operation( key, NULL, "Not saving clean" );
-        return 1;
+        for (pos = 0; pos < header->size; pos += res)
+            if ((res = write( fd, (const char *)header + pos, header->size - pos )) <= 0) break;
+        return pos == header->size;
     }
 
+#ifndef CONFIG_UNIFIED_KERNEL
+    /* fclose closes the descriptor of a standard FILE, the caller still needs it */
+    if ((fd = dup( fd )) == -1) return 0;
+#endif
+    if (!(f = fdopen( fd, "w" )))
+    {
+#ifndef CONFIG_UNIFIED_KERNEL
+        close( fd );
+#endif
+        return 0;
+    }
+    save_hive_text( work, f );
+    return !fclose( f );
+}
+
+/* flush the directory holding a file, to make a rename in it durable */
+static void sync_parent_dir( char *path )
+{
+    char *p = strrchr( path, '/' );
+    int fd;
+
+    if (p) *p = 0;
+    if ((fd = open( p ? (p == path ? "/" : path) : ".", O_RDONLY )) != -1)
+    {
+        fsync( fd );
+        close( fd );
+    }
+    if (p) *p = '/';
+}
+
+/* write a snapshot to the branch file, through a temp file renamed over it
+ * once the data is on disk; returns the number of bytes written, 0 on error */
+static size_t write_branch( const struct save_work *work )
+{
+    const char *path = work->info->path;
+    struct stat st;
+    char *p, *tmp = NULL;
+    int fd, count = 0, ret = 0;
+    size_t size = 0;
+
     /* test the file type */
 
     if ((fd = open( path, O_WRONLY )) != -1)
@@ -2022,21 +2919,9 @@ static int save_branch( struct reg_key *key, const char *path )
     /* now save to it */
 
  save:
-    if (!(f = fdopen( fd, "w" )))
-    {
-        if (tmp) unlink( tmp );
-        close( fd );
-        goto done;
-    }
-
-    if (debug_level > 1)
-    {
-        fprintf( stderr, "%s: ", path );
-        dump_operation( key, NULL, "saving" );
-    }
-
-    save_all_subkeys( key, f );
-    ret = !fclose(f);
+    ret = write_snapshot( fd, work ) && (!tmp || !fsync( fd ));
+    if (ret && !fstat( fd, &st )) size = st.st_size;
+    close( fd );
 
     if (tmp)
     {
@@ -2046,22 +2931,285 @@ static int save_branch( struct reg_key *key, const char *path )
         chmod( path, 0666 );
 #endif
         if (!ret) unlink( tmp );
+        /* the old journal must not go away before the rename is on disk */
+        else sync_parent_dir( tmp );
+    }
+
+    /* the file now holds everything the journal did */
+    if (ret && (p = get_journal_path( path )))
+    {
+        unlink( p );
+        free( p );
     }
 
 done:
     free( tmp );
-    if (ret) make_clean( key );
-    return ret;
+    return ret ? (size ? size : 1) : 0;
+}
+
+/* append journal records to the journal file of a branch, starting it over
+ * if it belongs to an older generation; returns the number of bytes
+ * written, 0 on error */
+static size_t write_journal( const struct save_work *work )
+{
+    struct journal_header header, old;
+    struct stat st;
+    char *path;
+    size_t pos = 0;
+    ssize_t res;
+    int fd, ret = 0;
+
+    memcpy( header.magic, JOURNAL_MAGIC, sizeof(header.magic) );
+    header.version    = JOURNAL_VERSION;
+    header.generation = work->generation;
+
+    if (!(path = get_journal_path( work->info->path ))) return 0;
+    if ((fd = open( path, O_RDWR | O_APPEND | O_CREAT, 0666 )) != -1)
+    {
+        ret = !fstat( fd, &st );
+        if (ret && st.st_size && (pread( fd, &old, sizeof(old), 0 ) != sizeof(old) ||
+                                  memcmp( &old, &header, sizeof(header) )))
+        {
+            /* left over from an older generation, the file already holds it */
+            ret = !ftruncate( fd, 0 );
+            st.st_size = 0;
+        }
+        if (ret && !st.st_size) ret = (write( fd, &header, sizeof(header) ) == sizeof(header));
+        for (pos = 0; ret && pos < work->journal_size; pos += res)
+            if ((res = write( fd, work->journal + pos, work->journal_size - pos )) <= 0) break;
+        ret = ret && pos == work->journal_size && !fsync( fd );
+        close( fd );
+#ifdef CONFIG_UNIFIED_KERNEL
+        chmod( path, 0666 );
+#endif
+    }
+    free( path );
+    return ret ? work->journal_size : 0;
+}
+
+static size_t write_work( const struct save_work *work )
+{
+    return work->image ? write_branch( work ) : write_journal( work );
+}
+
+#ifdef CONFIG_UNIFIED_KERNEL
+static struct workqueue_struct *registry_wq;  /* writes the snapshots out, in order */
+
+/* registry save statistics, in /sys/kernel/debug/unifiedkernel/registry */
+static struct
+{
+    unsigned long long saves;         /* snapshots written */
+    unsigned long long failures;      /* snapshots or journal records that could not be written */
+    unsigned long long bytes;         /* bytes written */
+    unsigned long long last_bytes;    /* size of the last file written */
+    unsigned long long journal_saves; /* journal appends */
+    unsigned long long journal_bytes; /* bytes appended to the journals */
+    unsigned long long snapshot_ns;   /* time spent taking snapshots, with uk_lock held */
+    unsigned long long write_ns;      /* time spent writing snapshots and journals out */
+    unsigned long long max_write_ns;  /* longest write */
+} save_stats;
+
+static inline unsigned long long save_time(void)
+{
+    return ktime_to_ns( ktime_get() );
+}
+#else
+static inline unsigned long long save_time(void)
+{
+    return 0;
 }
+#endif
+
+/* account for a written snapshot and release it */
+static void finish_branch_save( struct save_work *work, size_t size, unsigned long long ns )
+{
+    struct save_branch_info *info = work->info;
 
 #ifdef CONFIG_UNIFIED_KERNEL
+    if (!size) save_stats.failures++;
+    else if (work->image)
+    {
+        save_stats.saves++;
+        save_stats.bytes += size;
+        save_stats.last_bytes = size;
+    }
+    else
+    {
+        save_stats.journal_saves++;
+        save_stats.journal_bytes += size;
+    }
+    save_stats.write_ns += ns;
+    if (ns > save_stats.max_write_ns) save_stats.max_write_ns = ns;
+#endif
+    if (size && work->image)
+    {
+        info->binary = work->binary;
+        info->file_size = size;
+    }
+    else if (!size)
+    {
+        fprintf( stderr, "wineserver: could not save registry branch to %s", info->path );
+        perror( " " );
+        info->failed = 1;
+    }
+#ifdef CONFIG_UNIFIED_KERNEL
+    smp_wmb();  /* pairs with smp_rmb in save_branch */
+#endif
+    info->saving = 0;
+
+    if (work->image) free_hive_image( work->image );
+    free( work->base_path );
+    free( work->journal );
+    free( work );
+}
+
+#ifdef CONFIG_UNIFIED_KERNEL
+static void save_work_func( struct work_struct *ws )
+{
+    struct save_work *work = container_of( ws, struct save_work, work );
+    unsigned long long start = save_time();
+    size_t size = write_work( work );
+
+    finish_branch_save( work, size, save_time() - start );
+}
+#endif
+
+/* have the changes to a registry branch written out, by appending them to
+ * the journal or from a snapshot of the whole branch once the journal has
+ * grown too much; only the snapshot is done here, the files are written by
+ * registry_wq; returns 0 if the snapshot could not be taken */
+static int save_branch( struct save_branch_info *info )
+{
+    struct reg_key *key = info->key;
+    struct save_work *work;
+    unsigned long long start;
+    int binary;
+
+    if (info->saving) return 1;  /* the next period will save the new changes */
+#ifdef CONFIG_UNIFIED_KERNEL
+    smp_rmb();
+#endif
+
+    binary = reg_format ? (reg_format == 2) : info->binary;
+    if (!(key->flags & KEY_DIRTY) && !info->failed && !info->compact && binary == info->binary)
+    {
+        if (debug_level > 1) dump_operation( key, NULL, "Not saving clean" );
+        return 1;
+    }
+
+    if (debug_level > 1)
+    {
+        fprintf( stderr, "%s: ", info->path );
+        dump_operation( key, NULL, "saving" );
+    }
+
+    start = save_time();
+    if (!(work = mem_alloc( sizeof(*work) ))) return 0;
+    memset( work, 0, sizeof(*work) );
+    work->info   = info;
+    work->binary = binary;
+    work->generation = info->generation;
+
+    if (!info->compact && !info->failed && binary == info->binary &&
+        info->journal_file + info->journal_size < max( info->file_size / 2, (size_t)JOURNAL_MIN_COMPACT ))
+    {
+        work->journal      = info->journal;
+        work->journal_size = info->journal_size;
+        info->journal_file += info->journal_size;
+        info->journal = NULL;
+        info->journal_size = info->journal_alloc = 0;
+        if (!work->journal_size)
+        {
+            make_clean( key );
+            free( work );
+            return 1;
+        }
+    }
+    else
+    {
+        if (!(work->image = build_hive( key )) || !(work->base_path = get_key_path( key, &work->base_len )))
+        {
+            if (work->image) free_hive_image( work->image );
+            free( work );
+            return 0;
+        }
+        /* the snapshot holds the journaled changes too, and starts a new generation */
+        work->image->generation = work->generation = ++info->generation;
+        reset_journal( info );
+        info->compact = 0;
+        info->journal_file = 0;
+    }
+
+    /* the snapshot or the journal holds all the changes so far; if writing
+     * fails, info->failed makes the next period save the whole branch */
+    make_clean( key );
+    info->failed = 0;
+    info->saving = 1;
+
+#ifdef CONFIG_UNIFIED_KERNEL
+    save_stats.snapshot_ns += save_time() - start;
+    if (registry_wq)
+    {
+        INIT_WORK( &work->work, save_work_func );
+        queue_work( registry_wq, &work->work );
+        return 1;
+    }
+#endif
+    start = save_time();
+    finish_branch_save( work, write_work( work ), save_time() - start );
+    return 1;  /* write errors are reported by finish_branch_save */
+}
+
+#ifdef CONFIG_UNIFIED_KERNEL
+static int registry_stats_show( struct seq_file *m, void *v )
+{
+    seq_printf( m, "saves         %llu\n", save_stats.saves );
+    seq_printf( m, "failures      %llu\n", save_stats.failures );
+    seq_printf( m, "bytes         %llu\n", save_stats.bytes );
+    seq_printf( m, "last_bytes    %llu\n", save_stats.last_bytes );
+    seq_printf( m, "journal_saves %llu\n", save_stats.journal_saves );
+    seq_printf( m, "journal_bytes %llu\n", save_stats.journal_bytes );
+    seq_printf( m, "snapshot_ns   %llu\n", save_stats.snapshot_ns );
+    seq_printf( m, "write_ns      %llu\n", save_stats.write_ns );
+    seq_printf( m, "max_write_ns  %llu\n", save_stats.max_write_ns );
+    return 0;
+}
+
+static int registry_stats_open( struct inode *inode, struct file *file )
+{
+    return single_open( file, registry_stats_show, NULL );
+}
+
+static const struct file_operations registry_stats_fops =
+{
+    .owner   = THIS_MODULE,
+    .open    = registry_stats_open,
+    .read    = seq_read,
+    .llseek  = seq_lseek,
+    .release = single_release,
+};
+
+/* start the registry writer; saves are done synchronously without it */
+static void init_registry_saver(void)
+{
+    registry_wq = alloc_ordered_workqueue( "uk_registry", 0 );
+    add_stats_file( "registry", &registry_stats_fops );
+}
+
+/* stop the registry writer, once flush_registry has run */
+void release_registry_saver(void)
+{
+    if (registry_wq) destroy_workqueue( registry_wq );
+    registry_wq = NULL;
+}
+
 static void periodic_save( void *arg )
 {
     int i;
 
     save_timeout_user = NULL;
     for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].path );
+        save_branch( &save_branch_info[i] );
 
     set_periodic_save_timer();
 }
@@ -2074,7 +3222,7 @@ static void periodic_save( void *arg )
     if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
     for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].path );
+        save_branch( &save_branch_info[i] );
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
     set_periodic_save_timer();
 }
@@ -2094,10 +3242,13 @@ void flush_registry(void)
 
 #ifndef CONFIG_UNIFIED_KERNEL
     if (fchdir( config_dir_fd ) == -1) return;
+#else
+    /* let the snapshots in flight finish, then write out the latest changes */
+    if (registry_wq) flush_workqueue( registry_wq );
 #endif
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].path ))
+        if (!save_branch( &save_branch_info[i] ))
         {
             fprintf( stderr, "wineserver: could not save registry branch to %s",
                      save_branch_info[i].path );
@@ -2106,6 +3257,8 @@ void flush_registry(void)
     }
 #ifndef CONFIG_UNIFIED_KERNEL
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
+#else
+    if (registry_wq) flush_workqueue( registry_wq );
 #endif
 }
 
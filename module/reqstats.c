@@ -0,0 +1,206 @@
+/*
+ * reqstats.c
+ *
+ * Per-request counters and latency histograms
+ *
+ * Copyright (C) 2006  Insigma Co., Ltd
+ *
+ * This software has been developed while working on the Linux Unified Kernel
+ * project (http://www.longene.org) in the Insigma Research Institute,  
+ * which is a subdivision of Insigma Co., Ltd (http://www.insigma.com.cn).
+ * 
+ * The project is sponsored by Insigma Co., Ltd.
+ *
+ * The authors can be reached at linux@insigma.com.cn.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of  the GNU General  Public License as published by the
+ * Free Software Foundation; either version 2 of the  License, or (at your
+ * option) any later version.
+ */
+
+/*
+ * The counters are always on. Each cpu owns a copy of the table, updated under
+ * that cpu's stats lock and summed up when /sys/kernel/debug/unifiedkernel/requests
+ * is read. Writing anything to that file resets them. The lock is only ever
+ * contended by a reader or a reset, never by another request.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/smp.h>
+#include <linux/cpumask.h>
+#include <linux/log2.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "winternl.h"
+
+#include "request.h"
+
+#define REQ_STATS_BUCKETS 32  /* log2 of nanoseconds, the last bucket catches the rest */
+
+struct req_stats
+{
+    unsigned long long count;       /* number of calls */
+    unsigned long long handler_ns;  /* total time spent in the handler */
+    unsigned long long lock_ns;     /* total time spent waiting for uk_lock */
+    unsigned long long bytes_in;    /* request data copied in */
+    unsigned long long bytes_out;   /* reply data copied out */
+    unsigned long long wakeups;     /* threads woken up by the handler */
+    unsigned int       hist[REQ_STATS_BUCKETS];  /* handler latency histogram */
+};
+
+extern const char *get_req_name( enum request req );
+
+static struct req_stats **cpu_stats;  /* per-cpu tables of REQ_NB_REQUESTS entries */
+static DEFINE_PER_CPU(spinlock_t, stats_lock);  /* protects the table of each cpu */
+static struct dentry *stats_dir;
+
+static inline unsigned int latency_bucket( unsigned long long ns )
+{
+    unsigned int bucket;
+
+    if (!ns) return 0;
+    bucket = ilog2( ns ) + 1;
+    return min( bucket, (unsigned int)REQ_STATS_BUCKETS - 1 );
+}
+
+/* record a request; called by the dispatcher once the handler has returned */
+void account_request( enum request req, unsigned long long lock_ns, unsigned long long handler_ns,
+                      data_size_t bytes_in, data_size_t bytes_out, unsigned int wakeups )
+{
+    struct req_stats *stats;
+    int cpu;
+
+    if (!cpu_stats || req >= REQ_NB_REQUESTS) return;
+
+    cpu = get_cpu();
+    spin_lock( per_cpu_ptr( &stats_lock, cpu ));
+    stats = &cpu_stats[cpu][req];
+    stats->count++;
+    stats->handler_ns += handler_ns;
+    stats->lock_ns    += lock_ns;
+    stats->bytes_in   += bytes_in;
+    stats->bytes_out  += bytes_out;
+    stats->wakeups    += wakeups;
+    stats->hist[latency_bucket( handler_ns )]++;
+    spin_unlock( per_cpu_ptr( &stats_lock, cpu ));
+    put_cpu();
+}
+
+static int req_stats_show( struct seq_file *m, void *v )
+{
+    struct req_stats total;
+    int req, cpu, i, last;
+
+    seq_printf( m, "%-36s %12s %14s %14s %12s %12s %10s  handler log2(ns) histogram\n",
+                "request", "count", "handler_ns", "lock_ns", "bytes_in", "bytes_out", "wakeups" );
+
+    for (req = 0; req < REQ_NB_REQUESTS; req++)
+    {
+        memset( &total, 0, sizeof(total) );
+        for_each_possible_cpu( cpu )
+        {
+            const struct req_stats *stats = &cpu_stats[cpu][req];
+
+            spin_lock( per_cpu_ptr( &stats_lock, cpu ));
+            total.count      += stats->count;
+            total.handler_ns += stats->handler_ns;
+            total.lock_ns    += stats->lock_ns;
+            total.bytes_in   += stats->bytes_in;
+            total.bytes_out  += stats->bytes_out;
+            total.wakeups    += stats->wakeups;
+            for (i = 0; i < REQ_STATS_BUCKETS; i++) total.hist[i] += stats->hist[i];
+            spin_unlock( per_cpu_ptr( &stats_lock, cpu ));
+        }
+        if (!total.count) continue;
+
+        seq_printf( m, "%-36s %12llu %14llu %14llu %12llu %12llu %10llu ",
+                    get_req_name( req ), total.count, total.handler_ns, total.lock_ns,
+                    total.bytes_in, total.bytes_out, total.wakeups );
+        for (last = REQ_STATS_BUCKETS - 1; last > 0; last--) if (total.hist[last]) break;
+        for (i = 0; i <= last; i++) seq_printf( m, " %u", total.hist[i] );
+        seq_putc( m, '\n' );
+    }
+    return 0;
+}
+
+static int req_stats_open( struct inode *inode, struct file *file )
+{
+    return single_open( file, req_stats_show, NULL );
+}
+
+/* any write resets the counters */
+static ssize_t req_stats_write( struct file *file, const char __user *buf, size_t len, loff_t *ppos )
+{
+    int cpu;
+
+    for_each_possible_cpu( cpu )
+    {
+        spin_lock( per_cpu_ptr( &stats_lock, cpu ));
+        memset( cpu_stats[cpu], 0, REQ_NB_REQUESTS * sizeof(struct req_stats) );
+        spin_unlock( per_cpu_ptr( &stats_lock, cpu ));
+    }
+    return len;
+}
+
+static const struct file_operations req_stats_fops =
+{
+    .owner   = THIS_MODULE,
+    .open    = req_stats_open,
+    .read    = seq_read,
+    .write   = req_stats_write,
+    .llseek  = seq_lseek,
+    .release = single_release,
+};
+
+void init_req_stats(void)
+{
+    struct req_stats **stats;
+    int cpu;
+
+    if (!(stats = kcalloc( nr_cpu_ids, sizeof(*stats), GFP_KERNEL ))) return;
+    for_each_possible_cpu( cpu )
+    {
+        spin_lock_init( per_cpu_ptr( &stats_lock, cpu ));
+        if (!(stats[cpu] = kzalloc_node( REQ_NB_REQUESTS * sizeof(struct req_stats),
+                                         GFP_KERNEL, cpu_to_node( cpu ) )))
+            goto failed;
+    }
+    cpu_stats = stats;
+
+    /* the counters keep running even without debugfs */
+    stats_dir = debugfs_create_dir( "unifiedkernel", NULL );
+    if (!IS_ERR_OR_NULL( stats_dir ))
+        debugfs_create_file( "requests", 0600, stats_dir, NULL, &req_stats_fops );
+    return;
+
+failed:
+    for_each_possible_cpu( cpu ) kfree( stats[cpu] );
+    kfree( stats );
+}
+
+/* add a file for another module's statistics next to the request counters */
+void add_stats_file( const char *name, const struct file_operations *fops )
+{
+    if (!IS_ERR_OR_NULL( stats_dir )) debugfs_create_file( name, 0600, stats_dir, NULL, fops );
+}
+
+void release_req_stats(void)
+{
+    struct req_stats **stats = cpu_stats;
+    int cpu;
+
+    if (!IS_ERR_OR_NULL( stats_dir )) debugfs_remove_recursive( stats_dir );
+    stats_dir = NULL;
+    if (!stats) return;
+    cpu_stats = NULL;
+    for_each_possible_cpu( cpu ) kfree( stats[cpu] );
+    kfree( stats );
+}
@@ -88,6 +88,9 @@
 #include <linux/cdev.h>
 #include <linux/slab.h>
 #include <linux/device.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
 #endif
 
 /* Some versions of glibc don't define this */
@@ -178,6 +181,132 @@ void fatal_error( const char *err, ... )
     exit(1);
 }
 
+#ifdef CONFIG_UNIFIED_KERNEL
+/* request and reply data buffers
+ *
+ * Data up to REQ_BUFFER_SIZE uses buffers preallocated once per thread, up
+ * to REQ_CACHE_SIZE it comes from req_data_cache, and only larger data is
+ * malloc'ed.  Data passed with set_reply_data_ptr() is always malloc'ed
+ * and is freed as before. */
+
+#define REQ_BUFFER_SIZE   512
+#define REQ_CACHE_SIZE    4096
+
+static struct kmem_cache *req_data_cache;
+
+/* allocations avoided (buffer and cache) and done (heap) by the above */
+static atomic_t req_buffer_allocs = ATOMIC_INIT(0);
+static atomic_t req_cache_allocs = ATOMIC_INIT(0);
+static atomic_t req_heap_allocs = ATOMIC_INIT(0);
+
+static void *alloc_req_buffer( void **buffer, int *cached, data_size_t size )
+{
+    void *ptr;
+
+    *cached = 0;
+    if (size <= REQ_BUFFER_SIZE)
+    {
+        if (*buffer || (*buffer = kmalloc( REQ_BUFFER_SIZE, GFP_KERNEL )))
+        {
+            atomic_inc( &req_buffer_allocs );
+            return *buffer;
+        }
+    }
+    else if (size <= REQ_CACHE_SIZE && req_data_cache)
+    {
+        if ((ptr = kmem_cache_alloc( req_data_cache, GFP_KERNEL )))
+        {
+            atomic_inc( &req_cache_allocs );
+            *cached = 1;
+            return ptr;
+        }
+    }
+    atomic_inc( &req_heap_allocs );
+    return mem_alloc( size );
+}
+
+static void free_req_buffer( void *buffer, int cached, void *ptr )
+{
+    if (!ptr || ptr == buffer) return;
+    if (cached) kmem_cache_free( req_data_cache, ptr );
+    else free( ptr );
+}
+
+/* allocate the request data of the current request */
+static void *alloc_req_data( struct thread *thread, data_size_t size )
+{
+    return thread->req_data = alloc_req_buffer( &thread->req_buffer, &thread->req_data_cached, size );
+}
+
+/* allocate the reply data */
+void *set_reply_data_size( data_size_t size )
+{
+    struct thread *thread = current_thread;
+
+    assert( size <= get_reply_max_size() );
+    if (size && !(thread->reply_data = alloc_req_buffer( &thread->reply_buffer,
+                                                         &thread->reply_data_cached, size ))) size = 0;
+    thread->reply_size = size;
+    return thread->reply_data;
+}
+
+/* free the request and reply data of the last request */
+static void free_req_buffers( struct thread *thread )
+{
+    free_req_buffer( thread->req_buffer, thread->req_data_cached, thread->req_data );
+    thread->req_data = NULL;
+    thread->req_data_cached = 0;
+
+    free_req_buffer( thread->reply_buffer, thread->reply_data_cached, thread->reply_data );
+    thread->reply_data = NULL;
+    thread->reply_data_cached = 0;
+}
+
+/* free all the request buffers of a dying thread */
+void destroy_req_buffers( struct thread *thread )
+{
+    free_req_buffers( thread );
+    kfree( thread->req_buffer );
+    kfree( thread->reply_buffer );
+    thread->req_buffer = NULL;
+    thread->reply_buffer = NULL;
+}
+
+static int req_buffer_stats_show( struct seq_file *m, void *v )
+{
+    seq_printf( m, "preallocated %d\n", atomic_read( &req_buffer_allocs ));
+    seq_printf( m, "cached       %d\n", atomic_read( &req_cache_allocs ));
+    seq_printf( m, "allocated    %d\n", atomic_read( &req_heap_allocs ));
+    return 0;
+}
+
+static int req_buffer_stats_open( struct inode *inode, struct file *file )
+{
+    return single_open( file, req_buffer_stats_show, NULL );
+}
+
+static const struct file_operations req_buffer_stats_fops =
+{
+    .owner   = THIS_MODULE,
+    .open    = req_buffer_stats_open,
+    .read    = seq_read,
+    .llseek  = seq_lseek,
+    .release = single_release,
+};
+
+/* called after init_req_stats, so that the counters show up in debugfs */
+void init_req_buffers(void)
+{
+    req_data_cache = kmem_cache_create( "uk_req_data", REQ_CACHE_SIZE, 0, 0, NULL );
+    if (!req_data_cache) klog(0, "cannot create the request data cache\n");
+    add_stats_file( "buffers", &req_buffer_stats_fops );
+}
+
+void release_req_buffers(void)
+{
+    if (req_data_cache) kmem_cache_destroy( req_data_cache );
+}
+#else
 /* allocate the reply data */
 void *set_reply_data_size( data_size_t size )
 {
@@ -186,6 +315,7 @@ void *set_reply_data_size( data_size_t size )
     current_thread->reply_size = size;
     return current_thread->reply_data;
 }
+#endif
 
 /* write the remaining part of the reply */
 void write_reply( struct thread *thread )
@@ -904,7 +1034,49 @@ void close_master_socket( timeout_t timeout )
 
 const char __user *current_config_dir;
 extern void uk_init_registry(const char __user* config_dir, int len);
-extern ssize_t uk_thread_wait(char __user *buf, size_t len);
+extern ssize_t uk_thread_wait(struct thread *thread, char __user *buf, size_t len);
+extern int uk_thread_wait_cookie(struct thread *thread, client_ptr_t cookie, int *signaled);
+extern void set_current_thread(struct thread *thread);
+extern int map_sync_page(struct vm_area_struct *vma, struct process *process);
+extern int map_queue_page(struct vm_area_struct *vma, struct process *process);
+
+/* state of an open /dev/syscall file; each client thread opens its own */
+struct syscall_channel
+{
+    struct thread *thread;  /* thread using the channel (holds a reference) */
+};
+
+/* find the thread of the task making a request on the channel; the channel
+ * is bound to the first thread found, so that later lookups don't need the
+ * hash table; called with uk_lock held */
+static struct thread *get_channel_thread( struct syscall_channel *channel )
+{
+    struct thread *thread = ACCESS_ONCE( channel->thread );
+
+    if (thread && thread->pid == current->pid)
+    {
+        set_current_thread( thread );
+        return thread;
+    }
+
+    /* not bound yet, or used by another task (inherited across fork) */
+    if ((thread = get_current_thread()) && !channel->thread)
+    {
+        grab_object( thread );
+        if (cmpxchg( &channel->thread, NULL, thread )) release_object( thread );
+    }
+    return thread;
+}
+
+/* same as get_channel_thread for the paths that don't take uk_lock; only a
+ * bound channel can be used, since its reference keeps the thread alive */
+static struct thread *get_channel_thread_nolock( struct syscall_channel *channel )
+{
+    struct thread *thread = ACCESS_ONCE( channel->thread );
+
+    if (thread && thread->pid == current->pid) return thread;
+    return NULL;
+}
 
 NTSTATUS NtEarlyInit(int __user* init_data_ptr)
 {
@@ -958,112 +1130,298 @@ NTSTATUS NtEarlyInit(int __user* init_data_ptr)
     }
 }
 
-NTSTATUS NtWineService(int __user *user_req_info)
+/* requests that only look up handles and read object state; they are
+ * run with uk_lock held shared so that they can proceed in parallel */
+static int req_is_shared( enum request req )
+{
+    switch (req)
+    {
+    case REQ_get_key_value:
+    case REQ_enum_key_value:
+    case REQ_query_event:
+    case REQ_query_semaphore:
+    case REQ_query_completion:
+    case REQ_query_symlink:
+    case REQ_get_timer_info:
+    case REQ_get_token_impersonation_level:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+
+static inline unsigned long long stats_time(void)
+{
+    return ktime_to_ns( ktime_get() );
+}
+
+/* call the handler of the request stored in thread->req and build the reply;
+ * lock_ns is the time the caller waited for uk_lock, for the statistics */
+static NTSTATUS call_req_handler( struct thread *thread, union generic_reply *reply,
+                                  unsigned long long lock_ns )
+{
+    enum request req = thread->req.request_header.req;
+    unsigned long long start;
+
+    thread->reply_size = 0;
+    thread->req_wakeups = 0;
+    clear_error();
+    memset( reply, 0, sizeof(*reply) );
+
+    if (debug_level) trace_request();
+
+    start = stats_time();
+    if (req < REQ_NB_REQUESTS)
+    {
+        req_handlers[req]( &thread->req, reply ); /* call handle */
+    }
+    else
+    {
+        set_error( STATUS_NOT_IMPLEMENTED );
+    }
+    account_request( req, lock_ns, stats_time() - start, thread->req.request_header.request_size,
+                     thread->reply_size, thread->req_wakeups );
+
+    reply->reply_header.error = thread->error;
+    reply->reply_header.reply_size = thread->reply_size;
+    if (debug_level) trace_reply( req, reply );
+
+    return get_error();
+}
+
+/* run a single request; called with uk_lock held */
+static NTSTATUS wine_service( struct syscall_channel *channel, int __user *user_req_info,
+                              struct __server_request_info *req_msg, unsigned long long lock_ns )
 {
     struct thread *thread;
-    struct __server_request_info req_msg;
     union generic_reply reply;
-    enum request req = -1;
     NTSTATUS status = STATUS_SUCCESS;
     int i;
 
-    thread = get_current_thread();
-
-    if(!user_req_info || !thread)
+    if (!(thread = get_channel_thread( channel )))
     {
         return STATUS_INVALID_PARAMETER;
     }
 
-    if (copy_from_user(&req_msg, user_req_info, sizeof(req_msg)))
+    if (req_msg->data_count > __SERVER_MAX_DATA)
     {
-        return STATUS_NO_MEMORY;
+        return STATUS_INVALID_PARAMETER;
     }
 
-    memcpy(&thread->req, &req_msg, sizeof(thread->req));
-    req = thread->req.request_header.req;
+    memcpy(&thread->req, req_msg, sizeof(thread->req));
     thread->req_toread = thread->req.request_header.request_size; 
 
     if (thread->req_toread )
     {
-        if (!(thread->req_data = malloc(thread->req_toread)))
+        if (!alloc_req_data( thread, thread->req_toread ))
         {
             return STATUS_NO_MEMORY;
         }
 
-        for (i=0; i<req_msg.data_count; ++i)
+        for (i=0; i<req_msg->data_count; ++i)
         {
             if(copy_from_user(
                         (char *)thread->req_data + thread->req.request_header.request_size - thread->req_toread, 
-                        req_msg.data[i].ptr, 
-                        req_msg.data[i].size))
+                        req_msg->data[i].ptr, 
+                        req_msg->data[i].size))
             { 
                 status = STATUS_NO_MEMORY;
                 goto out;
             }
 
-            thread->req_toread -= req_msg.data[i].size;
+            thread->req_toread -= req_msg->data[i].size;
         }
     }
 
-    thread->reply_size = 0;
-    clear_error();
-    memset( &reply, 0, sizeof(reply) );
+    status = call_req_handler( thread, &reply, lock_ns );
 
-    if (debug_level) trace_request();
+    /* make sure : &user_req_info == &user_req_info.u.reply */
+    if (copy_to_user(user_req_info, &reply, sizeof(reply))) 
+    {
+        status = STATUS_NO_MEMORY;
+        goto out;
+    }
 
-    if (req < REQ_NB_REQUESTS)
+    if (thread->reply_size)
     {
-        req_handlers[req]( &thread->req, &reply ); /* call handle */
+        if (copy_to_user(req_msg->reply_data, thread->reply_data, thread->reply_size))
+        {
+            status = STATUS_NO_MEMORY;
+            goto out;
+        }
     }
-    else
+
+out:
+    free_req_buffers( thread );
+    return status;
+}
+
+/* run a single request under uk_lock, shared or exclusive depending on the request */
+static NTSTATUS locked_wine_service( struct syscall_channel *channel, int __user *user_req_info,
+                                     struct __server_request_info *req_msg )
+{
+    unsigned long long start;
+    NTSTATUS status;
+    /* the trace output isn't safe against parallel requests */
+    int shared = !debug_level && req_is_shared( req_msg->u.req.request_header.req );
+
+    start = stats_time();
+    if (shared) uk_lock_shared();
+    else uk_lock();
+
+    status = wine_service( channel, user_req_info, req_msg, stats_time() - start );
+
+    if (shared) uk_unlock_shared();
+    else uk_unlock();
+
+    return status;
+}
+
+NTSTATUS NtWineService(struct syscall_channel *channel, int __user *user_req_info)
+{
+    struct __server_request_info req_msg;
+
+    if (!user_req_info)
     {
-        set_error( STATUS_NOT_IMPLEMENTED );
+        return STATUS_INVALID_PARAMETER;
     }
 
-    status = get_error();
+    if (copy_from_user(&req_msg, user_req_info, sizeof(req_msg)))
+    {
+        return STATUS_NO_MEMORY;
+    }
 
-    //if (thread->reply_fd)
-    if (thread)
+    return locked_wine_service( channel, user_req_info, &req_msg );
+}
+
+/* run a select request and, if it has to wait, wait for its wakeup in the
+ * same call instead of a separate read of the channel; the wakeup status is
+ * returned in place of STATUS_PENDING. -EINTR means the client has to wait
+ * for the wakeup with read() as before, either because a signal arrived or
+ * because the wakeup was meant for another select of the thread */
+NTSTATUS NtWineServiceWait(struct syscall_channel *channel, int __user *user_req_info)
+{
+    struct __server_request_info req_msg;
+    struct thread *thread;
+    NTSTATUS status;
+    int signaled;
+
+    if (!user_req_info)
     {
-        reply.reply_header.error = thread->error;
-        reply.reply_header.reply_size = thread->reply_size;
-        if (debug_level) trace_reply( req, &reply );
+        return STATUS_INVALID_PARAMETER;
     }
-    else
+
+    if (copy_from_user(&req_msg, user_req_info, sizeof(req_msg)))
     {
-        thread->exit_code = 1;
-        kill_thread( thread, 1 );  /* no way to continue without reply fd */
+        return STATUS_NO_MEMORY;
     }
 
-    /* make sure : &user_req_info == &user_req_info.u.reply */
-    if (copy_to_user(user_req_info, &reply, sizeof(reply))) 
+    if (req_msg.u.req.request_header.req != REQ_select)
     {
-        status = STATUS_NO_MEMORY;
-        goto out;
+        return STATUS_INVALID_PARAMETER;
     }
 
-    if (thread->reply_size)
+    /* resolved before the select, which can't be undone once it is pending */
+    thread = get_channel_thread_nolock( channel );
+
+    status = locked_wine_service( channel, user_req_info, &req_msg );
+    if (status != STATUS_PENDING)
+    {
+        return status;
+    }
+
+    /* an unbound channel leaves the wait to wait_select_reply */
+    if (!thread)
+    {
+        return -EINTR;
+    }
+
+    if (uk_thread_wait_cookie( thread, req_msg.u.req.select_request.cookie, &signaled ))
+    {
+        return -EINTR;
+    }
+    return signaled;
+}
+
+#define BATCH_CHUNK 4  /* requests copied in at a time, bounded by the kernel stack */
+
+/* run several requests in order under a single lock acquisition, stopping
+ * at the first one that fails; the number of requests run is returned in
+ * batch->done and the status of the last one as result */
+NTSTATUS NtWineServiceBatch(struct syscall_channel *channel, struct __server_request_batch __user *user_batch)
+{
+    struct __server_request_batch batch;
+    struct __server_request_info req_msgs[BATCH_CHUNK];
+    NTSTATUS status = STATUS_SUCCESS;
+    unsigned long long start, lock_ns;
+    unsigned int i, j, n, done = 0;
+    enum request req;
+    int shared = 1;
+
+    if (!user_batch)
     {
-        if (copy_to_user(req_msg.reply_data, thread->reply_data, thread->reply_size))
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (copy_from_user(&batch, user_batch, sizeof(batch)))
+    {
+        return STATUS_NO_MEMORY;
+    }
+
+    if (!batch.count || batch.count > __SERVER_MAX_BATCH)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* only the request codes are needed to pick the lock */
+    for (i = 0; i < batch.count; i++)
+    {
+        if (get_user(req, &batch.reqs[i]->u.req.request_header.req))
         {
-            status = STATUS_NO_MEMORY;
-            goto out;
+            return STATUS_NO_MEMORY;
         }
+        if (!req_is_shared( req )) shared = 0;
     }
+    if (debug_level) shared = 0;
 
-out:
-    if (thread->req_data)
+    start = stats_time();
+    if (shared) uk_lock_shared();
+    else uk_lock();
+    lock_ns = stats_time() - start;
+
+    for (i = 0; i < batch.count && !status; i += n)
     {
-        free(thread->req_data);
-        thread->req_data = NULL;
+        n = min( batch.count - i, (unsigned int)BATCH_CHUNK );
+        for (j = 0; j < n; j++)
+        {
+            if (copy_from_user(&req_msgs[j], batch.reqs[i + j], sizeof(req_msgs[j])))
+            {
+                status = STATUS_NO_MEMORY;
+                goto done;
+            }
+            /* the client may have changed the request since it was checked */
+            if (shared && !req_is_shared( req_msgs[j].u.req.request_header.req ))
+            {
+                status = STATUS_INVALID_PARAMETER;
+                goto done;
+            }
+        }
+        /* the lock wait is charged to the first request of the batch */
+        for (j = 0; j < n && !status; j++, done++)
+        {
+            status = wine_service( channel, (int __user *)batch.reqs[i + j], &req_msgs[j], done ? 0 : lock_ns );
+        }
     }
 
-    if (thread->reply_data)
+done:
+    if (shared) uk_unlock_shared();
+    else uk_unlock();
+
+    if (put_user(done, &user_batch->done))
     {
-        free(thread->reply_data);
-        thread->reply_data = NULL;
+        status = STATUS_NO_MEMORY;
     }
-
     return status;
 }
 
@@ -1089,23 +1447,75 @@ static dev_t devno;
 
 static int syscall_chardev_open(struct inode *inode, struct file *file)
 {
+    struct syscall_channel *channel;
+
+    if (!(channel = kzalloc(sizeof(*channel), GFP_KERNEL)))
+    {
+        return -ENOMEM;
+    }
+    file->private_data = channel;
     return 0;
 }
 
 static int syscall_chardev_release(struct inode *inode, struct file *file)
 {
+    struct syscall_channel *channel = file->private_data;
+
+    if (channel->thread)
+    {
+        uk_lock();
+        release_object(channel->thread);
+        uk_unlock();
+    }
+    kfree(channel);
     return 0;
 }
 
+/* map the sync or queue status page into the client; the sync page belongs to
+ * the process of the thread bound to the channel, which the channel keeps alive */
+static int syscall_chardev_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+    struct thread *thread = get_channel_thread_nolock(filp->private_data);
+
+    if (vma->vm_pgoff == SERVER_SYNC_OFFSET >> PAGE_SHIFT)
+    {
+        if (!thread)
+        {
+            return -EINVAL;
+        }
+        return map_sync_page(vma, thread->process);
+    }
+    if (vma->vm_pgoff == SERVER_QUEUE_OFFSET >> PAGE_SHIFT)
+    {
+        if (!thread)
+        {
+            return -EINVAL;
+        }
+        return map_queue_page(vma, thread->process);
+    }
+    return -EINVAL;
+}
+
 static ssize_t syscall_chardev_read(struct file *filp, char __user *buf, size_t len, loff_t *ppos)
 {
-    return uk_thread_wait(buf, len);
+    struct thread *thread = get_channel_thread_nolock(filp->private_data);
+
+    if (!thread)
+    {
+        return -EINVAL;
+    }
+    return uk_thread_wait(thread, buf, len);
 }
 
 static ssize_t syscall_chardev_write(struct file *filp, const char __user *buf, size_t len, loff_t *ppos)
 {
     ssize_t ret;
-    struct thread *thread = current_thread ?: get_thread_from_tid(current->pid);
+    struct thread *thread = get_channel_thread_nolock(filp->private_data);
+
+    if (!thread)
+    {
+        return -EINVAL;
+    }
 
     if(copy_from_user( &thread->wake_info, buf, sizeof(struct wake_up_reply)))
     {
@@ -1114,6 +1524,8 @@ static ssize_t syscall_chardev_write(struct file *filp, const char __user *buf,
     }
     else
     {
+        /* a wakeup put back by the client, the next read must get it */
+        complete(&thread->completion);
         ret = sizeof(struct wake_up_reply);
     }
 
@@ -1132,27 +1544,38 @@ static long syscall_chardev_unlocked_ioctl(struct file *filp, unsigned int cmd,
         return STATUS_INVALID_PARAMETER;
     }
 
-    uk_lock();
     switch (cmd) 
     {
         case Nt_None:
             break;
         case Nt_EarlyInit:
+            uk_lock();
             err = NtEarlyInit(argp);
+            uk_unlock();
             break;
         case Nt_WineService:
-            err = NtWineService(argp);
+            /* takes uk_lock itself, shared or exclusive depending on the request */
+            err = NtWineService(filp->private_data, argp);
             break;
         case Nt_KillThread:
+            uk_lock();
             err = NtKillThread(argp);
+            uk_unlock();
             break;
         case Nt_KillProcess:
+            uk_lock();
             err = NtKillProcess(argp);
+            uk_unlock();
+            break;
+        case Nt_WineServiceBatch:
+            err = NtWineServiceBatch(filp->private_data, (struct __server_request_batch __user *)argp);
+            break;
+        case Nt_WineServiceWait:
+            err = NtWineServiceWait(filp->private_data, argp);
             break;
         default:
             break;
     }
-    uk_unlock();
 
     return err;
 }
@@ -1163,6 +1586,7 @@ static const struct file_operations syscall_chardev_fops =
     .release 	= syscall_chardev_release,
     .read       = syscall_chardev_read,
     .write      = syscall_chardev_write,
+    .mmap       = syscall_chardev_mmap,
     .unlocked_ioctl = syscall_chardev_unlocked_ioctl,
 };
 
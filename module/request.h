@@ -58,6 +58,17 @@ extern void fatal_error( const char *err, ... );
 
 extern const char *get_config_dir(void);
 extern void *set_reply_data_size( data_size_t size );
+#ifdef CONFIG_UNIFIED_KERNEL
+extern void destroy_req_buffers( struct thread *thread );
+extern void init_req_buffers(void);
+extern void release_req_buffers(void);
+extern void account_request( enum request req, unsigned long long lock_ns, unsigned long long handler_ns,
+                             data_size_t bytes_in, data_size_t bytes_out, unsigned int wakeups );
+extern void init_req_stats(void);
+extern void release_req_stats(void);
+struct file_operations;
+extern void add_stats_file( const char *name, const struct file_operations *fops );
+#endif
 extern int receive_fd( struct process *process );
 extern int send_client_fd( struct process *process, int fd, obj_handle_t handle );
 extern void read_request( struct thread *thread );
@@ -112,6 +123,9 @@ static inline void set_reply_data_ptr( void *data, data_size_t size )
     assert( size <= get_reply_max_size() );
     current_thread->reply_size = size;
     current_thread->reply_data = data;
+#ifdef CONFIG_UNIFIED_KERNEL
+    current_thread->reply_data_cached = 0;
+#endif
 }
 
 
@@ -362,6 +376,7 @@ DECL_HANDLER(create_completion);
 DECL_HANDLER(open_completion);
 DECL_HANDLER(add_completion);
 DECL_HANDLER(remove_completion);
+DECL_HANDLER(remove_completions);
 DECL_HANDLER(query_completion);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
@@ -373,6 +388,7 @@ DECL_HANDLER(set_cursor);
 DECL_HANDLER(update_rawinput_devices);
 DECL_HANDLER(get_suspend_context);
 DECL_HANDLER(set_suspend_context);
+DECL_HANDLER(get_sync_slot);
 
 #ifdef WANT_REQUEST_HANDLERS
 
@@ -623,6 +639,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_open_completion,
     (req_handler)req_add_completion,
     (req_handler)req_remove_completion,
+    (req_handler)req_remove_completions,
     (req_handler)req_query_completion,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
@@ -634,6 +651,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_update_rawinput_devices,
     (req_handler)req_get_suspend_context,
     (req_handler)req_set_suspend_context,
+    (req_handler)req_get_sync_slot,
 };
 
 C_ASSERT( sizeof(affinity_t) == 8 );
@@ -946,12 +964,8 @@ C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, type) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, cacheable) == 12 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, access) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, options) == 20 );
-#ifdef CONFIG_UNIFIED_KERNEL
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, fd) == 24 );
-C_ASSERT( sizeof(struct get_handle_fd_reply) == 28 );
-#else
-C_ASSERT( sizeof(struct get_handle_fd_reply) == 24 );
-#endif
+C_ASSERT( sizeof(struct get_handle_fd_reply) == 32 );
 C_ASSERT( FIELD_OFFSET(struct flush_file_request, handle) == 12 );
 C_ASSERT( sizeof(struct flush_file_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct flush_file_reply, event) == 8 );
@@ -1268,6 +1282,8 @@ C_ASSERT( sizeof(struct read_process_memory_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct write_process_memory_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct write_process_memory_request, addr) == 16 );
 C_ASSERT( sizeof(struct write_process_memory_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct write_process_memory_reply, written) == 8 );
+C_ASSERT( sizeof(struct write_process_memory_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_key_request, parent) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_key_request, access) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_key_request, attributes) == 20 );
@@ -1412,7 +1428,9 @@ C_ASSERT( FIELD_OFFSET(struct init_atom_table_reply, table) == 8 );
 C_ASSERT( sizeof(struct init_atom_table_reply) == 16 );
 C_ASSERT( sizeof(struct get_msg_queue_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, handle) == 8 );
-C_ASSERT( sizeof(struct get_msg_queue_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, slot) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, slot_seq) == 16 );
+C_ASSERT( sizeof(struct get_msg_queue_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_fd_request, handle) == 12 );
 C_ASSERT( sizeof(struct set_queue_fd_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_mask_request, wake_mask) == 12 );
@@ -2167,6 +2185,9 @@ C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, cvalue) == 16 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, information) == 24 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, status) == 32 );
 C_ASSERT( sizeof(struct remove_completion_reply) == 40 );
+C_ASSERT( FIELD_OFFSET(struct remove_completions_request, handle) == 12 );
+C_ASSERT( sizeof(struct remove_completions_request) == 16 );
+C_ASSERT( sizeof(struct remove_completions_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_request, handle) == 12 );
 C_ASSERT( sizeof(struct query_completion_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_reply, depth) == 8 );
@@ -2217,6 +2238,12 @@ C_ASSERT( sizeof(struct update_rawinput_devices_request) == 16 );
 C_ASSERT( sizeof(struct get_suspend_context_request) == 16 );
 C_ASSERT( sizeof(struct get_suspend_context_reply) == 8 );
 C_ASSERT( sizeof(struct set_suspend_context_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_sync_slot_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_sync_slot_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_sync_slot_reply, index) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_sync_slot_reply, seq) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_sync_slot_reply, access) == 16 );
+C_ASSERT( sizeof(struct get_sync_slot_reply) == 24 );
 
 #endif  /* WANT_REQUEST_HANDLERS */
 
@@ -48,11 +48,18 @@
 #include "request.h"
 #include "security.h"
 
+#ifdef CONFIG_UNIFIED_KERNEL
+#include "wine/server.h"  /* for SERVER_SYNC_SEMAPHORE */
+#endif
+
 struct uk_semaphore
 {
     struct object  obj;    /* object header */
     unsigned int   count;  /* current_thread count */
     unsigned int   max;    /* maximum possible count */
+#ifdef CONFIG_UNIFIED_KERNEL
+    struct list_head sync_views;  /* copies of the count in process sync pages */
+#endif
 };
 
 static void semaphore_dump( struct object *obj, int verbose );
@@ -61,6 +68,11 @@ static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entr
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int semaphore_map_access( struct object *obj, unsigned int access );
 static int semaphore_signal( struct object *obj, unsigned int access );
+#ifdef CONFIG_UNIFIED_KERNEL
+static void semaphore_destroy( struct object *obj );
+#else
+#define semaphore_destroy no_destroy
+#endif
 
 static const struct object_ops semaphore_ops =
 {
@@ -79,9 +91,17 @@ static const struct object_ops semaphore_ops =
     no_lookup_name,                /* lookup_name */
     no_open_file,                  /* open_file */
     no_close_handle,               /* close_handle */
-    no_destroy                     /* destroy */
+    semaphore_destroy              /* destroy */
 };
 
+static inline void set_semaphore_count( struct uk_semaphore *sem, unsigned int count )
+{
+    sem->count = count;
+#ifdef CONFIG_UNIFIED_KERNEL
+    publish_sync_state( &sem->sync_views, count );
+#endif
+}
+
 
 static struct uk_semaphore *create_semaphore( struct directory *root, const struct unicode_str *name,
                                            unsigned int attr, unsigned int initial, unsigned int max,
@@ -101,6 +121,9 @@ static struct uk_semaphore *create_semaphore( struct directory *root, const stru
             /* initialize it if it didn't already exist */
             sem->count = initial;
             sem->max   = max;
+#ifdef CONFIG_UNIFIED_KERNEL
+            list_init( &sem->sync_views );
+#endif
             if (sd) default_set_sd( &sem->obj, sd, OWNER_SECURITY_INFORMATION|
                                                    GROUP_SECURITY_INFORMATION|
                                                    DACL_SECURITY_INFORMATION|
@@ -122,11 +145,11 @@ static int release_semaphore( struct uk_semaphore *sem, unsigned int count,
     else if (sem->count)
     {
         /* there cannot be any thread to wake up if the count is != 0 */
-        sem->count += count;
+        set_semaphore_count( sem, sem->count + count );
     }
     else
     {
-        sem->count = count;
+        set_semaphore_count( sem, count );
         uk_wake_up( &sem->obj, count );
     }
     return 1;
@@ -160,7 +183,7 @@ static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *en
     struct uk_semaphore *sem = (struct uk_semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
     assert( sem->count );
-    sem->count--;
+    set_semaphore_count( sem, sem->count - 1 );
 }
 
 static unsigned int semaphore_map_access( struct object *obj, unsigned int access )
@@ -185,6 +208,25 @@ static int semaphore_signal( struct object *obj, unsigned int access )
     return release_semaphore( sem, 1, NULL );
 }
 
+#ifdef CONFIG_UNIFIED_KERNEL
+static void semaphore_destroy( struct object *obj )
+{
+    struct uk_semaphore *sem = (struct uk_semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    free_sync_views( &sem->sync_views );
+}
+
+/* return the slot of a semaphore in the sync page of a process;
+ * 0 if the object isn't a semaphore or if no slot is available */
+unsigned int get_semaphore_sync_slot( struct object *obj, struct process *process )
+{
+    struct uk_semaphore *sem = (struct uk_semaphore *)obj;
+
+    if (obj->ops != &semaphore_ops) return 0;
+    return get_sync_view( &sem->sync_views, process, SERVER_SYNC_SEMAPHORE, sem->count, sem->max );
+}
+#endif
+
 /* create a semaphore */
 DECL_HANDLER(create_semaphore)
 {
@@ -69,6 +69,11 @@
 #include "request.h"
 #include "user.h"
 
+#ifdef CONFIG_UNIFIED_KERNEL
+#include <linux/bitops.h>
+#include <linux/workqueue.h>
+#endif
+
 /* From winsock.h */
 #define FD_MAX_EVENTS              10
 #define FD_READ_BIT                0
@@ -119,8 +124,21 @@ struct sock
     struct sock        *deferred;    /* socket that waits for a deferred accept */
     struct async_queue *read_q;      /* queue for asynchronous reads */
     struct async_queue *write_q;     /* queue for asynchronous writes */
+#ifdef CONFIG_UNIFIED_KERNEL
+    struct work_struct  direct_work; /* transfers the data of direct asyncs */
+    unsigned long       direct_events; /* SOCK_DIRECT_* bits for direct_work */
+    int                 direct_last; /* direct_work is dropping the last reference */
+#endif
 };
 
+#ifdef CONFIG_UNIFIED_KERNEL
+#define SOCK_DIRECT_READ   0          /* direct read asyncs can make progress */
+#define SOCK_DIRECT_WRITE  1          /* direct write asyncs can make progress */
+#define SOCK_DIRECT_CHUNK  0x10000    /* bytes moved per socket call */
+
+static void sock_direct_work( struct work_struct *work );
+#endif
+
 static void sock_dump( struct object *obj, int verbose );
 static int sock_signaled( struct object *obj, struct wait_queue_entry *entry );
 static struct uk_fd *sock_get_fd( struct object *obj );
@@ -306,6 +324,8 @@ static void sock_wake_up( struct sock *sock )
 
 #ifdef CONFIG_UNIFIED_KERNEL
 extern int uk_sock_error( struct uk_fd *fd );
+extern int uk_sock_recv( struct uk_fd *fd, void *buf, size_t size );
+extern int uk_sock_send( struct uk_fd *fd, const void *buf, size_t size );
 static inline int sock_error( struct uk_fd *fd )
 {
     return uk_sock_error( fd );
@@ -321,10 +341,135 @@ static inline int sock_error( struct uk_fd *fd )
 }
 #endif
 
+#ifdef CONFIG_UNIFIED_KERNEL
+/* receive into the buffers of direct read asyncs until the socket is drained */
+static void sock_direct_read( struct sock *sock, char *buf )
+{
+    struct async *async;
+    data_size_t size;
+    int ret;
+
+    while ((async = async_get_direct( sock->read_q )))
+    {
+        size = min( async_direct_remaining( async ), (data_size_t)SOCK_DIRECT_CHUNK );
+        ret = uk_sock_recv( sock->fd, buf, size );
+        if (ret == -EAGAIN) break;
+        if (ret < 0)
+        {
+            async_complete( async, sock_get_ntstatus( -ret ));
+            continue;
+        }
+        if (async_direct_copy( async, buf, ret, 1 ) < ret)
+        {
+            async_complete( async, STATUS_ACCESS_VIOLATION );
+            continue;
+        }
+        async_direct_advance( async, ret );
+        async_complete( async, STATUS_SUCCESS );
+
+        /* what the client does with enable_socket_event after its own recv */
+        sock->pmask &= ~FD_READ;
+        sock->hmask &= ~FD_READ;
+    }
+}
+
+/* send from the buffers of direct write asyncs until the socket is full */
+static void sock_direct_write( struct sock *sock, char *buf )
+{
+    struct async *async;
+    data_size_t size;
+    int ret;
+
+    while ((async = async_get_direct( sock->write_q )))
+    {
+        size = min( async_direct_remaining( async ), (data_size_t)SOCK_DIRECT_CHUNK );
+        if (!size)
+        {
+            async_complete( async, STATUS_SUCCESS );
+            continue;
+        }
+        if (!(size = async_direct_copy( async, buf, size, 0 )))
+        {
+            async_complete( async, STATUS_ACCESS_VIOLATION );
+            continue;
+        }
+        ret = uk_sock_send( sock->fd, buf, size );
+        if (ret == -EAGAIN) break;
+        if (ret < 0)
+        {
+            async_complete( async, sock_get_ntstatus( -ret ));
+            continue;
+        }
+        if (!async_direct_advance( async, ret )) async_complete( async, STATUS_SUCCESS );
+        else if (ret < size) break;  /* the socket is full, wait for POLLOUT */
+    }
+}
+
+/* bounce buffer for the direct transfers; the work items run with the
+ * exclusive uk_lock held, so there is never more than one user. Waking the
+ * client up instead when a buffer can't be allocated would make it start
+ * over a send the server has already done part of. */
+static char sock_direct_buf[SOCK_DIRECT_CHUNK];
+
+/* runs the direct transfers; no direct asyncs are used if it can't be created */
+static struct workqueue_struct *sock_wq;
+
+static void sock_direct_work( struct work_struct *work )
+{
+    struct sock *sock = container_of( work, struct sock, direct_work );
+
+    uk_lock();
+    if (test_and_clear_bit( SOCK_DIRECT_READ, &sock->direct_events )) sock_direct_read( sock, sock_direct_buf );
+    if (test_and_clear_bit( SOCK_DIRECT_WRITE, &sock->direct_events )) sock_direct_write( sock, sock_direct_buf );
+    sock_reselect( sock );
+    /* with uk_lock held only the poll wakeup can grab the socket, so a reference
+     * that isn't the last one can't become it; if it is, sock_destroy runs from
+     * here and must not wait for this work item */
+    sock->direct_last = (sock->obj.refcount == 1);
+    release_object( sock );
+    uk_unlock();
+}
+
+/* called from the poll wakeup, possibly in softirq context; the queued work
+ * holds a reference to the socket */
+static void sock_queue_direct( struct sock *sock, int bit )
+{
+    set_bit( bit, &sock->direct_events );
+    grab_object( sock );
+    /* already queued: the pending work holds a reference, so ours isn't the last */
+    if (!queue_work( sock_wq, &sock->direct_work )) release_object( sock );
+}
+
+/* create the direct transfer workqueue */
+void init_sock_work(void)
+{
+    sock_wq = alloc_workqueue( "uk_sock", 0, 0 );
+}
+
+/* run the pending direct transfers and free the workqueue; at module exit */
+void release_sock_work(void)
+{
+    if (sock_wq) destroy_workqueue( sock_wq );
+    sock_wq = NULL;
+}
+#endif
+
 static int sock_dispatch_asyncs( struct sock *sock, int event, int error )
 {
     if ( sock->flags & WSA_FLAG_OVERLAPPED )
     {
+#ifdef CONFIG_UNIFIED_KERNEL
+        if ( event & POLLIN && sock_wq && async_get_direct( sock->read_q ) )
+        {
+            sock_queue_direct( sock, SOCK_DIRECT_READ );
+            event &= ~(POLLIN|POLLPRI);
+        }
+        if ( event & POLLOUT && sock_wq && async_get_direct( sock->write_q ) )
+        {
+            sock_queue_direct( sock, SOCK_DIRECT_WRITE );
+            event &= ~POLLOUT;
+        }
+#endif
         if ( event & (POLLIN|POLLPRI) && async_waiting( sock->read_q ) )
         {
             if (debug_level) fprintf( stderr, "activating read queue for socket %p\n", sock );
@@ -586,6 +731,11 @@ static void sock_queue_async( struct uk_fd *fd, const async_data_t *data, int ty
     }
 
     if (!(async = create_async( current_thread, queue, data ))) return;
+#ifdef CONFIG_UNIFIED_KERNEL
+    /* the client may pass its buffers so that we do the transfer ourselves */
+    if (sock->type == SOCK_STREAM && get_req_data_size())
+        async_set_buffers( async, get_req_data(), get_req_data_size() );
+#endif
     release_object( async );
 
     sock_reselect( sock );
@@ -624,6 +774,13 @@ static void sock_destroy( struct object *obj )
 
     /* FIXME: special socket shutdown stuff? */
 
+#ifdef CONFIG_UNIFIED_KERNEL
+    /* a queued direct_work holds a reference, so it can only still be running
+     * here: either it is dropping the last reference itself, or it is past
+     * its uk_unlock() and about to return */
+    if (!sock->direct_last) cancel_work_sync( &sock->direct_work );
+#endif
+
     if ( sock->deferred )
         release_object( sock->deferred );
 
@@ -661,6 +818,11 @@ static void init_sock(struct sock *sock)
     sock->read_q  = NULL;
     sock->write_q = NULL;
     memset( sock->errors, 0, sizeof(sock->errors) );
+#ifdef CONFIG_UNIFIED_KERNEL
+    INIT_WORK( &sock->direct_work, sock_direct_work );
+    sock->direct_events = 0;
+    sock->direct_last   = 0;
+#endif
 }
 
 /* create a new and unconnected socket */
@@ -0,0 +1,330 @@
+/*
+ * syncpage.c
+ *
+ * Shared state pages for events, semaphores and message queues
+ *
+ * Copyright (C) 2006  Insigma Co., Ltd
+ *
+ * This software has been developed while working on the Linux Unified Kernel
+ * project (http://www.longene.org) in the Insigma Research Institute,  
+ * which is a subdivision of Insigma Co., Ltd (http://www.insigma.com.cn).
+ * 
+ * The project is sponsored by Insigma Co., Ltd.
+ *
+ * The authors can be reached at linux@insigma.com.cn.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of  the GNU General  Public License as published by the
+ * Free Software Foundation; either version 2 of the  License, or (at your
+ * option) any later version.
+ */
+
+/*
+ * Each process that opts in gets its own sync page, mapped read-only from
+ * SYSCALL_FILE. When it asks for the slot of an event or semaphore it holds
+ * a handle to, the object gets a view in that page, and from then on every
+ * state change of the object is copied into all its views. The state itself
+ * stays in the object: the page is only ever written by the kernel, and
+ * nothing in it is read back. User space can use it to skip the server
+ * calls that can't change anything: waits with a zero timeout on objects
+ * that aren't signaled, waits on signaled manual-reset events, and setting
+ * or resetting an event that is already in that state.
+ *
+ * The queue status page works the same way: each process gets its own,
+ * holding a slot for each message queue of its threads with the wake and
+ * changed bits, so that user32 can tell that a queue is empty without asking
+ * the server. A queue can outlive its process, so the page is refcounted by
+ * the process and by every slot in use.
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <stdarg.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "handle.h"
+#include "process.h"
+#include "thread.h"
+#include "request.h"
+#include "wine/server.h"
+
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/bitops.h>
+
+/* the sync page of a process */
+struct sync_page
+{
+    struct __server_sync_slot *slots;   /* SERVER_SYNC_SLOTS slots, read-only in the client */
+    struct list_head           views;   /* views of objects in this page */
+    unsigned int               hint;    /* where to start looking for a free slot */
+    DECLARE_BITMAP( used, SERVER_SYNC_SLOTS );  /* slots in use; slot 0 is never used */
+};
+
+/* the slot of an object in the sync page of one process */
+struct sync_view
+{
+    struct list_head   obj_entry;   /* entry in the list of views of the object */
+    struct list_head   page_entry;  /* entry in the list of views of the page */
+    struct sync_page  *page;        /* page the slot is in */
+    unsigned int       index;       /* slot index */
+};
+
+/* the queue status page of a process */
+struct queue_page
+{
+    struct __server_queue_slot *slots;  /* SERVER_QUEUE_SLOTS slots, read-only in the client */
+    unsigned int                refs;   /* process reference plus one per slot in use */
+    unsigned int                hint;   /* where to start looking for a free slot */
+    DECLARE_BITMAP( used, SERVER_QUEUE_SLOTS );  /* slots in use; slot 0 is never used */
+};
+
+static void release_queue_page( struct queue_page *page );
+
+/* get the sync page of a process, allocating it on first use */
+static struct sync_page *get_process_sync_page( struct process *process )
+{
+    struct sync_page *page;
+
+    if (ACCESS_ONCE( process->sync_page )) return process->sync_page;
+
+    if (!(page = kzalloc( sizeof(*page), GFP_KERNEL ))) return NULL;
+    if (!(page->slots = vmalloc_user( SERVER_SYNC_SIZE )))
+    {
+        kfree( page );
+        return NULL;
+    }
+    list_init( &page->views );
+    page->hint = 1;
+
+    /* the mmap path doesn't hold uk_lock */
+    if (cmpxchg( &process->sync_page, NULL, page ))
+    {
+        vfree( page->slots );
+        kfree( page );
+    }
+    return process->sync_page;
+}
+
+static void free_sync_view( struct sync_view *view )
+{
+    struct sync_page *page = view->page;
+    struct __server_sync_slot *slot = &page->slots[view->index];
+
+    slot->seq++;
+    smp_wmb();
+    slot->type  = 0;
+    slot->state = 0;
+    __clear_bit( view->index, page->used );
+    if (view->index < page->hint) page->hint = view->index;
+    list_remove( &view->obj_entry );
+    list_remove( &view->page_entry );
+    kfree( view );
+}
+
+/* get the slot of an object in the sync page of a process, creating it if
+ * needed; returns 0 on failure. Called with uk_lock held */
+unsigned int get_sync_view( struct list_head *views, struct process *process,
+                            unsigned int type, unsigned int state, unsigned int max )
+{
+    struct sync_page *page;
+    struct sync_view *view;
+    struct __server_sync_slot *slot;
+    unsigned int index;
+
+    LIST_FOR_EACH_ENTRY( view, views, struct sync_view, obj_entry )
+        if (view->page == process->sync_page) return view->index;
+
+    if (!(page = get_process_sync_page( process ))) goto no_slot;
+
+    index = find_next_zero_bit( page->used, SERVER_SYNC_SLOTS, page->hint );
+    if (index >= SERVER_SYNC_SLOTS) index = find_next_zero_bit( page->used, SERVER_SYNC_SLOTS, 1 );
+    if (index >= SERVER_SYNC_SLOTS) goto no_slot;
+    if (!(view = kmalloc( sizeof(*view), GFP_KERNEL ))) goto no_slot;
+
+    __set_bit( index, page->used );
+    page->hint = index + 1;
+    view->page  = page;
+    view->index = index;
+    wine_list_add_tail( views, &view->obj_entry );
+    wine_list_add_tail( &page->views, &view->page_entry );
+
+    slot = &page->slots[index];
+    slot->state = state;
+    slot->max   = max;
+    slot->type  = type;
+    smp_wmb();
+    slot->seq++;
+    return index;
+
+no_slot:
+    set_error( STATUS_NO_MEMORY );
+    return 0;
+}
+
+/* get the sequence number of a slot in the sync page of a process */
+unsigned int get_sync_view_seq( struct process *process, unsigned int index )
+{
+    return process->sync_page->slots[index].seq;
+}
+
+/* copy the new state of an object into all its views; called with uk_lock held */
+void publish_sync_state( struct list_head *views, unsigned int state )
+{
+    struct sync_view *view;
+
+    LIST_FOR_EACH_ENTRY( view, views, struct sync_view, obj_entry )
+        ACCESS_ONCE( view->page->slots[view->index].state ) = state;
+}
+
+/* free the views of an object that is being destroyed */
+void free_sync_views( struct list_head *views )
+{
+    struct sync_view *view, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( view, next, views, struct sync_view, obj_entry ) free_sync_view( view );
+}
+
+/* free the sync page of a process that is being destroyed, and drop its
+ * reference to the queue status page */
+void release_process_sync( struct process *process )
+{
+    struct sync_page *page = process->sync_page;
+    struct sync_view *view, *next;
+
+    if (process->queue_page) release_queue_page( process->queue_page );
+    process->queue_page = NULL;
+
+    if (!page) return;
+    LIST_FOR_EACH_ENTRY_SAFE( view, next, &page->views, struct sync_view, page_entry ) free_sync_view( view );
+    vfree( page->slots );  /* pages still mapped by the client stay around until unmapped */
+    kfree( page );
+    process->sync_page = NULL;
+}
+
+/* map the sync page of a process into it, read-only */
+int map_sync_page( struct vm_area_struct *vma, struct process *process )
+{
+    struct sync_page *page;
+
+    if (vma->vm_end - vma->vm_start != SERVER_SYNC_SIZE) return -EINVAL;
+    if (vma->vm_flags & VM_WRITE) return -EACCES;
+    if (!(page = get_process_sync_page( process ))) return -ENOMEM;
+    vma->vm_flags &= ~VM_MAYWRITE;
+    return remap_vmalloc_range( vma, page->slots, 0 );
+}
+
+/* get the queue status page of a process, allocating it on first use */
+static struct queue_page *get_process_queue_page( struct process *process )
+{
+    struct queue_page *page;
+
+    if (ACCESS_ONCE( process->queue_page )) return process->queue_page;
+
+    if (!(page = kzalloc( sizeof(*page), GFP_KERNEL ))) return NULL;
+    if (!(page->slots = vmalloc_user( SERVER_QUEUE_SIZE )))
+    {
+        kfree( page );
+        return NULL;
+    }
+    page->refs = 1;
+    page->hint = 1;
+
+    /* the mmap path doesn't hold uk_lock */
+    if (cmpxchg( &process->queue_page, NULL, page ))
+    {
+        vfree( page->slots );
+        kfree( page );
+    }
+    return process->queue_page;
+}
+
+static void release_queue_page( struct queue_page *page )
+{
+    if (--page->refs) return;
+    vfree( page->slots );  /* pages still mapped by the client stay around until unmapped */
+    kfree( page );
+}
+
+struct __server_queue_slot *get_queue_slot( struct queue_page *page, unsigned int index )
+{
+    return &page->slots[index];
+}
+
+/* allocate a slot in the queue status page of a process; returns 0 if none
+ * is left, the queue then simply isn't published. Called with uk_lock held */
+unsigned int alloc_queue_slot( struct process *process, struct queue_page **ret )
+{
+    struct queue_page *page;
+    struct __server_queue_slot *slot;
+    unsigned int index;
+
+    if (!(page = get_process_queue_page( process ))) return 0;
+
+    index = find_next_zero_bit( page->used, SERVER_QUEUE_SLOTS, page->hint );
+    if (index >= SERVER_QUEUE_SLOTS) index = find_next_zero_bit( page->used, SERVER_QUEUE_SLOTS, 1 );
+    if (index >= SERVER_QUEUE_SLOTS) return 0;
+    __set_bit( index, page->used );
+    page->hint = index + 1;
+    page->refs++;
+
+    slot = &page->slots[index];
+    slot->wake_bits    = 0;
+    slot->changed_bits = 0;
+    smp_wmb();
+    slot->seq++;
+    *ret = page;
+    return index;
+}
+
+/* free a queue status slot; clients still caching it see the sequence number change */
+void free_queue_slot( struct queue_page *page, unsigned int index )
+{
+    struct __server_queue_slot *slot = &page->slots[index];
+
+    slot->seq++;
+    smp_wmb();
+    slot->wake_bits    = 0;
+    slot->changed_bits = 0;
+    __clear_bit( index, page->used );
+    if (index < page->hint) page->hint = index;
+    release_queue_page( page );
+}
+
+/* map the queue status page of a process into it, read-only */
+int map_queue_page( struct vm_area_struct *vma, struct process *process )
+{
+    struct queue_page *page;
+
+    if (vma->vm_end - vma->vm_start != SERVER_QUEUE_SIZE) return -EINVAL;
+    if (vma->vm_flags & VM_WRITE) return -EACCES;
+    if (!(page = get_process_queue_page( process ))) return -ENOMEM;
+    vma->vm_flags &= ~VM_MAYWRITE;
+    return remap_vmalloc_range( vma, page->slots, 0 );
+}
+
+/* get the slot of an event or semaphore in the sync page of the process */
+DECL_HANDLER(get_sync_slot)
+{
+    struct process *process = current_thread->process;
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( process, req->handle, SYNCHRONIZE, NULL ))) return;
+
+    if ((reply->index = get_event_sync_slot( obj, process )) ||
+        (reply->index = get_semaphore_sync_slot( obj, process )))
+    {
+        reply->seq    = get_sync_view_seq( process, reply->index );
+        reply->access = get_handle_access( process, req->handle );
+    }
+    else if (!get_error()) set_error( STATUS_OBJECT_TYPE_MISMATCH );
+
+    release_object( obj );
+}
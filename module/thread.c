@@ -82,6 +82,9 @@ static const unsigned int supported_cpus = CPU_FLAG(CPU_ARM64);
 #ifdef CONFIG_UNIFIED_KERNEL
 #include <linux/completion.h>
 #include <linux/sched.h>
+#include <linux/hash.h>
+#include <linux/percpu.h>
+#include <linux/hardirq.h>
 
 static DEFINE_RECURSIVE_SPINLOCK(thread_lock);
 
@@ -91,10 +94,10 @@ int uk_sched_getaffinity(pid_t pid, size_t cpusetsize, cpu_set_t *mask);
 /* for find_thread_by_pid() */
 static DEFINE_RWLOCK(thread_hash_lock);
 
-#define THREAD_HASH_BITS 8
+#define THREAD_HASH_BITS 10
 #define THREAD_HASH_SIZE (1<<THREAD_HASH_BITS)
 #define thread_hashfn(nr) \
-	((nr) % THREAD_HASH_SIZE)
+	hash_32((u32)(nr), THREAD_HASH_BITS)
 
 static struct hlist_head thread_hash_table[THREAD_HASH_SIZE];
 
@@ -192,16 +195,34 @@ struct thread* get_thread_by_task(struct task_struct *task)
 	}
 }
 
-static struct thread *last_thread;
+/* per-cpu cache of the thread that last made a request on each cpu; the
+ * entries are checked against current->pid before use and cleared when the
+ * thread is destroyed */
+static DEFINE_PER_CPU(struct thread *, last_thread);
+
 struct thread* get_current_thread(void)
 {
-    if (last_thread && last_thread->pid==current->pid)
-        return last_thread;
-    else
-    {
-        last_thread = get_thread_by_task(current);
-        return last_thread;
-    }
+    struct thread *thread = this_cpu_read( last_thread );
+
+    if (thread && thread->pid == current->pid)
+        return thread;
+
+    if ((thread = get_thread_by_task(current))) this_cpu_write( last_thread, thread );
+    return thread;
+}
+
+/* prime the cache when the caller already knows the current thread */
+void set_current_thread(struct thread *thread)
+{
+    this_cpu_write( last_thread, thread );
+}
+
+static void forget_current_thread(struct thread *thread)
+{
+    int cpu;
+
+    for_each_possible_cpu(cpu)
+        cmpxchg( per_cpu_ptr( &last_thread, cpu ), thread, NULL );
 }
 #endif
 
@@ -222,6 +243,16 @@ struct thread_wait
     struct wait_queue_entry queues[1];
 };
 
+/* wait queue walk in progress in uk_wake_up; remove_queue keeps pos valid,
+ * so that waking a thread does not force the walk to start over */
+struct wake_cursor
+{
+    struct list_head   *pos;   /* next wait queue entry to look at */
+    struct wake_cursor *prev;  /* enclosing walk, if any */
+};
+
+static struct wake_cursor *wake_cursors;  /* innermost walk, protected by thread_lock */
+
 /* asynchronous procedure calls */
 
 struct thread_apc
@@ -323,6 +354,13 @@ static inline void init_thread_structure( struct thread *thread )
     thread->req_toread      = 0;
     thread->reply_data      = NULL;
     thread->reply_towrite   = 0;
+#ifdef CONFIG_UNIFIED_KERNEL
+    thread->req_buffer      = NULL;
+    thread->reply_buffer    = NULL;
+    thread->req_data_cached = 0;
+    thread->reply_data_cached = 0;
+    thread->req_wakeups = 0;
+#endif
     thread->request_fd      = NULL;
     thread->reply_fd        = NULL;
     thread->wait_fd         = NULL;
@@ -332,6 +370,7 @@ static inline void init_thread_structure( struct thread *thread )
     thread->suspend         = 0;
     thread->desktop_users   = 0;
     thread->token           = NULL;
+    thread->io_completion   = NULL;
 #ifdef CONFIG_UNIFIED_KERNEL
     thread->pid             = -1;  /* not known yet */
     INIT_HLIST_NODE( &thread->hash_entry );
@@ -422,12 +461,17 @@ static void cleanup_thread( struct thread *thread )
 
     clear_apc_queue( &thread->system_apc );
     clear_apc_queue( &thread->user_apc );
+#ifdef CONFIG_UNIFIED_KERNEL
+    destroy_req_buffers( thread );
+#else
     free( thread->req_data );
     free( thread->reply_data );
+#endif
     if (thread->request_fd) release_object( thread->request_fd );
     if (thread->reply_fd) release_object( thread->reply_fd );
     if (thread->wait_fd) release_object( thread->wait_fd );
     free( thread->suspend_context );
+    completion_thread_idle( thread );
     cleanup_clipboard_thread(thread);
     destroy_thread_windows( thread );
     free_msg_queue( thread );
@@ -460,6 +504,7 @@ static void destroy_thread( struct object *obj )
     list_remove( &thread->entry );
 #ifdef CONFIG_UNIFIED_KERNEL
     remove_thread_by_pid( thread, current->pid );
+    forget_current_thread( thread );
 #endif
     cleanup_thread( thread );
     release_object( thread->process );
@@ -552,10 +597,15 @@ struct thread *get_thread_from_tid( int tid )
 {
     struct thread *thread;
 
+#ifdef CONFIG_UNIFIED_KERNEL
+    /* the unix tid is the linux pid the thread is hashed with */
+    if ((thread = find_thread_by_pid( tid )) && thread->unix_tid == tid) return thread;
+#else
     LIST_FOR_EACH_ENTRY( thread, &thread_list, struct thread, entry )
     {
         if (thread->unix_tid == tid) return thread;
     }
+#endif
     return NULL;
 }
 
@@ -565,6 +615,10 @@ struct thread *get_thread_from_pid( int pid )
 {
     struct thread *thread;
 
+#ifdef CONFIG_UNIFIED_KERNEL
+    /* the main thread is hashed with the pid of the process */
+    if ((thread = find_thread_by_pid( pid )) && thread->unix_pid == pid) return thread;
+#endif
     LIST_FOR_EACH_ENTRY( thread, &thread_list, struct thread, entry )
     {
         if (thread->unix_pid == pid) return thread;
@@ -704,6 +758,12 @@ int add_queue( struct object *obj, struct wait_queue_entry *entry )
 /* remove a thread from an object wait queue */
 void remove_queue( struct object *obj, struct wait_queue_entry *entry )
 {
+    struct wake_cursor *cursor;
+
+    /* move the wake up walks that were about to look at this entry */
+    for (cursor = wake_cursors; cursor; cursor = cursor->prev)
+        if (cursor->pos == &entry->entry) cursor->pos = entry->entry.next;
+
     list_remove( &entry->entry );
     release_object( obj );
 }
@@ -850,10 +910,9 @@ static int check_wait( struct thread *thread )
 }
 
 #ifdef CONFIG_UNIFIED_KERNEL
-ssize_t uk_thread_wait(char __user *buf, size_t len)
+ssize_t uk_thread_wait(struct thread *thread, char __user *buf, size_t len)
 {
     ssize_t ret;
-    struct thread *thread = current_thread ?: get_thread_from_tid(current->pid);
 
     ret = wait_for_completion_interruptible( &thread->completion );
     if (ret)
@@ -876,9 +935,32 @@ ssize_t uk_thread_wait(char __user *buf, size_t len)
     return ret;
 }
 
+/* wait for the wakeup of the select with the given cookie; any other wakeup
+ * (the thread got killed, or it was meant for an outer select) is put back
+ * for the client to read and -EINTR returned, as on a signal */
+int uk_thread_wait_cookie(struct thread *thread, client_ptr_t cookie, int *signaled)
+{
+    if (wait_for_completion_interruptible( &thread->completion ))
+    {
+        return -EINTR;
+    }
+    if (thread->wake_info.cookie != cookie)
+    {
+        complete(&thread->completion);
+        return -EINTR;
+    }
+    *signaled = thread->wake_info.signaled;
+    return 0;
+}
+
 /* send the wakeup signal to a thread */
 static int send_thread_wakeup( struct thread *thread, client_ptr_t cookie, int signaled )
 {
+    struct thread *waker;
+
+    /* charge the wakeup to the request being handled, if any */
+    if (!in_irq() && !in_serving_softirq() && (waker = current_thread)) waker->req_wakeups++;
+
     thread->wake_info.cookie   = cookie;
     thread->wake_info.signaled = signaled;
     complete(&thread->completion);
@@ -1230,18 +1312,49 @@ static timeout_t select_on( const select_op_t *select_op, data_size_t op_size, c
 #endif
 
 /* attempt to wake threads sleeping on the object wait queue */
+/* wake up the thread of a wait queue entry if its wait is satisfied; a plain
+ * wait on this object alone only needs the object checked */
+static int wake_waiter( struct wait_queue_entry *entry )
+{
+    struct thread_wait *wait = entry->wait;
+    struct thread *thread = wait->thread;
+
+    if (thread->wait == wait && wait->count == 1 && wait->select != SELECT_WAIT_ALL &&
+        !(wait->flags & SELECT_INTERRUPTIBLE))
+    {
+        if (!entry->obj->ops->signaled( entry->obj, entry )) return 0;
+        return wake_thread_queue_entry( entry );
+    }
+    return wake_thread( thread );
+}
+
 void uk_wake_up( struct object *obj, int max )
 {
-    struct list_head *ptr;
+    struct wake_cursor cursor;
+    struct wait_queue_entry *entry;
+
+    /* waking a thread only consumes object state, so the entries already
+     * looked at cannot have become satisfied: a single pass is enough, as
+     * long as the entries removed by the wake ups are stepped over */
+#ifdef CONFIG_UNIFIED_KERNEL
+    recursive_spin_lock_bh(&thread_lock);
+#endif
+    cursor.pos  = obj->wait_queue.next;
+    cursor.prev = wake_cursors;
+    wake_cursors = &cursor;
 
-    LIST_FOR_EACH( ptr, &obj->wait_queue )
+    while (cursor.pos != &obj->wait_queue)
     {
-        struct wait_queue_entry *entry = LIST_ENTRY( ptr, struct wait_queue_entry, entry );
-        if (!wake_thread( get_wait_queue_thread( entry ))) continue;
+        entry = LIST_ENTRY( cursor.pos, struct wait_queue_entry, entry );
+        cursor.pos = cursor.pos->next;
+        if (!wake_waiter( entry )) continue;
         if (max && !--max) break;
-        /* restart at the head of the list since a wake up can change the object wait queue */
-        ptr = &obj->wait_queue;
     }
+
+    wake_cursors = cursor.prev;
+#ifdef CONFIG_UNIFIED_KERNEL
+    recursive_spin_unlock_bh(&thread_lock);
+#endif
 }
 
 /* return the apc queue to use for a given apc type */
@@ -1868,6 +1981,9 @@ DECL_HANDLER(select)
         release_object( apc );
     }
 
+    /* a thread that waits no longer counts against the concurrency of its port */
+    completion_thread_idle( current_thread );
+
     reply->timeout = select_on( &select_op, op_size, req->cookie, req->flags, req->timeout );
 
     if (get_error() == STATUS_USER_APC)
@@ -93,6 +93,13 @@ struct thread
     void                  *reply_data;    /* variable-size data for reply */
     unsigned int           reply_size;    /* size of reply data */
     unsigned int           reply_towrite; /* amount of data still to write in reply */
+#ifdef CONFIG_UNIFIED_KERNEL
+    void                  *req_buffer;    /* preallocated buffer for small request data */
+    void                  *reply_buffer;  /* preallocated buffer for small reply data */
+    int                    req_data_cached;   /* req_data comes from req_data_cache */
+    int                    reply_data_cached; /* reply_data comes from req_data_cache */
+    unsigned int           req_wakeups;       /* threads woken up by the current request */
+#endif
     struct uk_fd             *request_fd;    /* fd for receiving client requests */
     struct uk_fd             *reply_fd;      /* fd to send a reply to a client */
     struct uk_fd             *wait_fd;       /* fd to use to wake a sleeping client */
@@ -111,6 +118,7 @@ struct thread
     timeout_t              creation_time; /* Thread creation time */
     timeout_t              exit_time;     /* Thread exit time */
     struct token          *token;         /* security token associated with this thread */
+    struct uk_completion  *io_completion; /* completion port the thread is active on */
 };
 
 struct thread_snapshot
@@ -169,7 +177,18 @@ extern void get_selector_entry( struct thread *thread, int entry, unsigned int *
 extern unsigned int global_error;  /* global error code for when no thread is current_thread */
 
 static inline unsigned int get_error(void)       { return current_thread ? current_thread->error : global_error; }
+#ifdef CONFIG_UNIFIED_KERNEL
+/* requests run in parallel under the shared uk_lock, so only fall back to
+ * the global error when there is no thread to store it in */
+static inline void set_error( unsigned int err )
+{
+    struct thread *thread = current_thread;
+    if (thread) thread->error = err;
+    else global_error = err;
+}
+#else
 static inline void set_error( unsigned int err ) { global_error = err; if (current_thread) current_thread->error = err; }
+#endif
 static inline void clear_error(void)             { set_error(0); }
 static inline void set_win32_error( unsigned int err ) { set_error( 0xc0010000 | err ); }
 
@@ -811,6 +811,52 @@ static void dump_varargs_rectangles( const char *prefix, data_size_t size )
     remove_data( size );
 }
 
+static void dump_varargs_async_buffers( const char *prefix, data_size_t size )
+{
+    const async_buffer_t *buffer;
+    data_size_t len;
+
+    fprintf( stderr,"%s{", prefix );
+    if (size < sizeof(client_ptr_t))
+    {
+        fputc( '}', stderr );
+        remove_data( size );
+        return;
+    }
+    dump_uint64( "apc=", cur_data );
+    buffer = (const async_buffer_t *)((const client_ptr_t *)cur_data + 1);
+    len = (size - sizeof(client_ptr_t)) / sizeof(*buffer);
+    if (len) fputc( ',', stderr );
+    while (len > 0)
+    {
+        dump_uint64( "{ptr=", &buffer->ptr );
+        fprintf( stderr, ",size=%u}", buffer->size );
+        buffer++;
+        if (--len) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+    remove_data( size );
+}
+
+static void dump_varargs_completions( const char *prefix, data_size_t size )
+{
+    const completion_msg_t *msg = cur_data;
+    data_size_t len = size / sizeof(*msg);
+
+    fprintf( stderr,"%s{", prefix );
+    while (len > 0)
+    {
+        dump_uint64( "{ckey=", &msg->ckey );
+        dump_uint64( ",cvalue=", &msg->cvalue );
+        dump_uint64( ",information=", &msg->information );
+        fprintf( stderr, ",status=%08x}", msg->status );
+        msg++;
+        if (--len) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+    remove_data( size );
+}
+
 static void dump_varargs_message_data( const char *prefix, data_size_t size )
 {
     /* FIXME: dump the structured data */
@@ -1562,7 +1608,7 @@ static void dump_query_semaphore_request( const struct query_semaphore_request *
 
 static void dump_query_semaphore_reply( const struct query_semaphore_reply *req )
 {
-    fprintf( stderr, " current=%08x", req->current_count );
+    fprintf( stderr, " current_count=%08x", req->current_count );
     fprintf( stderr, ", max=%08x", req->max );
 }
 
@@ -1645,6 +1691,7 @@ static void dump_get_handle_fd_reply( const struct get_handle_fd_reply *req )
     fprintf( stderr, ", cacheable=%d", req->cacheable );
     fprintf( stderr, ", access=%08x", req->access );
     fprintf( stderr, ", options=%08x", req->options );
+    fprintf( stderr, ", fd=%d", req->fd );
 }
 
 static void dump_flush_file_request( const struct flush_file_request *req )
@@ -2238,6 +2285,11 @@ static void dump_write_process_memory_request( const struct write_process_memory
     dump_varargs_bytes( ", data=", cur_size );
 }
 
+static void dump_write_process_memory_reply( const struct write_process_memory_reply *req )
+{
+    fprintf( stderr, " written=%u", req->written );
+}
+
 static void dump_create_key_request( const struct create_key_request *req )
 {
     fprintf( stderr, " parent=%04x", req->parent );
@@ -2542,6 +2594,8 @@ static void dump_get_msg_queue_request( const struct get_msg_queue_request *req
 static void dump_get_msg_queue_reply( const struct get_msg_queue_reply *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", slot=%08x", req->slot );
+    fprintf( stderr, ", slot_seq=%08x", req->slot_seq );
 }
 
 static void dump_set_queue_fd_request( const struct set_queue_fd_request *req )
@@ -2733,6 +2787,7 @@ static void dump_register_async_request( const struct register_async_request *re
     fprintf( stderr, " type=%d", req->type );
     dump_async_data( ", async=", &req->async );
     fprintf( stderr, ", count=%d", req->count );
+    dump_varargs_async_buffers( ", buffers=", cur_size );
 }
 
 static void dump_cancel_async_request( const struct cancel_async_request *req )
@@ -4006,6 +4061,16 @@ static void dump_remove_completion_reply( const struct remove_completion_reply *
     fprintf( stderr, ", status=%08x", req->status );
 }
 
+static void dump_remove_completions_request( const struct remove_completions_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_remove_completions_reply( const struct remove_completions_reply *req )
+{
+    dump_varargs_completions( " msgs=", cur_size );
+}
+
 static void dump_query_completion_request( const struct query_completion_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4107,6 +4172,18 @@ static void dump_set_suspend_context_request( const struct set_suspend_context_r
     dump_varargs_context( " context=", cur_size );
 }
 
+static void dump_get_sync_slot_request( const struct get_sync_slot_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_sync_slot_reply( const struct get_sync_slot_reply *req )
+{
+    fprintf( stderr, " index=%08x", req->index );
+    fprintf( stderr, ", seq=%08x", req->seq );
+    fprintf( stderr, ", access=%08x", req->access );
+}
+
 static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_new_process_request,
     (dump_func)dump_get_new_process_info_request,
@@ -4352,6 +4429,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_request,
     (dump_func)dump_add_completion_request,
     (dump_func)dump_remove_completion_request,
+    (dump_func)dump_remove_completions_request,
     (dump_func)dump_query_completion_request,
     (dump_func)dump_set_completion_info_request,
     (dump_func)dump_add_fd_completion_request,
@@ -4363,6 +4441,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_update_rawinput_devices_request,
     (dump_func)dump_get_suspend_context_request,
     (dump_func)dump_set_suspend_context_request,
+    (dump_func)dump_get_sync_slot_request,
 };
 
 static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
@@ -4460,7 +4539,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_debug_break_reply,
     NULL,
     (dump_func)dump_read_process_memory_reply,
-    NULL,
+    (dump_func)dump_write_process_memory_reply,
     (dump_func)dump_create_key_reply,
     (dump_func)dump_open_key_reply,
     NULL,
@@ -4610,6 +4689,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_reply,
     NULL,
     (dump_func)dump_remove_completion_reply,
+    (dump_func)dump_remove_completions_reply,
     (dump_func)dump_query_completion_reply,
     NULL,
     NULL,
@@ -4621,6 +4701,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_get_suspend_context_reply,
     NULL,
+    (dump_func)dump_get_sync_slot_reply,
 };
 
 static const char * const req_names[REQ_NB_REQUESTS] = {
@@ -4868,6 +4949,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "open_completion",
     "add_completion",
     "remove_completion",
+    "remove_completions",
     "query_completion",
     "set_completion_info",
     "add_fd_completion",
@@ -4879,6 +4961,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "update_rawinput_devices",
     "get_suspend_context",
     "set_suspend_context",
+    "get_sync_slot",
 };
 
 static const struct
@@ -5001,6 +5084,12 @@ static const struct
 /* ### make_requests end ### */
 /* Everything above this line is generated automatically by tools/make_requests */
 
+/* get the name of a request, for the request statistics */
+const char *get_req_name( enum request req )
+{
+    return req_names[req];
+}
+
 static const char *get_status_name( unsigned int status )
 {
     int i;
@@ -99,8 +99,12 @@ struct window
     WCHAR           *text;            /* window caption text */
     unsigned int     paint_flags;     /* various painting flags */
     int              prop_inuse;      /* number of in-use window properties */
-    int              prop_alloc;      /* number of allocated window properties */
-    struct property *properties;      /* window properties array */
+    int              prop_alloc;      /* size of the properties hash table, a power of 2 */
+    struct property *properties;      /* window properties hash table, keyed by atom */
+    struct hit_index *hit_index;      /* spatial index of the children, built on demand */
+    struct region   *vis_cache;       /* last computed visible region */
+    unsigned int     vis_cache_flags; /* DCX_* flags of the cached visible region */
+    unsigned int     vis_cache_serial; /* visible_serial when the region was cached */
     int              nb_extra_bytes;  /* number of extra bytes */
     char             extra_bytes[1];  /* extra bytes storage */
 };
@@ -116,6 +120,36 @@ struct window
 #define PAINT_DELAYED_ERASE      0x0080  /* still needs erase after WM_ERASEBKGND */
 #define PAINT_PIXEL_FORMAT_CHILD 0x0100  /* at least one child has a custom pixel format */
 
+/* grid over the client area of a window, to find the children that may
+ * contain a point without walking the whole z-order list; each cell lists
+ * the children overlapping it by z-order position, children covering a
+ * large part of the grid are kept in a separate list instead */
+struct hit_index
+{
+    rectangle_t      bounds;       /* area covered by the grid, in client coordinates of the parent */
+    int              cell_width;   /* size of a grid cell */
+    int              cell_height;
+    int              cols;         /* number of grid columns and rows */
+    int              rows;
+    unsigned int     nb_large;     /* number of children covering a large part of the grid */
+    unsigned int    *large;        /* their z-order positions */
+    unsigned int    *cell_start;   /* start of each cell in cell_items, plus the end of the last one */
+    unsigned int    *cell_items;   /* z-order positions of the children overlapping each cell */
+    struct window   *windows[1];   /* children in z-order */
+};
+
+#define HIT_INDEX_MIN_CHILDREN 32  /* smaller z-order lists are simply walked */
+#define HIT_INDEX_MAX_GRID     64  /* maximum number of grid columns and rows */
+
+/* iterator over the children that may contain a point, in z-order */
+struct hit_iter
+{
+    const struct hit_index *index;
+    unsigned int            pos;   /* position in cell_items */
+    unsigned int            end;   /* end of the cell in cell_items */
+    unsigned int            large; /* position in the large list */
+};
+
 /* growable array of user handles */
 struct user_handle_array
 {
@@ -130,6 +164,9 @@ static struct window *shell_listview;
 static struct window *progman_window;
 static struct window *taskman_window;
 
+/* bumped whenever a change may affect the visible region of any window */
+static unsigned int visible_serial;
+
 /* magic HWND_TOP etc. pointers */
 #define WINPTR_TOP       ((struct window *)1L)
 #define WINPTR_BOTTOM    ((struct window *)2L)
@@ -186,6 +223,21 @@ static inline void update_pixel_format_flags( struct window *win )
         win->paint_flags |= PAINT_PIXEL_FORMAT_CHILD;
 }
 
+/* free the spatial index of the children of a window, after they changed */
+static inline void invalidate_hit_index( struct window *win )
+{
+    if (!win || !win->hit_index) return;
+    free( win->hit_index->cell_items );
+    free( win->hit_index );
+    win->hit_index = NULL;
+}
+
+/* flush all the cached visible regions */
+static inline void invalidate_visible_regions(void)
+{
+    visible_serial++;
+}
+
 /* link a window at the right place in the siblings list */
 static void link_window( struct window *win, struct window *previous )
 {
@@ -196,6 +248,8 @@ static void link_window( struct window *win, struct window *previous )
         previous = WINPTR_TOP;  /* fallback to the HWND_TOP case */
     }
 
+    invalidate_hit_index( win->parent );
+    invalidate_visible_regions();
     list_remove( &win->entry );  /* unlink it from the previous location */
 
     if (previous == WINPTR_BOTTOM)
@@ -256,6 +310,8 @@ static int set_parent_window( struct window *win, struct window *parent )
         }
     }
 
+    if (win->is_linked) invalidate_hit_index( win->parent );
+
     if (parent)
     {
         win->parent = parent;
@@ -271,6 +327,7 @@ static int set_parent_window( struct window *win, struct window *parent )
     }
     else  /* move it to parent unlinked list */
     {
+        invalidate_visible_regions();
         list_remove( &win->entry );  /* unlink it from the previous location */
         wine_list_add_head( &win->parent->unlinked, &win->entry );
         win->is_linked = 0;
@@ -298,84 +355,111 @@ static int add_handle_to_array( struct user_handle_array *array, user_handle_t h
     return 1;
 }
 
+/* get the home slot of an atom in the window properties hash table */
+static inline int prop_hash( const struct window *win, atom_t atom )
+{
+    return ((atom * 0x9e3779b1u) >> 16) & (win->prop_alloc - 1);
+}
+
+/* find a window property, or the free slot where it would go; NULL if there is no table yet */
+static struct property *find_property( struct window *win, atom_t atom )
+{
+    int i;
+
+    if (!win->prop_alloc) return NULL;
+    for (i = prop_hash( win, atom ); ; i = (i + 1) & (win->prop_alloc - 1))
+    {
+        struct property *prop = &win->properties[i];
+        if (prop->type == PROP_TYPE_FREE || prop->atom == atom) return prop;
+    }
+}
+
+/* double the size of the properties hash table */
+static int grow_properties( struct window *win )
+{
+    struct property *old_props = win->properties;
+    int i, old_alloc = win->prop_alloc;
+    int new_alloc = old_alloc ? old_alloc * 2 : 8;
+
+    if (!(win->properties = mem_alloc( new_alloc * sizeof(*win->properties) )))
+    {
+        win->properties = old_props;
+        return 0;
+    }
+    for (i = 0; i < new_alloc; i++) win->properties[i].type = PROP_TYPE_FREE;
+    win->prop_alloc = new_alloc;
+
+    for (i = 0; i < old_alloc; i++)
+        if (old_props[i].type != PROP_TYPE_FREE) *find_property( win, old_props[i].atom ) = old_props[i];
+    free( old_props );
+    return 1;
+}
+
 /* set a window property */
 static void set_property( struct window *win, atom_t atom, lparam_t data, enum property_type type )
 {
-    int i, free = -1;
-    struct property *new_props;
+    struct property *prop = find_property( win, atom );
 
     /* check if it exists already */
-    for (i = 0; i < win->prop_inuse; i++)
+    if (prop && prop->type != PROP_TYPE_FREE)
     {
-        if (win->properties[i].type == PROP_TYPE_FREE)
-        {
-            free = i;
-            continue;
-        }
-        if (win->properties[i].atom == atom)
-        {
-            win->properties[i].type = type;
-            win->properties[i].data = data;
-            return;
-        }
+        prop->type = type;
+        prop->data = data;
+        return;
     }
 
     /* need to add an entry */
     if (!grab_global_atom( NULL, atom )) return;
-    if (free == -1)
+    if ((win->prop_inuse + 1) * 4 > win->prop_alloc * 3)  /* keep the table at most 3/4 full */
     {
-        /* no free entry */
-        if (win->prop_inuse >= win->prop_alloc)
+        if (!grow_properties( win ))
         {
-            /* need to grow the array */
-            if (!(new_props = realloc( win->properties,
-                                       sizeof(*new_props) * (win->prop_alloc + 16) )))
-            {
-                set_error( STATUS_NO_MEMORY );
-                release_global_atom( NULL, atom );
-                return;
-            }
-            win->prop_alloc += 16;
-            win->properties = new_props;
+            release_global_atom( NULL, atom );
+            return;
         }
-        free = win->prop_inuse++;
+        prop = find_property( win, atom );
     }
-    win->properties[free].atom = atom;
-    win->properties[free].type = type;
-    win->properties[free].data = data;
+    prop->atom = atom;
+    prop->type = type;
+    prop->data = data;
+    win->prop_inuse++;
 }
 
 /* remove a window property */
 static lparam_t remove_property( struct window *win, atom_t atom )
 {
-    int i;
+    struct property *prop = find_property( win, atom );
+    int i, j, home, mask = win->prop_alloc - 1;
+    lparam_t data;
+
+    /* FIXME: last error? */
+    if (!prop || prop->type == PROP_TYPE_FREE) return 0;
 
-    for (i = 0; i < win->prop_inuse; i++)
+    release_global_atom( NULL, atom );
+    data = prop->data;
+
+    /* move back the following entries of the probe sequence so that no lookup stops at the hole */
+    i = prop - win->properties;
+    for (j = (i + 1) & mask; win->properties[j].type != PROP_TYPE_FREE; j = (j + 1) & mask)
     {
-        if (win->properties[i].type == PROP_TYPE_FREE) continue;
-        if (win->properties[i].atom == atom)
-        {
-            release_global_atom( NULL, atom );
-            win->properties[i].type = PROP_TYPE_FREE;
-            return win->properties[i].data;
-        }
+        home = prop_hash( win, win->properties[j].atom );
+        if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) continue;  /* still reachable */
+        win->properties[i] = win->properties[j];
+        i = j;
     }
-    /* FIXME: last error? */
-    return 0;
+    win->properties[i].type = PROP_TYPE_FREE;
+    win->prop_inuse--;
+    return data;
 }
 
 /* find a window property */
 static lparam_t get_property( struct window *win, atom_t atom )
 {
-    int i;
+    struct property *prop = find_property( win, atom );
 
-    for (i = 0; i < win->prop_inuse; i++)
-    {
-        if (win->properties[i].type == PROP_TYPE_FREE) continue;
-        if (win->properties[i].atom == atom) return win->properties[i].data;
-    }
     /* FIXME: last error? */
-    return 0;
+    if (!prop || prop->type == PROP_TYPE_FREE) return 0;
+    return prop->data;
 }
 
 /* destroy all properties of a window */
@@ -384,7 +468,7 @@ static inline void destroy_properties( struct window *win )
     int i;
 
     if (!win->properties) return;
-    for (i = 0; i < win->prop_inuse; i++)
+    for (i = 0; i < win->prop_alloc; i++)
     {
         if (win->properties[i].type == PROP_TYPE_FREE) continue;
         release_global_atom( NULL, win->properties[i].atom );
@@ -503,6 +587,8 @@ static struct window *create_window( struct window *parent, struct window *owner
     win->prop_inuse     = 0;
     win->prop_alloc     = 0;
     win->properties     = NULL;
+    win->hit_index      = NULL;
+    win->vis_cache      = NULL;
     win->nb_extra_bytes = extra_bytes;
     win->window_rect = win->visible_rect = win->client_rect = empty_rect;
     memset( win->extra_bytes, 0, extra_bytes );
@@ -691,50 +777,215 @@ static unsigned int get_children_windows( struct window *parent, atom_t atom, th
     return count;
 }
 
+/* get the grid cell range covered by a rectangle, clipped to the grid */
+static inline int get_hit_cells( const struct hit_index *index, const rectangle_t *rect,
+                                 int *col0, int *row0, int *col1, int *row1 )
+{
+    rectangle_t clip;
+
+    if (!intersect_rect( &clip, rect, &index->bounds )) return 0;
+    *col0 = (clip.left - index->bounds.left) / index->cell_width;
+    *row0 = (clip.top - index->bounds.top) / index->cell_height;
+    *col1 = (clip.right - 1 - index->bounds.left) / index->cell_width;
+    *row1 = (clip.bottom - 1 - index->bounds.top) / index->cell_height;
+    return 1;
+}
+
+/* build the spatial index of the children of a window; returns NULL if not worth it */
+static struct hit_index *build_hit_index( struct window *parent )
+{
+    struct hit_index *index;
+    struct window *ptr;
+    rectangle_t bounds;
+    unsigned int i, count = 0, nb_cells, total = 0;
+    int grid, col, row, col0, row0, col1, row1;
+
+    LIST_FOR_EACH_ENTRY( ptr, &parent->children, struct window, entry ) count++;
+    if (count < HIT_INDEX_MIN_CHILDREN) return NULL;
+
+    if (is_desktop_window( parent )) bounds = parent->client_rect;
+    else
+    {
+        bounds.left   = 0;
+        bounds.top    = 0;
+        bounds.right  = parent->client_rect.right - parent->client_rect.left;
+        bounds.bottom = parent->client_rect.bottom - parent->client_rect.top;
+    }
+    if (bounds.left >= bounds.right || bounds.top >= bounds.bottom) return NULL;
+
+    for (grid = 4; grid < HIT_INDEX_MAX_GRID && grid * grid < count; grid *= 2) ;
+    nb_cells = grid * grid;
+
+    /* allocation failures simply leave the index out, don't set an error */
+    if (!(index = malloc( sizeof(*index) + (count - 1) * sizeof(index->windows[0]) +
+                          count * sizeof(index->large[0]) +
+                          (nb_cells + 1) * sizeof(index->cell_start[0]) )))
+        return NULL;
+    index->bounds      = bounds;
+    index->cols        = grid;
+    index->rows        = grid;
+    index->cell_width  = (bounds.right - bounds.left + grid - 1) / grid;
+    index->cell_height = (bounds.bottom - bounds.top + grid - 1) / grid;
+    index->nb_large    = 0;
+    index->large       = (unsigned int *)&index->windows[count];
+    index->cell_start  = index->large + count;
+    index->cell_items  = NULL;
+    memset( index->cell_start, 0, (nb_cells + 1) * sizeof(index->cell_start[0]) );
+
+    /* first count the children in each cell */
+    i = 0;
+    LIST_FOR_EACH_ENTRY( ptr, &parent->children, struct window, entry )
+    {
+        index->windows[i] = ptr;
+        if (get_hit_cells( index, &ptr->visible_rect, &col0, &row0, &col1, &row1 ))
+        {
+            if ((col1 - col0 + 1) * (row1 - row0 + 1) > nb_cells / 4)
+                index->large[index->nb_large++] = i;
+            else
+            {
+                for (row = row0; row <= row1; row++)
+                    for (col = col0; col <= col1; col++) index->cell_start[row * grid + col]++;
+                total += (col1 - col0 + 1) * (row1 - row0 + 1);
+            }
+        }
+        i++;
+    }
+
+    if (!(index->cell_items = malloc( max( total, 1u ) * sizeof(index->cell_items[0]) )))
+    {
+        free( index );
+        return NULL;
+    }
+
+    /* turn the counts into cell ends, then fill the cells backwards so that
+     * each one ends up in z-order and cell_start points to its beginning */
+    for (i = 1; i <= nb_cells; i++) index->cell_start[i] += index->cell_start[i - 1];
+    for (i = count; i-- > 0; )
+    {
+        if (!get_hit_cells( index, &index->windows[i]->visible_rect, &col0, &row0, &col1, &row1 ))
+            continue;
+        if ((col1 - col0 + 1) * (row1 - row0 + 1) > nb_cells / 4) continue;
+        for (row = row0; row <= row1; row++)
+            for (col = col0; col <= col1; col++)
+                index->cell_items[--index->cell_start[row * grid + col]] = i;
+    }
+    return index;
+}
+
+/* start iterating over the children of 'parent' that may contain a point;
+ * returns 0 if there is no index or the point is outside of it */
+static int hit_index_start( struct hit_iter *iter, struct window *parent, int x, int y )
+{
+    const struct hit_index *index;
+    int cell;
+
+    if (!parent->hit_index) parent->hit_index = build_hit_index( parent );
+    if (!(index = parent->hit_index)) return 0;
+
+    if (x < index->bounds.left || x >= index->bounds.right ||
+        y < index->bounds.top || y >= index->bounds.bottom)
+        return 0;
+
+    cell = ((y - index->bounds.top) / index->cell_height) * index->cols +
+           (x - index->bounds.left) / index->cell_width;
+    iter->index = index;
+    iter->pos   = index->cell_start[cell];
+    iter->end   = index->cell_start[cell + 1];
+    iter->large = 0;
+    return 1;
+}
+
+/* get the next candidate child, merging the cell and the large children by z-order */
+static struct window *hit_index_next( struct hit_iter *iter )
+{
+    const struct hit_index *index = iter->index;
+    unsigned int pos;
+
+    if (iter->pos < iter->end &&
+        (iter->large >= index->nb_large || index->cell_items[iter->pos] < index->large[iter->large]))
+        pos = index->cell_items[iter->pos++];
+    else if (iter->large < index->nb_large)
+        pos = index->large[iter->large++];
+    else
+        return NULL;
+    return index->windows[pos];
+}
+
+static struct window *child_window_from_point( struct window *parent, int x, int y );
+
+/* find the window at a point inside child 'ptr' of a window (in parent-relative coords) */
+static struct window *window_from_child_point( struct window *ptr, int x, int y )
+{
+    /* if window is minimized or disabled, return at once */
+    if (ptr->style & (WS_MINIMIZE|WS_DISABLED)) return ptr;
+
+    /* if point is not in client area, return at once */
+    if (x < ptr->client_rect.left || x >= ptr->client_rect.right ||
+        y < ptr->client_rect.top || y >= ptr->client_rect.bottom)
+        return ptr;
+
+    return child_window_from_point( ptr, x - ptr->client_rect.left, y - ptr->client_rect.top );
+}
+
 /* find child of 'parent' that contains the given point (in parent-relative coords) */
 static struct window *child_window_from_point( struct window *parent, int x, int y )
 {
+    struct hit_iter iter;
     struct window *ptr;
 
+    if (hit_index_start( &iter, parent, x, y ))
+    {
+        while ((ptr = hit_index_next( &iter )))
+            if (is_point_in_window( ptr, x, y )) return window_from_child_point( ptr, x, y );
+        return parent;  /* not found any child */
+    }
+
     LIST_FOR_EACH_ENTRY( ptr, &parent->children, struct window, entry )
     {
         if (!is_point_in_window( ptr, x, y )) continue;  /* skip it */
+        return window_from_child_point( ptr, x, y );
+    }
+    return parent;  /* not found any child */
+}
 
-        /* if window is minimized or disabled, return at once */
-        if (ptr->style & (WS_MINIMIZE|WS_DISABLED)) return ptr;
-
-        /* if point is not in client area, return at once */
-        if (x < ptr->client_rect.left || x >= ptr->client_rect.right ||
-            y < ptr->client_rect.top || y >= ptr->client_rect.bottom)
-            return ptr;
+static int get_window_children_from_point( struct window *parent, int x, int y,
+                                           struct user_handle_array *array );
 
-        return child_window_from_point( ptr, x - ptr->client_rect.left, y - ptr->client_rect.top );
+/* add child 'ptr' of a window and its children containing the given point to the array */
+static int add_child_from_point( struct window *ptr, int x, int y, struct user_handle_array *array )
+{
+    /* if point is in client area, and window is not minimized or disabled, check children */
+    if (!(ptr->style & (WS_MINIMIZE|WS_DISABLED)) &&
+        x >= ptr->client_rect.left && x < ptr->client_rect.right &&
+        y >= ptr->client_rect.top && y < ptr->client_rect.bottom)
+    {
+        if (!get_window_children_from_point( ptr, x - ptr->client_rect.left,
+                                             y - ptr->client_rect.top, array ))
+            return 0;
     }
-    return parent;  /* not found any child */
+
+    /* now add window to the array */
+    return add_handle_to_array( array, ptr->handle );
 }
 
 /* find all children of 'parent' that contain the given point */
 static int get_window_children_from_point( struct window *parent, int x, int y,
                                            struct user_handle_array *array )
 {
+    struct hit_iter iter;
     struct window *ptr;
 
+    if (hit_index_start( &iter, parent, x, y ))
+    {
+        while ((ptr = hit_index_next( &iter )))
+            if (is_point_in_window( ptr, x, y ) && !add_child_from_point( ptr, x, y, array )) return 0;
+        return 1;
+    }
+
     LIST_FOR_EACH_ENTRY( ptr, &parent->children, struct window, entry )
     {
         if (!is_point_in_window( ptr, x, y )) continue;  /* skip it */
-
-        /* if point is in client area, and window is not minimized or disabled, check children */
-        if (!(ptr->style & (WS_MINIMIZE|WS_DISABLED)) &&
-            x >= ptr->client_rect.left && x < ptr->client_rect.right &&
-            y >= ptr->client_rect.top && y < ptr->client_rect.bottom)
-        {
-            if (!get_window_children_from_point( ptr, x - ptr->client_rect.left,
-                                                 y - ptr->client_rect.top, array ))
-                return 0;
-        }
-
-        /* now add window to the array */
-        if (!add_handle_to_array( array, ptr->handle )) return 0;
+        if (!add_child_from_point( ptr, x, y, array )) return 0;
     }
     return 1;
 }
@@ -956,7 +1207,7 @@ static inline struct window *get_top_clipping_window( struct window *win )
 
 
 /* compute the visible region of a window, in window coordinates */
-static struct region *get_visible_region( struct window *win, unsigned int flags )
+static struct region *compute_visible_region( struct window *win, unsigned int flags )
 {
     struct region *tmp = NULL, *region;
     int offset_x, offset_y;
@@ -1042,6 +1293,41 @@ error:
 }
 
 
+/* get the visible region of a window, in window coordinates; the last region
+ * is cached until a window changes position, z-order, style or region */
+static struct region *get_visible_region( struct window *win, unsigned int flags )
+{
+    struct region *region;
+
+    flags &= DCX_PARENTCLIP | DCX_WINDOW | DCX_CLIPCHILDREN;  /* the only ones that matter */
+
+    if (win->vis_cache && win->vis_cache_serial == visible_serial && win->vis_cache_flags == flags)
+    {
+        if (!(region = create_empty_region())) return NULL;
+        if (copy_region( region, win->vis_cache )) return region;
+        free_region( region );
+        return NULL;
+    }
+
+    if (!(region = compute_visible_region( win, flags ))) return NULL;
+
+    if ((win->vis_cache || (win->vis_cache = create_empty_region())) &&
+        copy_region( win->vis_cache, region ))
+    {
+        win->vis_cache_flags  = flags;
+        win->vis_cache_serial = visible_serial;
+    }
+    else
+    {
+        /* no cache then, but the region itself is fine */
+        if (win->vis_cache) free_region( win->vis_cache );
+        win->vis_cache = NULL;
+        clear_error();
+    }
+    return region;
+}
+
+
 /* clip all children with a custom pixel format out of the visible region */
 static struct region *clip_pixel_format_children( struct window *parent, struct region *parent_clip,
                                                   struct region *region, int offset_x, int offset_y )
@@ -1646,6 +1932,12 @@ static void set_window_pos( struct window *win, struct window *previous,
     if (swp_flags & SWP_SHOWWINDOW) win->style |= WS_VISIBLE;
     else if (swp_flags & SWP_HIDEWINDOW) win->style &= ~WS_VISIBLE;
 
+    invalidate_visible_regions();
+    if (memcmp( visible_rect, &old_visible_rect, sizeof(old_visible_rect) ))
+        invalidate_hit_index( win->parent );
+    if (memcmp( client_rect, &old_client_rect, sizeof(old_client_rect) ))
+        invalidate_hit_index( win );
+
     /* keep children at the same position relative to top right corner when the parent is mirrored */
     if (win->ex_style & WS_EX_LAYOUTRTL)
     {
@@ -1800,6 +2092,7 @@ static void set_window_region( struct window *win, struct region *region, int re
 
     if (win->win_region) free_region( win->win_region );
     win->win_region = region;
+    invalidate_visible_regions();
 
     /* expose anything revealed by the change */
     if (old_vis_rgn && ((exposed_rgn = expose_window( win, &win->window_rect, old_vis_rgn ))))
@@ -1821,6 +2114,7 @@ void destroy_window( struct window *win )
     {
         struct region *vis_rgn = get_visible_region( win, DCX_WINDOW );
         win->style &= ~WS_VISIBLE;
+        invalidate_visible_regions();
         if (vis_rgn)
         {
             struct region *exposed_rgn = expose_window( win, &win->window_rect, vis_rgn );
@@ -1845,6 +2139,9 @@ void destroy_window( struct window *win )
     free_hotkeys( win->desktop, win->handle );
     free_user_handle( win->handle );
     destroy_properties( win );
+    if (win->is_linked) invalidate_hit_index( win->parent );
+    invalidate_hit_index( win );
+    invalidate_visible_regions();
     list_remove( &win->entry );
     if (is_desktop_window(win))
     {
@@ -1856,6 +2153,7 @@ void destroy_window( struct window *win )
     detach_window_thread( win );
     if (win->win_region) free_region( win->win_region );
     if (win->update_region) free_region( win->update_region );
+    if (win->vis_cache) free_region( win->vis_cache );
     if (win->class) release_class( win->class );
     free( win->text );
     memset( win, 0x55, sizeof(*win) + win->nb_extra_bytes - 1 );
@@ -2050,6 +2348,7 @@ DECL_HANDLER(set_window_info)
     reply->old_id        = win->id;
     reply->old_instance  = win->instance;
     reply->old_user_data = win->user_data;
+    if (req->flags & (SET_WIN_STYLE | SET_WIN_EXSTYLE)) invalidate_visible_regions();
     if (req->flags & SET_WIN_STYLE) win->style = req->style;
     if (req->flags & SET_WIN_EXSTYLE)
     {
@@ -2616,6 +2915,8 @@ DECL_HANDLER(update_window_zorder)
         /* making sure to not violate the topmost rule */
         if (!(ptr->ex_style & WS_EX_TOPMOST) || (win->ex_style & WS_EX_TOPMOST))
         {
+            invalidate_hit_index( win->parent );
+            invalidate_visible_regions();
             list_remove( &win->entry );
             wine_list_add_before( &ptr->entry, &win->entry );
         }
@@ -2711,14 +3012,13 @@ DECL_HANDLER(get_window_properties)
     reply->total = 0;
     if (!win) return;
 
-    for (i = count = 0; i < win->prop_inuse; i++)
-        if (win->properties[i].type != PROP_TYPE_FREE) count++;
+    count = win->prop_inuse;
     reply->total = count;
 
     if (count > max) count = max;
     if (!count || !(data = set_reply_data_size( count * sizeof(*data) ))) return;
 
-    for (i = 0; i < win->prop_inuse && count; i++)
+    for (i = 0; i < win->prop_alloc && count; i++)
     {
         if (win->properties[i].type == PROP_TYPE_FREE) continue;
         data->atom   = win->properties[i].atom;
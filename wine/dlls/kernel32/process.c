@@ -1931,7 +1931,7 @@ static BOOL create_process( HANDLE hFile, LPCWSTR filename, LPWSTR cmd_line, LPW
     static const char *cpu_names[] = { "x86", "x86_64", "PowerPC", "ARM", "ARM64" };
     NTSTATUS status;
     BOOL success = FALSE;
-    HANDLE process_info;
+    HANDLE process_info, handles[3];
     WCHAR *env_end;
     char *winedebug = NULL;
     startup_info_t *startup_info;
@@ -2124,9 +2124,10 @@ static BOOL create_process( HANDLE hFile, LPCWSTR filename, LPWSTR cmd_line, LPW
     return success;
 
 error:
-    CloseHandle( process_info );
-    CloseHandle( info->hProcess );
-    CloseHandle( info->hThread );
+    handles[0] = process_info;
+    handles[1] = info->hProcess;
+    handles[2] = info->hThread;
+    wine_server_close_handles( handles, 3 );
     info->hProcess = info->hThread = 0;
     info->dwProcessId = info->dwThreadId = 0;
     return FALSE;
@@ -2550,6 +2551,7 @@ static DWORD wait_input_idle( HANDLE process, DWORD timeout )
 UINT WINAPI WinExec( LPCSTR lpCmdLine, UINT nCmdShow )
 {
     PROCESS_INFORMATION info;
+    HANDLE handles[2];
     STARTUPINFOA startup;
     char *cmdline;
     UINT ret;
@@ -2571,8 +2573,9 @@ UINT WINAPI WinExec( LPCSTR lpCmdLine, UINT nCmdShow )
             WARN("WaitForInputIdle failed: Error %d\n", GetLastError() );
         ret = 33;
         /* Close off the handles */
-        CloseHandle( info.hThread );
-        CloseHandle( info.hProcess );
+        handles[0] = info.hThread;
+        handles[1] = info.hProcess;
+        wine_server_close_handles( handles, 2 );
     }
     else if ((ret = GetLastError()) >= 32)
     {
@@ -2591,6 +2594,7 @@ DWORD WINAPI LoadModule( LPCSTR name, LPVOID paramBlock )
 {
     LOADPARMS32 *params = paramBlock;
     PROCESS_INFORMATION info;
+    HANDLE handles[2];
     STARTUPINFOA startup;
     DWORD ret;
     LPSTR cmdline, p;
@@ -2629,8 +2633,9 @@ DWORD WINAPI LoadModule( LPCSTR name, LPVOID paramBlock )
             WARN("WaitForInputIdle failed: Error %d\n", GetLastError() );
         ret = 33;
         /* Close off the handles */
-        CloseHandle( info.hThread );
-        CloseHandle( info.hProcess );
+        handles[0] = info.hThread;
+        handles[1] = info.hProcess;
+        wine_server_close_handles( handles, 2 );
     }
     else if ((ret = GetLastError()) >= 32)
     {
@@ -2141,6 +2141,32 @@ BOOL WINAPI GetQueuedCompletionStatus( HANDLE CompletionPort, LPDWORD lpNumberOf
 }
 
 
+/******************************************************************************
+ *		GetQueuedCompletionStatusEx (KERNEL32.@)
+ */
+BOOL WINAPI GetQueuedCompletionStatusEx( HANDLE CompletionPort, LPOVERLAPPED_ENTRY lpCompletionPortEntries,
+                                         ULONG ulCount, PULONG ulNumEntriesRemoved,
+                                         DWORD dwMilliseconds, BOOL fAlertable )
+{
+    LARGE_INTEGER wait_time;
+    NTSTATUS status;
+
+    TRACE("(%p,%p,%u,%p,%u,%d)\n", CompletionPort, lpCompletionPortEntries, ulCount,
+          ulNumEntriesRemoved, dwMilliseconds, fAlertable);
+
+    /* OVERLAPPED_ENTRY has the same layout as FILE_IO_COMPLETION_INFORMATION */
+    status = NtRemoveIoCompletionEx( CompletionPort, (FILE_IO_COMPLETION_INFORMATION *)lpCompletionPortEntries,
+                                     ulCount, ulNumEntriesRemoved, get_nt_timeout( &wait_time, dwMilliseconds ),
+                                     fAlertable );
+    if (status == STATUS_SUCCESS) return TRUE;
+
+    if (status == STATUS_TIMEOUT) SetLastError( WAIT_TIMEOUT );
+    else if (status == STATUS_USER_APC) SetLastError( WAIT_IO_COMPLETION );
+    else SetLastError( RtlNtStatusToDosError(status) );
+    return FALSE;
+}
+
+
 /******************************************************************************
  *		PostQueuedCompletionStatus (KERNEL32.@)
  */
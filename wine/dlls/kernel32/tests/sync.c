@@ -46,6 +46,7 @@ static VOID   (WINAPI *pInitializeConditionVariable)(PCONDITION_VARIABLE);
 static BOOL   (WINAPI *pSleepConditionVariableCS)(PCONDITION_VARIABLE,PCRITICAL_SECTION,DWORD);
 static VOID   (WINAPI *pWakeAllConditionVariable)(PCONDITION_VARIABLE);
 static VOID   (WINAPI *pWakeConditionVariable)(PCONDITION_VARIABLE);
+static BOOL   (WINAPI *pGetQueuedCompletionStatusEx)(HANDLE,LPOVERLAPPED_ENTRY,ULONG,PULONG,DWORD,BOOL);
 
 static void test_signalandwait(void)
 {
@@ -727,6 +728,125 @@ static void CALLBACK timer_queue_cb6(PVOID p, BOOLEAN timedOut)
     }
 }
 
+static DWORD WINAPI iocp_waiter_thread(LPVOID arg)
+{
+    HANDLE port = arg;
+    ULONG_PTR key = 0;
+    OVERLAPPED *ovl;
+    DWORD bytes;
+
+    if (!GetQueuedCompletionStatus(port, &bytes, &key, &ovl, 5000)) return 0;
+    return key;
+}
+
+static void test_iocp_status_ex(void)
+{
+    OVERLAPPED_ENTRY entries[4], unused;
+    OVERLAPPED ovl[3];
+    HANDLE port, threads[2];
+    ULONG removed, i;
+    DWORD ret, code, start;
+    BOOL retb;
+
+    if (!pGetQueuedCompletionStatusEx)
+    {
+        win_skip("GetQueuedCompletionStatusEx not available\n");
+        return;
+    }
+
+    port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    ok(port != NULL, "CreateIoCompletionPort failed: %u\n", GetLastError());
+
+    SetLastError(0xdeadbeef);
+    removed = 0xdeadbeef;
+    retb = pGetQueuedCompletionStatusEx(port, entries, 4, &removed, 0, FALSE);
+    ok(!retb, "GetQueuedCompletionStatusEx succeeded on an empty port\n");
+    ok(GetLastError() == WAIT_TIMEOUT, "expected WAIT_TIMEOUT, got %u\n", GetLastError());
+
+    SetLastError(0xdeadbeef);
+    start = GetTickCount();
+    retb = pGetQueuedCompletionStatusEx(port, entries, 4, &removed, 100, FALSE);
+    ok(!retb, "GetQueuedCompletionStatusEx succeeded on an empty port\n");
+    ok(GetLastError() == WAIT_TIMEOUT, "expected WAIT_TIMEOUT, got %u\n", GetLastError());
+    ok(GetTickCount() - start >= 80, "returned after %u ms\n", GetTickCount() - start);
+
+    for (i = 0; i < 3; i++)
+    {
+        retb = PostQueuedCompletionStatus(port, 10 + i, 1 + i, &ovl[i]);
+        ok(retb, "PostQueuedCompletionStatus failed: %u\n", GetLastError());
+    }
+
+    /* the count limits the batch, entries come out in posting order */
+    memset(entries, 0xcc, sizeof(entries));
+    memset(&unused, 0xcc, sizeof(unused));
+    removed = 0xdeadbeef;
+    retb = pGetQueuedCompletionStatusEx(port, entries, 2, &removed, 0, FALSE);
+    ok(retb, "GetQueuedCompletionStatusEx failed: %u\n", GetLastError());
+    ok(removed == 2, "expected 2 entries, got %u\n", removed);
+    for (i = 0; i < 2; i++)
+    {
+        ok(entries[i].lpCompletionKey == 1 + i, "%u: wrong key %lu\n", i, entries[i].lpCompletionKey);
+        ok(entries[i].lpOverlapped == &ovl[i], "%u: wrong overlapped %p\n", i, entries[i].lpOverlapped);
+        ok(entries[i].dwNumberOfBytesTransferred == 10 + i, "%u: wrong count %u\n", i, entries[i].dwNumberOfBytesTransferred);
+    }
+    ok(!memcmp(&entries[2], &unused, sizeof(unused)), "entry past the count was written\n");
+
+    removed = 0xdeadbeef;
+    retb = pGetQueuedCompletionStatusEx(port, entries, 4, &removed, 0, FALSE);
+    ok(retb, "GetQueuedCompletionStatusEx failed: %u\n", GetLastError());
+    ok(removed == 1, "expected 1 entry, got %u\n", removed);
+    ok(entries[0].lpCompletionKey == 3, "wrong key %lu\n", entries[0].lpCompletionKey);
+    ok(entries[0].lpOverlapped == &ovl[2], "wrong overlapped %p\n", entries[0].lpOverlapped);
+
+    /* the thread that started waiting last is woken first */
+    threads[0] = CreateThread(NULL, 0, iocp_waiter_thread, port, 0, NULL);
+    Sleep(200);
+    threads[1] = CreateThread(NULL, 0, iocp_waiter_thread, port, 0, NULL);
+    Sleep(200);
+
+    retb = PostQueuedCompletionStatus(port, 0, 1, NULL);
+    ok(retb, "PostQueuedCompletionStatus failed: %u\n", GetLastError());
+    ret = WaitForMultipleObjects(2, threads, FALSE, 5000);
+    ok(ret == WAIT_OBJECT_0 + 1, "expected the last waiter to wake, got %u\n", ret);
+    GetExitCodeThread(threads[1], &code);
+    ok(code == 1, "last waiter got key %u\n", code);
+
+    retb = PostQueuedCompletionStatus(port, 0, 2, NULL);
+    ok(retb, "PostQueuedCompletionStatus failed: %u\n", GetLastError());
+    ret = WaitForSingleObject(threads[0], 5000);
+    ok(ret == WAIT_OBJECT_0, "first waiter did not wake: %u\n", ret);
+    GetExitCodeThread(threads[0], &code);
+    ok(code == 2, "first waiter got key %u\n", code);
+    CloseHandle(threads[0]);
+    CloseHandle(threads[1]);
+
+    /* with a concurrency of 1, a running thread that dequeued a message
+     * holds back the next one until it waits again */
+    retb = PostQueuedCompletionStatus(port, 0, 3, NULL);
+    ok(retb, "PostQueuedCompletionStatus failed: %u\n", GetLastError());
+    retb = pGetQueuedCompletionStatusEx(port, entries, 1, &removed, 0, FALSE);
+    ok(retb, "GetQueuedCompletionStatusEx failed: %u\n", GetLastError());
+    ok(removed == 1 && entries[0].lpCompletionKey == 3, "got %u entries, key %lu\n", removed, entries[0].lpCompletionKey);
+
+    threads[0] = CreateThread(NULL, 0, iocp_waiter_thread, port, 0, NULL);
+    retb = PostQueuedCompletionStatus(port, 0, 4, NULL);
+    ok(retb, "PostQueuedCompletionStatus failed: %u\n", GetLastError());
+
+    /* spin instead of sleeping, a wait would make this thread inactive */
+    start = GetTickCount();
+    while (GetTickCount() - start < 300) ;
+    GetExitCodeThread(threads[0], &code);
+    ok(code == STILL_ACTIVE, "waiter ran beyond the concurrency limit, key %u\n", code);
+
+    ret = WaitForSingleObject(threads[0], 5000);
+    ok(ret == WAIT_OBJECT_0, "waiter did not wake: %u\n", ret);
+    GetExitCodeThread(threads[0], &code);
+    ok(code == 4, "waiter got key %u\n", code);
+    CloseHandle(threads[0]);
+
+    CloseHandle(port);
+}
+
 static void test_timer_queue(void)
 {
     HANDLE q, t0, t1, t2, t3, t4, t5;
@@ -1687,6 +1807,7 @@ START_TEST(sync)
     pSleepConditionVariableCS = (void *)GetProcAddress(hdll, "SleepConditionVariableCS");
     pWakeAllConditionVariable = (void *)GetProcAddress(hdll, "WakeAllConditionVariable");
     pWakeConditionVariable = (void *)GetProcAddress(hdll, "WakeConditionVariable");
+    pGetQueuedCompletionStatusEx = (void *)GetProcAddress(hdll, "GetQueuedCompletionStatusEx");
 
     test_signalandwait();
     test_mutex();
@@ -1695,6 +1816,7 @@ START_TEST(sync)
     test_semaphore();
     test_waitable_timer();
     test_iocp_callback();
+    test_iocp_status_ex();
     test_timer_queue();
     test_WaitForSingleObject();
     test_WaitForMultipleObjects();
@@ -224,6 +224,77 @@ static void test_VirtualAllocEx(void)
     CloseHandle(hProcess);
 }
 
+static void test_ReadWriteProcessMemory(void)
+{
+    const SIZE_T alloc_size = 3 * MAPPING_SIZE + 0x3000;  /* spans several copy chunks */
+    char *src, *dst, *addr;
+    SIZE_T bytes, i;
+    DWORD old_prot, start, ticks;
+    HANDLE hProcess;
+    BOOL b;
+
+    if (!pVirtualAllocEx || !pVirtualFreeEx)
+    {
+        win_skip("Virtual{Alloc,Free}Ex not available\n");
+        return;
+    }
+
+    hProcess = create_target_process("sleep");
+    ok(hProcess != NULL, "Can't start process\n");
+
+    addr = pVirtualAllocEx(hProcess, NULL, alloc_size, MEM_COMMIT, PAGE_READWRITE);
+    ok(addr != NULL, "VirtualAllocEx error %u\n", GetLastError());
+    src = VirtualAlloc(NULL, alloc_size, MEM_COMMIT, PAGE_READWRITE);
+    dst = VirtualAlloc(NULL, alloc_size, MEM_COMMIT, PAGE_READWRITE);
+    for (i = 0; i < alloc_size; i++) src[i] = (i * 7) ^ (i >> 12);
+
+    /* unaligned copy across chunk boundaries */
+    b = WriteProcessMemory(hProcess, addr + 1, src + 1, alloc_size - 2, &bytes);
+    ok(b && bytes == alloc_size - 2, "WriteProcessMemory failed %u, %lu bytes written\n", GetLastError(), bytes);
+    b = ReadProcessMemory(hProcess, addr + 1, dst + 1, alloc_size - 2, &bytes);
+    ok(b && bytes == alloc_size - 2, "ReadProcessMemory failed %u, %lu bytes read\n", GetLastError(), bytes);
+    ok(!memcmp(src + 1, dst + 1, alloc_size - 2), "Data from remote process differs\n");
+
+    /* a protected page in the target stops the copy */
+    b = VirtualProtectEx(hProcess, addr + 0x2000, 0x1000, PAGE_NOACCESS, &old_prot);
+    ok(b, "VirtualProtectEx failed error %u\n", GetLastError());
+    memset(dst, 0, 0x4000);
+    SetLastError(0xdeadbeef);
+    b = ReadProcessMemory(hProcess, addr, dst, 0x4000, &bytes);
+    ok(!b, "ReadProcessMemory succeeded\n");
+    ok(GetLastError() == ERROR_PARTIAL_COPY || GetLastError() == ERROR_NOACCESS,
+       "wrong error %u\n", GetLastError());
+    ok(bytes <= 0x2000, "%lu bytes read\n", bytes);
+    ok(!memcmp(src, dst, bytes), "partial data from remote process differs\n");
+    SetLastError(0xdeadbeef);
+    b = WriteProcessMemory(hProcess, addr, src, 0x4000, &bytes);
+    ok(!b, "WriteProcessMemory succeeded\n");
+    ok(GetLastError() == ERROR_PARTIAL_COPY || GetLastError() == ERROR_NOACCESS,
+       "wrong error %u\n", GetLastError());
+    ok(bytes <= 0x2000, "%lu bytes written\n", bytes);
+    b = VirtualProtectEx(hProcess, addr + 0x2000, 0x1000, PAGE_READWRITE, &old_prot);
+    ok(b, "VirtualProtectEx failed error %u\n", GetLastError());
+
+    /* throughput, for reference */
+    start = GetTickCount();
+    for (i = 0; i < 16; i++)
+    {
+        b = ReadProcessMemory(hProcess, addr, dst, alloc_size, &bytes);
+        if (!b || bytes != alloc_size) break;
+    }
+    ok(i == 16, "ReadProcessMemory failed %u, %lu bytes read\n", GetLastError(), bytes);
+    ticks = GetTickCount() - start;
+    trace("ReadProcessMemory: %lu MB in %u ms\n", i * alloc_size >> 20, ticks);
+
+    b = pVirtualFreeEx(hProcess, addr, 0, MEM_RELEASE);
+    ok(b, "VirtualFreeEx, error %u\n", GetLastError());
+    VirtualFree(src, 0, MEM_RELEASE);
+    VirtualFree(dst, 0, MEM_RELEASE);
+
+    TerminateProcess(hProcess, 0);
+    CloseHandle(hProcess);
+}
+
 static void test_VirtualAlloc(void)
 {
     void *addr1, *addr2;
@@ -2538,6 +2609,7 @@ START_TEST(virtual)
     test_VirtualAlloc_protection();
     test_VirtualProtect();
     test_VirtualAllocEx();
+    test_ReadWriteProcessMemory();
     test_VirtualAlloc();
     test_MapViewOfFile();
     test_NtMapViewOfSection();
@@ -86,6 +86,11 @@ extern size_t server_init_thread( void *entry_point ) DECLSPEC_HIDDEN;
 extern void DECLSPEC_NORETURN abort_thread( int status ) DECLSPEC_HIDDEN;
 extern void DECLSPEC_NORETURN terminate_thread( int status ) DECLSPEC_HIDDEN;
 extern void DECLSPEC_NORETURN exit_thread( int status ) DECLSPEC_HIDDEN;
+#ifdef CONFIG_UNIFIED_KERNEL
+extern void close_syscall_channel(void) DECLSPEC_HIDDEN;
+extern const struct __server_sync_slot *server_get_sync_slot( HANDLE handle, unsigned int *access ) DECLSPEC_HIDDEN;
+extern void server_remove_sync_from_cache( HANDLE handle ) DECLSPEC_HIDDEN;
+#endif
 extern sigset_t server_block_set DECLSPEC_HIDDEN;
 extern void server_enter_uninterrupted_section( RTL_CRITICAL_SECTION *cs, sigset_t *sigset ) DECLSPEC_HIDDEN;
 extern void server_leave_uninterrupted_section( RTL_CRITICAL_SECTION *cs, sigset_t *sigset ) DECLSPEC_HIDDEN;
@@ -235,6 +240,9 @@ struct ntdll_thread_data
     WINE_VM86_TEB_INFO vm86;          /* 1fc vm86 private data */
     void              *exit_frame;    /* 204 exit frame pointer */
 #endif
+#ifdef CONFIG_UNIFIED_KERNEL
+    int                syscall_fd;    /* 208/318 per-thread /dev/syscall channel */
+#endif
 };
 
 static inline struct ntdll_thread_data *ntdll_get_thread_data(void)
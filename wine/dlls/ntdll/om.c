@@ -336,6 +336,9 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source,
             {
                 int fd = server_remove_fd_from_cache( source );
                 if (fd != -1) close( fd );
+#ifdef CONFIG_UNIFIED_KERNEL
+                server_remove_sync_from_cache( source );
+#endif
             }
         }
     }
@@ -349,6 +352,9 @@ NTSTATUS close_handle( HANDLE handle )
     NTSTATUS ret;
     int fd = server_remove_fd_from_cache( handle );
 
+#ifdef CONFIG_UNIFIED_KERNEL
+    server_remove_sync_from_cache( handle );
+#endif
     SERVER_START_REQ( close_handle )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -359,6 +365,55 @@ NTSTATUS close_handle( HANDLE handle )
     return ret;
 }
 
+/***********************************************************************
+ *           wine_server_close_handles   (NTDLL.@)
+ *
+ * Close several handles with as few server round trips as possible.
+ *
+ * PARAMS
+ *     handles [I] handles to close
+ *     count   [I] number of handles
+ *
+ * RETURNS
+ *     The first error; all the handles are closed even if some of them fail.
+ */
+NTSTATUS CDECL wine_server_close_handles( const HANDLE *handles, unsigned int count )
+{
+    struct __server_request_info reqs[__SERVER_MAX_BATCH];
+    void *req_ptrs[__SERVER_MAX_BATCH];
+    int fds[__SERVER_MAX_BATCH];
+    unsigned int i, done, n;
+    NTSTATUS status, ret = STATUS_SUCCESS;
+
+    while (count)
+    {
+        n = min( count, __SERVER_MAX_BATCH );
+        for (i = 0; i < n; i++)
+        {
+            struct close_handle_request *req = &reqs[i].u.req.close_handle_request;
+
+            fds[i] = server_remove_fd_from_cache( handles[i] );
+#ifdef CONFIG_UNIFIED_KERNEL
+            server_remove_sync_from_cache( handles[i] );
+#endif
+            memset( &reqs[i].u.req, 0, sizeof(reqs[i].u.req) );
+            reqs[i].u.req.request_header.req = REQ_close_handle;
+            reqs[i].data_count = 0;
+            req->handle = wine_server_obj_handle( handles[i] );
+            req_ptrs[i] = &reqs[i];
+        }
+        status = wine_server_call_batch( req_ptrs, n, &done );
+        for (i = 0; i < n; i++) if (fds[i] != -1) close( fds[i] );
+        if (status && !ret) ret = status;
+
+        /* the batch stops at the failing request, resume after it */
+        if (!done) done = n;
+        handles += done;
+        count -= done;
+    }
+    return ret;
+}
+
 /**************************************************************************
  *                 NtClose				[NTDLL.@]
  *
@@ -137,6 +137,8 @@ void WINAPI RtlInitializeResource(LPRTL_RWLOCK rwl)
  */
 void WINAPI RtlDeleteResource(LPRTL_RWLOCK rwl)
 {
+    HANDLE sems[2];
+
     if( rwl )
     {
 	RtlEnterCriticalSection( &rwl->rtlCS );
@@ -145,8 +147,9 @@ void WINAPI RtlDeleteResource(LPRTL_RWLOCK rwl)
 	rwl->hOwningThreadId = 0;
 	rwl->uExclusiveWaiters = rwl->uSharedWaiters = 0;
 	rwl->iNumberActive = 0;
-	NtClose( rwl->hExclusiveReleaseSemaphore );
-	NtClose( rwl->hSharedReleaseSemaphore );
+	sems[0] = rwl->hExclusiveReleaseSemaphore;
+	sems[1] = rwl->hSharedReleaseSemaphore;
+	wine_server_close_handles( sems, 2 );
 	RtlLeaveCriticalSection( &rwl->rtlCS );
 	rwl->rtlCS.DebugInfo->Spare[0] = 0;
 	RtlDeleteCriticalSection( &rwl->rtlCS );
@@ -1487,6 +1487,7 @@ RtlImpersonateSelf(SECURITY_IMPERSONATION_LEVEL ImpersonationLevel)
     OBJECT_ATTRIBUTES ObjectAttributes;
     HANDLE ProcessToken;
     HANDLE ImpersonationToken;
+    HANDLE tokens[2];
 
     TRACE("(%08x)\n", ImpersonationLevel);
 
@@ -1514,8 +1515,9 @@ RtlImpersonateSelf(SECURITY_IMPERSONATION_LEVEL ImpersonationLevel)
                                      &ImpersonationToken,
                                      sizeof(ImpersonationToken) );
 
-    NtClose( ImpersonationToken );
-    NtClose( ProcessToken );
+    tokens[0] = ImpersonationToken;
+    tokens[1] = ProcessToken;
+    wine_server_close_handles( tokens, 2 );
 
     return Status;
 }
@@ -263,29 +263,99 @@ static inline unsigned int wait_reply( struct __server_request_info *req )
 
 
 #ifdef CONFIG_UNIFIED_KERNEL
+/***********************************************************************
+ *           open_syscall_channel
+ *
+ * Open a new channel to the kernel module.
+ */
+static void open_syscall_channel( struct ntdll_thread_data *thread_data )
+{
+    int fd;
+
+    fd = open( SYSCALL_FILE, O_RDWR );
+    if (fd == -1)
+    {
+        ERR("open SYSCALL_FILE error %d \n",errno);
+        return;
+    }
+    fcntl( fd, F_SETFD, FD_CLOEXEC );
+    thread_data->syscall_fd = fd;
+}
+
+/***********************************************************************
+ *           get_syscall_channel
+ *
+ * Return the /dev/syscall channel of the current thread. It is normally
+ * opened at thread init time and kept open until the thread exits; if
+ * that failed, try again on first use.
+ */
+static inline int get_syscall_channel(void)
+{
+    struct ntdll_thread_data *thread_data = ntdll_get_thread_data();
+
+    if (thread_data->syscall_fd == -1) open_syscall_channel( thread_data );
+    return thread_data->syscall_fd;
+}
+
+/***********************************************************************
+ *           close_syscall_channel
+ */
+void close_syscall_channel(void)
+{
+    struct ntdll_thread_data *thread_data = ntdll_get_thread_data();
+
+    if (thread_data->syscall_fd == -1) return;
+    close( thread_data->syscall_fd );
+    thread_data->syscall_fd = -1;
+}
+
 unsigned int wine_server_call( void *req_ptr )
 {
     struct __server_request_info * const req = req_ptr;
     int ret = 0;
     int fd;
 
-    fd = open( SYSCALL_FILE, O_WRONLY);
-    if (fd == -1)
+    fd = get_syscall_channel();
+    if (fd == -1) return errno;
+
+    ret = ioctl(fd, Nt_WineService, req);
+    if (ret == -1)
     {
-        ERR("open SYSCALL_FILE error %d \n",errno);
-        return errno;
+        ERR("p %d t %d : ioctl ret=%d error %d \n", getpid(), (int)syscall(224), ret, errno);
     }
-    else
+
+    return ret;
+}
+
+unsigned int wine_server_call_batch( void * const *req_ptrs, unsigned int count, unsigned int *done )
+{
+    struct __server_request_batch batch;
+    unsigned int i;
+    int ret, fd;
+
+    *done = 0;
+    if (!count) return STATUS_SUCCESS;
+
+    fd = get_syscall_channel();
+    if (fd == -1) return errno;
+
+    while (count)
     {
-        ret = ioctl(fd, Nt_WineService, req);
+        batch.count = min( count, __SERVER_MAX_BATCH );
+        batch.done = 0;
+        for (i = 0; i < batch.count; i++) batch.reqs[i] = req_ptrs[*done + i];
+
+        ret = ioctl(fd, Nt_WineServiceBatch, &batch);
         if (ret == -1)
         {
             ERR("p %d t %d : ioctl ret=%d error %d \n", getpid(), (int)syscall(224), ret, errno);
+            return ret;
         }
-        close(fd);
+        *done += batch.done;
+        if (ret) return ret;
+        count -= batch.count;
     }
-
-    return ret;
+    return STATUS_SUCCESS;
 }
 #else
 /***********************************************************************
@@ -322,6 +392,29 @@ unsigned int wine_server_call( void *req_ptr )
     pthread_sigmask( SIG_SETMASK, &old_set, NULL );
     return ret;
 }
+
+/***********************************************************************
+ *           wine_server_call_batch (NTDLL.@)
+ *
+ * Perform several independent server calls in order, stopping at the
+ * first one that fails.
+ *
+ * PARAMS
+ *     req_ptrs [I/O] Array of requests, as for wine_server_call
+ *     count    [I]   Number of requests
+ *     done     [O]   Number of requests that were performed
+ *
+ * RETURNS
+ *     The status of the last request performed.
+ */
+unsigned int wine_server_call_batch( void * const *req_ptrs, unsigned int count, unsigned int *done )
+{
+    unsigned int ret = STATUS_SUCCESS;
+
+    for (*done = 0; *done < count && !ret; (*done)++)
+        ret = wine_server_call( req_ptrs[*done] );
+    return ret;
+}
 #endif
 
 
@@ -381,20 +474,35 @@ static int __wait_select_reply( void *cookie, int fd )
 
 static int wait_select_reply( void *cookie )
 {
-    int fd, ret;
+    int fd;
 
-    fd = open( SYSCALL_FILE, O_RDWR );
-    if (fd == -1)
-    {
-        ERR("open SYSCALL_FILE error %d \n",errno);
-        return -1;
-    }
-    else
+    fd = get_syscall_channel();
+    if (fd == -1) return -1;
+
+    return __wait_select_reply( cookie, fd );
+}
+
+/***********************************************************************
+ *              server_call_select
+ *
+ * Send a select request and, if it has to wait, wait for the wakeup in
+ * the same ioctl. STATUS_PENDING is only returned when the wait has been
+ * interrupted; the wakeup must then be read with wait_select_reply.
+ */
+static unsigned int server_call_select( void *req_ptr )
+{
+    int ret, fd;
+
+    fd = get_syscall_channel();
+    if (fd == -1) return errno;
+
+    ret = ioctl(fd, Nt_WineServiceWait, req_ptr);
+    if (ret == -1)
     {
-        ret = __wait_select_reply( cookie, fd );
-        close(fd);
-        return ret;
+        if (errno == EINTR) return STATUS_PENDING;
+        ERR("p %d t %d : ioctl ret=%d error %d \n", getpid(), (int)syscall(224), ret, errno);
     }
+    return ret;
 }
 #else
 /***********************************************************************
@@ -668,7 +776,11 @@ unsigned int server_select( const select_op_t *select_op, data_size_t size, UINT
             req->timeout  = abs_timeout;
             wine_server_add_data( req, &result, sizeof(result) );
             wine_server_add_data( req, select_op, size );
+#ifdef CONFIG_UNIFIED_KERNEL
+            ret = server_call_select( req );
+#else
             ret = wine_server_call( req );
+#endif
             abs_timeout = reply->timeout;
             apc_handle  = reply->apc_handle;
             call        = reply->call;
@@ -978,6 +1090,125 @@ int server_remove_fd_from_cache( HANDLE handle )
 }
 
 
+#ifdef CONFIG_UNIFIED_KERNEL
+/***********************************************************************/
+/* sync slot cache support */
+
+struct sync_cache_entry
+{
+    int          index;   /* slot index, 0 if not known yet, -1 if the object has none */
+    unsigned int seq;     /* sequence number of the slot */
+    unsigned int access;  /* access rights of the handle */
+};
+
+#define SYNC_CACHE_BLOCK_SIZE  (65536 / sizeof(struct sync_cache_entry))
+#define SYNC_CACHE_ENTRIES     128
+
+static struct sync_cache_entry *sync_cache[SYNC_CACHE_ENTRIES];
+static const struct __server_sync_slot *sync_page;
+static int fast_sync = -1;  /* WINE_FAST_SYNC setting, -1 until checked */
+
+static inline unsigned int sync_handle_to_index( HANDLE handle, unsigned int *entry )
+{
+    unsigned int idx = (wine_server_obj_handle(handle) >> 2) - 1;
+    *entry = idx / SYNC_CACHE_BLOCK_SIZE;
+    return idx % SYNC_CACHE_BLOCK_SIZE;
+}
+
+/***********************************************************************
+ *           map_sync_page
+ *
+ * Check whether the fast sync mode is enabled, and map the sync page if so.
+ */
+static BOOL map_sync_page(void)
+{
+    const char *env;
+    void *page;
+    int fd;
+
+    if (fast_sync != -1) return fast_sync;
+
+    if ((env = getenv( "WINE_FAST_SYNC" )) && atoi( env ) > 0 && (fd = get_syscall_channel()) != -1)
+    {
+        page = mmap( NULL, SERVER_SYNC_SIZE, PROT_READ, MAP_SHARED, fd, SERVER_SYNC_OFFSET );
+        if (page != MAP_FAILED && interlocked_cmpxchg_ptr( (void **)&sync_page, page, NULL ))
+            munmap( page, SERVER_SYNC_SIZE );  /* another thread got there first */
+    }
+    fast_sync = (sync_page != NULL);
+    return fast_sync;
+}
+
+/***********************************************************************
+ *           server_get_sync_slot
+ *
+ * Return the shared sync slot of an event or semaphore handle, or NULL if
+ * the operation has to go through the server.
+ */
+const struct __server_sync_slot *server_get_sync_slot( HANDLE handle, unsigned int *access )
+{
+    struct sync_cache_entry *cache;
+    const struct __server_sync_slot *slot;
+    unsigned int entry, idx;
+    int index;
+    NTSTATUS ret;
+
+    if (!map_sync_page()) return NULL;
+
+    idx = sync_handle_to_index( handle, &entry );
+    if (entry >= SYNC_CACHE_ENTRIES) return NULL;  /* pseudo-handle or too many handles */
+
+    if (!(cache = sync_cache[entry]))  /* do we need to allocate a new block of entries? */
+    {
+        void *ptr = wine_anon_mmap( NULL, SYNC_CACHE_BLOCK_SIZE * sizeof(struct sync_cache_entry),
+                                    PROT_READ | PROT_WRITE, 0 );
+        if (ptr == MAP_FAILED) return NULL;
+        if (!(cache = interlocked_cmpxchg_ptr( (void **)&sync_cache[entry], ptr, NULL ))) cache = ptr;
+        else munmap( ptr, SYNC_CACHE_BLOCK_SIZE * sizeof(struct sync_cache_entry) );
+    }
+    cache += idx;
+
+    if (!(index = cache->index))
+    {
+        SERVER_START_REQ( get_sync_slot )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            if (!(ret = wine_server_call( req )))
+            {
+                cache->seq    = reply->seq;
+                cache->access = reply->access;
+                index = reply->index;
+            }
+            else if (ret != STATUS_INVALID_HANDLE) index = -1;  /* not an event or semaphore */
+        }
+        SERVER_END_REQ;
+        if (!index) return NULL;
+        interlocked_xchg( &cache->index, index );
+    }
+    if (index < 0) return NULL;
+
+    slot = &sync_page[index];
+    if (slot->seq != cache->seq)  /* the object is gone, the handle must be stale */
+    {
+        interlocked_cmpxchg( &cache->index, 0, index );
+        return NULL;
+    }
+    *access = cache->access;
+    return slot;
+}
+
+/***********************************************************************
+ *           server_remove_sync_from_cache
+ */
+void server_remove_sync_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = sync_handle_to_index( handle, &entry );
+
+    if (entry < SYNC_CACHE_ENTRIES && sync_cache[entry])
+        interlocked_xchg( &sync_cache[entry][idx].index, 0 );
+}
+#endif
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -1121,6 +1352,35 @@ void CDECL wine_server_release_fd( HANDLE handle, int unix_fd )
 }
 
 
+/***********************************************************************
+ *           wine_server_map_queue_page   (NTDLL.@)
+ *
+ * Map the read-only page where the server publishes the message queue bits
+ * of the threads of this process.
+ *
+ * RETURNS
+ *     the page, or NULL if the server doesn't provide one
+ */
+const struct __server_queue_slot * CDECL wine_server_map_queue_page(void)
+{
+#ifdef CONFIG_UNIFIED_KERNEL
+    static struct __server_queue_slot *queue_page;
+    void *page;
+    int fd;
+
+    if (!queue_page && (fd = get_syscall_channel()) != -1)
+    {
+        page = mmap( NULL, SERVER_QUEUE_SIZE, PROT_READ, MAP_SHARED, fd, SERVER_QUEUE_OFFSET );
+        if (page != MAP_FAILED && interlocked_cmpxchg_ptr( (void **)&queue_page, page, NULL ))
+            munmap( page, SERVER_QUEUE_SIZE );  /* another thread got there first */
+    }
+    return queue_page;
+#else
+    return NULL;
+#endif
+}
+
+
 /***********************************************************************
  *           server_pipe
  *
@@ -1467,12 +1727,8 @@ void server_init_process(void)
     struct init_data init_data;
     int ret;
 
-    fd = open( SYSCALL_FILE, O_WRONLY);
-    if (fd == -1)
-    {
-        ERR("open SYSCALL_FILE error %d \n",errno);
-        return;
-    }
+    fd = get_syscall_channel();
+    if (fd == -1) return;
 
     memset(&init_data, 0, sizeof(struct init_data));
 
@@ -1509,7 +1765,6 @@ void server_init_process(void)
     {
         ERR("p %d t %d : ioctl ret=%d error %d \n", getpid(), (int)syscall(224), ret, errno);
     }
-    close(fd);
 
     /* setup the signal mask */
     sigemptyset( &server_block_set );
@@ -1706,24 +1961,18 @@ void server_new_thread(thread_id_t tid)
     struct init_data data;
     int fd , ret;
 
-    fd = open( SYSCALL_FILE, O_WRONLY);
-    if (fd == -1)
-    {
-        ERR("open SYSCALL_FILE failed errno=%d\n",errno);
-        return;
-    }
-    else
-    {
-        memset( &data, 0, sizeof(data));
+    /* the channel opened here is kept for all the requests of the thread */
+    fd = get_syscall_channel();
+    if (fd == -1) return;
 
-        data.init_type = NEW_THREAD;
-        data.thread_id = tid;
-        ret = ioctl(fd, Nt_EarlyInit, &data);
-        if (ret == -1)
-        {
-            ERR("p %d t %d : ioctl ret=%d error %d \n", getpid(), (int)syscall(224), ret, errno);
-        }
-        close(fd);
+    memset( &data, 0, sizeof(data));
+
+    data.init_type = NEW_THREAD;
+    data.thread_id = tid;
+    ret = ioctl(fd, Nt_EarlyInit, &data);
+    if (ret == -1)
+    {
+        ERR("p %d t %d : ioctl ret=%d error %d \n", getpid(), (int)syscall(224), ret, errno);
     }
 }
 
@@ -1731,41 +1980,29 @@ void server_kill_thread(LONG exit_code)
 {
     int fd,ret;
 
-    fd = open( SYSCALL_FILE, O_WRONLY);
-    if (fd == -1)
-    {
-        ERR("open SYSCALL_FILE error %d \n",errno);
-        return;
-    }
-    else
+    fd = get_syscall_channel();
+    if (fd == -1) return;
+
+    ret = ioctl(fd, Nt_KillThread, &exit_code);
+    if (ret == -1)
     {
-        ret = ioctl(fd, Nt_KillThread, &exit_code);
-        if (ret == -1)
-        {
-            ERR("p %d t %d : ioctl ret=%d error %d \n", getpid(), (int)syscall(224), ret, errno);
-        }
-        close(fd);
+        ERR("p %d t %d : ioctl ret=%d error %d \n", getpid(), (int)syscall(224), ret, errno);
     }
+    close_syscall_channel();
 }
 
 void server_kill_process(LONG exit_code)
 {
     int fd,ret;
 
-    fd = open( SYSCALL_FILE, O_WRONLY);
-    if (fd == -1)
-    {
-        ERR("open SYSCALL_FILE error %d \n",errno);
-        return;
-    }
-    else
+    fd = get_syscall_channel();
+    if (fd == -1) return;
+
+    ret = ioctl(fd, Nt_KillProcess, &exit_code);
+    if (ret == -1)
     {
-        ret = ioctl(fd, Nt_KillProcess, &exit_code);
-        if (ret == -1)
-        {
-            ERR("p %d t %d : ioctl ret=%d error %d \n", getpid(), (int)syscall(224), ret, errno);
-        }
-        close(fd);
+        ERR("p %d t %d : ioctl ret=%d error %d \n", getpid(), (int)syscall(224), ret, errno);
     }
+    close_syscall_channel();
 }
 #endif
@@ -61,6 +61,56 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(ntdll);
 
+#ifdef CONFIG_UNIFIED_KERNEL
+/*
+ *	Fast paths through the process sync page (WINE_FAST_SYNC=1)
+ *
+ * The page is a read-only copy of the server state, so only the operations
+ * that leave the state alone can be completed here. They return
+ * STATUS_NOT_IMPLEMENTED when the operation has to go through the server.
+ */
+
+/* setting a signaled event or resetting a non-signaled one is a no-op */
+static NTSTATUS fast_event_op( HANDLE handle, enum event_op op )
+{
+    const struct __server_sync_slot *slot;
+    unsigned int access;
+
+    if (!(slot = server_get_sync_slot( handle, &access ))) return STATUS_NOT_IMPLEMENTED;
+    if (slot->type != SERVER_SYNC_AUTO_EVENT && slot->type != SERVER_SYNC_MANUAL_EVENT)
+        return STATUS_NOT_IMPLEMENTED;
+    if (!(access & EVENT_MODIFY_STATE)) return STATUS_ACCESS_DENIED;
+
+    if (op == SET_EVENT && (slot->state & SERVER_SYNC_SIGNALED)) return STATUS_SUCCESS;
+    if (op == RESET_EVENT && !(slot->state & SERVER_SYNC_SIGNALED)) return STATUS_SUCCESS;
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+/* check a wait on a single object that doesn't need to change its state;
+ * returns STATUS_TIMEOUT if it isn't signaled */
+static NTSTATUS fast_wait( HANDLE handle )
+{
+    const struct __server_sync_slot *slot;
+    unsigned int access;
+
+    if (!(slot = server_get_sync_slot( handle, &access ))) return STATUS_NOT_IMPLEMENTED;
+    if (!(access & SYNCHRONIZE)) return STATUS_NOT_IMPLEMENTED;
+
+    switch (slot->type)
+    {
+    case SERVER_SYNC_MANUAL_EVENT:
+        return (slot->state & SERVER_SYNC_SIGNALED) ? STATUS_WAIT_0 : STATUS_TIMEOUT;
+    case SERVER_SYNC_AUTO_EVENT:
+        if (!(slot->state & SERVER_SYNC_SIGNALED)) return STATUS_TIMEOUT;
+        break;
+    case SERVER_SYNC_SEMAPHORE:
+        if (!(slot->state & SERVER_SYNC_COUNT_MASK)) return STATUS_TIMEOUT;
+        break;
+    }
+    return STATUS_NOT_IMPLEMENTED;  /* the server has to consume the signal */
+}
+#endif
+
 HANDLE keyed_event = NULL;
 
 /* creates a struct security_descriptor and contained information in one contiguous piece of memory */
@@ -230,11 +280,7 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
         req->handle = wine_server_obj_handle( handle );
         if (!(ret = wine_server_call( req )))
         {
-#ifdef CONFIG_UNIFIED_KERNEL
             out->CurrentCount = reply->current_count;
-#else
-            out->CurrentCount = reply->current;
-#endif
             out->MaximumCount = reply->max;
             if (ret_len) *ret_len = sizeof(SEMAPHORE_BASIC_INFORMATION);
         }
@@ -250,6 +296,7 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
 NTSTATUS WINAPI NtReleaseSemaphore( HANDLE handle, ULONG count, PULONG previous )
 {
     NTSTATUS ret;
+
     SERVER_START_REQ( release_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -347,6 +394,9 @@ NTSTATUS WINAPI NtSetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
 
     /* FIXME: set NumberOfThreadsReleased */
 
+#ifdef CONFIG_UNIFIED_KERNEL
+    if ((ret = fast_event_op( handle, SET_EVENT )) != STATUS_NOT_IMPLEMENTED) return ret;
+#endif
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -367,6 +417,9 @@ NTSTATUS WINAPI NtResetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
     /* resetting an event can't release any thread... */
     if (NumberOfThreadsReleased) *NumberOfThreadsReleased = 0;
 
+#ifdef CONFIG_UNIFIED_KERNEL
+    if ((ret = fast_event_op( handle, RESET_EVENT )) != STATUS_NOT_IMPLEMENTED) return ret;
+#endif
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -850,6 +903,16 @@ NTSTATUS WINAPI NtWaitForMultipleObjects( DWORD count, const HANDLE *handles,
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+#ifdef CONFIG_UNIFIED_KERNEL
+    /* alertable waits have to check for APCs in the server first */
+    if (count == 1 && !alertable)
+    {
+        NTSTATUS ret = fast_wait( handles[0] );
+        if (ret == STATUS_WAIT_0) return ret;
+        if (ret == STATUS_TIMEOUT && timeout && !timeout->QuadPart) return ret;
+    }
+#endif
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_all ? SELECT_WAIT_ALL : SELECT_WAIT;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
@@ -1157,6 +1220,66 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE CompletionPort, PULONG_PTR Completi
     return status;
 }
 
+/******************************************************************
+ *              NtRemoveIoCompletionEx (NTDLL.@)
+ *              ZwRemoveIoCompletionEx (NTDLL.@)
+ *
+ * (Wait for and) retrieve up to count completion messages from completion
+ * object's queue, all of them with a single server call
+ *
+ * PARAMS
+ *      CompletionPort  [I] HANDLE to I/O completion object
+ *      info            [O] array receiving the completion messages
+ *      count           [I] number of entries in info
+ *      written         [O] number of messages retrieved
+ *      WaitTime        [I] optional wait time in NTDLL format
+ *      alertable       [I] whether the wait can be interrupted by user APCs
+ *
+ */
+NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE CompletionPort, FILE_IO_COMPLETION_INFORMATION *info,
+                                        ULONG count, ULONG *written, PLARGE_INTEGER WaitTime,
+                                        BOOLEAN alertable )
+{
+    completion_msg_t local_msgs[64], *msgs = local_msgs;
+    NTSTATUS status;
+    ULONG i, got = 0;
+
+    TRACE("(%p, %p, %u, %p, %p, %u)\n", CompletionPort, info, count, written, WaitTime, alertable);
+
+    if (!count) return STATUS_INVALID_PARAMETER;
+    if (count > sizeof(local_msgs) / sizeof(local_msgs[0]) &&
+        !(msgs = RtlAllocateHeap( GetProcessHeap(), 0, count * sizeof(*msgs) )))
+        return STATUS_NO_MEMORY;
+
+    for(;;)
+    {
+        SERVER_START_REQ( remove_completions )
+        {
+            req->handle = wine_server_obj_handle( CompletionPort );
+            wine_server_set_reply( req, msgs, count * sizeof(*msgs) );
+            if (!(status = wine_server_call( req )))
+                got = wine_server_reply_size( reply ) / sizeof(*msgs);
+        }
+        SERVER_END_REQ;
+        if (status != STATUS_PENDING) break;
+
+        status = NtWaitForSingleObject( CompletionPort, alertable, WaitTime );
+        if (status != WAIT_OBJECT_0) break;
+    }
+
+    for (i = 0; i < got; i++)
+    {
+        info[i].CompletionKey             = msgs[i].ckey;
+        info[i].CompletionValue           = msgs[i].cvalue;
+        info[i].IoStatusBlock.Information = msgs[i].information;
+        info[i].IoStatusBlock.u.Status    = msgs[i].status;
+    }
+    *written = got;
+
+    if (msgs != local_msgs) RtlFreeHeap( GetProcessHeap(), 0, msgs );
+    return status;
+}
+
 /******************************************************************
  *              NtOpenIoCompletion (NTDLL.@)
  *              ZwOpenIoCompletion (NTDLL.@)
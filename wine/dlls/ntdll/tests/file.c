@@ -72,6 +72,7 @@ static NTSTATUS (WINAPI *pNtCreateIoCompletion)(PHANDLE, ACCESS_MASK, POBJECT_AT
 static NTSTATUS (WINAPI *pNtOpenIoCompletion)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES);
 static NTSTATUS (WINAPI *pNtQueryIoCompletion)(HANDLE, IO_COMPLETION_INFORMATION_CLASS, PVOID, ULONG, PULONG);
 static NTSTATUS (WINAPI *pNtRemoveIoCompletion)(HANDLE, PULONG_PTR, PULONG_PTR, PIO_STATUS_BLOCK, PLARGE_INTEGER);
+static NTSTATUS (WINAPI *pNtRemoveIoCompletionEx)(HANDLE, FILE_IO_COMPLETION_INFORMATION *, ULONG, ULONG *, PLARGE_INTEGER, BOOLEAN);
 static NTSTATUS (WINAPI *pNtSetIoCompletion)(HANDLE, ULONG_PTR, ULONG_PTR, NTSTATUS, SIZE_T);
 static NTSTATUS (WINAPI *pNtSetInformationFile)(HANDLE, PIO_STATUS_BLOCK, PVOID, ULONG, FILE_INFORMATION_CLASS);
 static NTSTATUS (WINAPI *pNtQueryInformationFile)(HANDLE, PIO_STATUS_BLOCK, PVOID, ULONG, FILE_INFORMATION_CLASS);
@@ -1059,6 +1060,77 @@ static void test_iocp_setcompletion(HANDLE h)
     ok( !count, "Unexpected msg count: %d\n", count );
 }
 
+static void test_iocp_removeex(HANDLE h)
+{
+    FILE_IO_COMPLETION_INFORMATION info[4], unused;
+    LARGE_INTEGER timeout;
+    NTSTATUS res;
+    ULONG count, i;
+
+    if (!pNtRemoveIoCompletionEx)
+    {
+        win_skip("NtRemoveIoCompletionEx not available\n");
+        return;
+    }
+
+    timeout.QuadPart = 0;
+
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, info, 0, &count, &timeout, FALSE );
+    ok( res == STATUS_INVALID_PARAMETER, "NtRemoveIoCompletionEx with no entries returned %x\n", res );
+
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, info, 4, &count, &timeout, FALSE );
+    ok( res == STATUS_TIMEOUT, "NtRemoveIoCompletionEx on empty port returned %x\n", res );
+    ok( !count, "Unexpected count %u\n", count );
+
+    for (i = 0; i < 3; i++)
+    {
+        res = pNtSetIoCompletion( h, CKEY_FIRST + i, CVALUE_FIRST + i, STATUS_SUCCESS, i );
+        ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %x\n", res );
+    }
+    count = get_pending_msgs(h);
+    ok( count == 3, "Unexpected msg count: %d\n", count );
+
+    /* only as many entries as asked for are removed, oldest first */
+    memset( info, 0xcc, sizeof(info) );
+    memset( &unused, 0xcc, sizeof(unused) );
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, info, 2, &count, &timeout, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %x\n", res );
+    ok( count == 2, "Unexpected count %u\n", count );
+    for (i = 0; i < 2; i++)
+    {
+        ok( info[i].CompletionKey == CKEY_FIRST + i, "%u: Invalid completion key: %lx\n", i, info[i].CompletionKey );
+        ok( info[i].CompletionValue == CVALUE_FIRST + i, "%u: Invalid completion value: %lx\n", i, info[i].CompletionValue );
+        ok( U(info[i].IoStatusBlock).Status == STATUS_SUCCESS, "%u: Invalid status: %x\n", i, U(info[i].IoStatusBlock).Status );
+        ok( info[i].IoStatusBlock.Information == i, "%u: Invalid information: %lu\n", i, info[i].IoStatusBlock.Information );
+    }
+    ok( !memcmp( &info[2], &unused, sizeof(unused) ), "Entry past the count was written\n" );
+
+    count = get_pending_msgs(h);
+    ok( count == 1, "Unexpected msg count: %d\n", count );
+
+    /* a larger buffer takes whatever is left */
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, info, 4, &count, &timeout, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %x\n", res );
+    ok( count == 1, "Unexpected count %u\n", count );
+    ok( info[0].CompletionKey == CKEY_FIRST + 2, "Invalid completion key: %lx\n", info[0].CompletionKey );
+    ok( info[0].CompletionValue == CVALUE_FIRST + 2, "Invalid completion value: %lx\n", info[0].CompletionValue );
+    ok( info[0].IoStatusBlock.Information == 2, "Invalid information: %lu\n", info[0].IoStatusBlock.Information );
+
+    count = get_pending_msgs(h);
+    ok( !count, "Unexpected msg count: %d\n", count );
+
+    /* a non-zero timeout expires too */
+    timeout.QuadPart = -100 * 10000;
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, info, 4, &count, &timeout, FALSE );
+    ok( res == STATUS_TIMEOUT, "NtRemoveIoCompletionEx on empty port returned %x\n", res );
+    ok( !count, "Unexpected count %u\n", count );
+}
+
 static void test_iocp_fileio(HANDLE h)
 {
     static const char pipe_name[] = "\\\\.\\pipe\\iocompletiontestnamedpipe";
@@ -1516,6 +1588,7 @@ static void test_iocompletion(void)
     if ( h && h != INVALID_HANDLE_VALUE)
     {
         test_iocp_setcompletion(h);
+        test_iocp_removeex(h);
         test_iocp_fileio(h);
         pNtClose(h);
     }
@@ -2702,6 +2775,7 @@ START_TEST(file)
     pNtOpenIoCompletion     = (void *)GetProcAddress(hntdll, "NtOpenIoCompletion");
     pNtQueryIoCompletion    = (void *)GetProcAddress(hntdll, "NtQueryIoCompletion");
     pNtRemoveIoCompletion   = (void *)GetProcAddress(hntdll, "NtRemoveIoCompletion");
+    pNtRemoveIoCompletionEx = (void *)GetProcAddress(hntdll, "NtRemoveIoCompletionEx");
     pNtSetIoCompletion      = (void *)GetProcAddress(hntdll, "NtSetIoCompletion");
     pNtSetInformationFile   = (void *)GetProcAddress(hntdll, "NtSetInformationFile");
     pNtQueryInformationFile = (void *)GetProcAddress(hntdll, "NtQueryInformationFile");
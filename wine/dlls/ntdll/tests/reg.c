@@ -624,6 +624,56 @@ static void test_NtQueryValueKey(void)
     pNtClose(key);
 }
 
+static DWORD WINAPI query_value_thread(void *arg)
+{
+    HANDLE key = arg;
+    NTSTATUS status;
+    UNICODE_STRING ValName;
+    KEY_VALUE_PARTIAL_INFORMATION *partial_info;
+    DWORD len, i, errors = 0;
+
+    pRtlCreateUnicodeStringFromAsciiz(&ValName, "deletetest");
+    len = FIELD_OFFSET(KEY_VALUE_PARTIAL_INFORMATION, Data[sizeof(DWORD)]);
+    partial_info = HeapAlloc(GetProcessHeap(), 0, len);
+    for (i = 0; i < 1000; i++)
+    {
+        status = pNtQueryValueKey(key, &ValName, KeyValuePartialInformation, partial_info, len, &len);
+        if (status != STATUS_SUCCESS || partial_info->Type != REG_DWORD ||
+            *(DWORD *)partial_info->Data != 711)
+            errors++;
+    }
+    HeapFree(GetProcessHeap(), 0, partial_info);
+    pRtlFreeUnicodeString(&ValName);
+    return errors;
+}
+
+static void test_concurrent_query(void)
+{
+    HANDLE key, threads[32];
+    NTSTATUS status;
+    OBJECT_ATTRIBUTES attr;
+    DWORD i, errors;
+
+    InitializeObjectAttributes(&attr, &winetestpath, 0, 0, 0);
+    status = pNtOpenKey(&key, KEY_READ, &attr);
+    ok(status == STATUS_SUCCESS, "NtOpenKey Failed: 0x%08x\n", status);
+
+    for (i = 0; i < sizeof(threads)/sizeof(threads[0]); i++)
+    {
+        threads[i] = CreateThread(NULL, 0, query_value_thread, key, 0, NULL);
+        ok(threads[i] != NULL, "CreateThread failed: %u\n", GetLastError());
+    }
+    for (i = 0; i < sizeof(threads)/sizeof(threads[0]); i++)
+    {
+        ok(WaitForSingleObject(threads[i], 30000) == WAIT_OBJECT_0, "thread %u didn't finish\n", i);
+        GetExitCodeThread(threads[i], &errors);
+        ok(errors == 0, "thread %u got %u bad NtQueryValueKey results\n", i, errors);
+        CloseHandle(threads[i]);
+    }
+
+    pNtClose(key);
+}
+
 static void test_NtDeleteKey(void)
 {
     NTSTATUS status;
@@ -1298,6 +1348,7 @@ START_TEST(reg)
     test_RtlpNtQueryValueKey();
     test_NtFlushKey();
     test_NtQueryValueKey();
+    test_concurrent_query();
     test_long_value_name();
     test_NtDeleteKey();
     test_symlinks();
@@ -277,6 +277,9 @@ HANDLE thread_init(void)
     thread_data->reply_fd   = -1;
     thread_data->wait_fd[0] = -1;
     thread_data->wait_fd[1] = -1;
+#ifdef CONFIG_UNIFIED_KERNEL
+    thread_data->syscall_fd = -1;
+#endif
     thread_data->debug_info = &debug_info;
     InsertHeadList( &tls_links, &teb->TlsLinks );
 
@@ -344,6 +347,9 @@ void terminate_thread( int status )
     close( ntdll_get_thread_data()->wait_fd[1] );
     close( ntdll_get_thread_data()->reply_fd );
     close( ntdll_get_thread_data()->request_fd );
+#ifdef CONFIG_UNIFIED_KERNEL
+    close_syscall_channel();
+#endif
     pthread_exit( UIntToPtr(status) );
 }
 
@@ -541,6 +547,9 @@ NTSTATUS WINAPI RtlCreateUserThread( HANDLE process, const SECURITY_DESCRIPTOR *
     thread_data->reply_fd    = -1;
     thread_data->wait_fd[0]  = -1;
     thread_data->wait_fd[1]  = -1;
+#ifdef CONFIG_UNIFIED_KERNEL
+    thread_data->syscall_fd  = -1;
+#endif
 
     if ((status = virtual_alloc_thread_stack( teb, stack_reserve, stack_commit ))) goto error;
 
@@ -2834,7 +2834,9 @@ NTSTATUS WINAPI NtReadVirtualMemory( HANDLE process, const void *addr, void *buf
             req->handle = wine_server_obj_handle( process );
             req->addr   = wine_server_client_ptr( addr );
             wine_server_set_reply( req, buffer, size );
-            if ((status = wine_server_call( req ))) size = 0;
+            status = wine_server_call( req );
+            if (status == STATUS_PARTIAL_COPY) size = wine_server_reply_size( reply );
+            else if (status) size = 0;
         }
         SERVER_END_REQ;
     }
@@ -2864,7 +2866,9 @@ NTSTATUS WINAPI NtWriteVirtualMemory( HANDLE process, void *addr, const void *bu
             req->handle     = wine_server_obj_handle( process );
             req->addr       = wine_server_client_ptr( addr );
             wine_server_add_data( req, buffer, size );
-            if ((status = wine_server_call( req ))) size = 0;
+            status = wine_server_call( req );
+            if (status == STATUS_PARTIAL_COPY) size = reply->written;
+            else if (status) size = 0;
         }
         SERVER_END_REQ;
     }
@@ -408,6 +408,7 @@ SHORT WINAPI DECLSPEC_HOTPATCH GetAsyncKeyState( INT key )
  */
 DWORD WINAPI GetQueueStatus( UINT flags )
 {
+    const struct __server_queue_slot *slot;
     DWORD ret;
 
     if (flags & ~(QS_ALLINPUT | QS_ALLPOSTMESSAGE | QS_SMRESULT))
@@ -418,6 +419,12 @@ DWORD WINAPI GetQueueStatus( UINT flags )
 
     check_for_events( flags );
 
+    /* nothing to clear, the shared queue status is enough */
+    if ((slot = get_user_thread_info()->queue_slot) &&
+        !*(volatile const unsigned int *)&slot->changed_bits &&
+        slot->seq == get_user_thread_info()->queue_slot_seq)
+        return MAKELONG( 0, *(volatile const unsigned int *)&slot->wake_bits & flags );
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear = 1;
@@ -434,10 +441,14 @@ DWORD WINAPI GetQueueStatus( UINT flags )
  */
 BOOL WINAPI GetInputState(void)
 {
+    const struct __server_queue_slot *slot;
     DWORD ret;
 
     check_for_events( QS_INPUT );
 
+    if ((slot = get_user_thread_info()->queue_slot) && slot->seq == get_user_thread_info()->queue_slot_seq)
+        return *(volatile const unsigned int *)&slot->wake_bits & (QS_KEY | QS_MOUSEBUTTON);
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear = 0;
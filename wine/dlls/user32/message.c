@@ -2721,6 +2721,61 @@ static inline void call_sendmsg_callback( SENDASYNCPROC callback, HWND hwnd, UIN
 }
 
 
+/***********************************************************************
+ *           get_server_queue_handle
+ *
+ * Get a handle to the server message queue for the current thread.
+ */
+static HANDLE get_server_queue_handle(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    const struct __server_queue_slot *page;
+    unsigned int slot = 0, slot_seq = 0;
+    HANDLE ret;
+
+    if (!(ret = thread_info->server_queue))
+    {
+        SERVER_START_REQ( get_msg_queue )
+        {
+            wine_server_call( req );
+            ret = wine_server_ptr_handle( reply->handle );
+            slot = reply->slot;
+            slot_seq = reply->slot_seq;
+        }
+        SERVER_END_REQ;
+        thread_info->server_queue = ret;
+        if (!ret) ERR( "Cannot get server thread queue\n" );
+        else if (slot && (page = wine_server_map_queue_page()))
+        {
+            thread_info->queue_slot_seq = slot_seq;
+            thread_info->queue_slot = &page[slot];
+        }
+    }
+    return ret;
+}
+
+
+/***********************************************************************
+ *           is_queue_idle
+ *
+ * Check in the shared queue status page whether the server has nothing
+ * pending for the given filter, so that the get_message call can be skipped.
+ * The server is still asked at least once a second, since it uses these
+ * calls to tell whether the thread is hung.
+ */
+static BOOL is_queue_idle( struct user_thread_info *thread_info, UINT filter )
+{
+    const struct __server_queue_slot *slot;
+
+    get_server_queue_handle();
+    if (!(slot = thread_info->queue_slot)) return FALSE;
+    if (GetTickCount() - thread_info->queue_slot_time >= 1000) return FALSE;
+    if (*(volatile const unsigned int *)&slot->wake_bits & (filter | QS_SENDMESSAGE | QS_POSTMESSAGE))
+        return FALSE;
+    return *(volatile const unsigned int *)&slot->seq == thread_info->queue_slot_seq;
+}
+
+
 /***********************************************************************
  *           peek_message
  *
@@ -2741,6 +2796,14 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
     if (!first && !last) last = ~0;
     if (hwnd == HWND_BROADCAST) hwnd = HWND_TOPMOST;
 
+    /* a plain peek on an empty queue doesn't need the server */
+    if (!changed_mask && hwnd != (HWND)-1 &&
+        is_queue_idle( thread_info, (flags >> 16) ? (flags >> 16) : QS_ALLINPUT ))
+    {
+        HeapFree( GetProcessHeap(), 0, buffer );
+        return FALSE;
+    }
+
     for (;;)
     {
         NTSTATUS res;
@@ -2757,7 +2820,9 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
             req->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
             req->changed_mask = changed_mask;
             wine_server_set_reply( req, buffer, buffer_size );
-            if (!(res = wine_server_call( req )))
+            res = wine_server_call( req );
+            thread_info->queue_slot_time = GetTickCount();
+            if (!res)
             {
                 size = wine_server_reply_size( reply );
                 info.type        = reply->type;
@@ -2969,31 +3034,6 @@ static inline void process_sent_messages(void)
 }
 
 
-/***********************************************************************
- *           get_server_queue_handle
- *
- * Get a handle to the server message queue for the current thread.
- */
-static HANDLE get_server_queue_handle(void)
-{
-    struct user_thread_info *thread_info = get_user_thread_info();
-    HANDLE ret;
-
-    if (!(ret = thread_info->server_queue))
-    {
-        SERVER_START_REQ( get_msg_queue )
-        {
-            wine_server_call( req );
-            ret = wine_server_ptr_handle( reply->handle );
-        }
-        SERVER_END_REQ;
-        thread_info->server_queue = ret;
-        if (!ret) ERR( "Cannot get server thread queue\n" );
-    }
-    return ret;
-}
-
-
 /***********************************************************************
  *           wait_message_reply
  *
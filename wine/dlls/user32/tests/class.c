@@ -975,6 +975,82 @@ if (0) { /* crashes under XP */
     ok(wcx.lpfnWndProc != NULL, "got null proc\n");
 }
 
+static void test_many_classes(void)
+{
+    HINSTANCE hinst = GetModuleHandleA(NULL);
+    ATOM atoms[300];
+    WNDCLASSA cls;
+    char name[32];
+    HWND hwnd;
+    BOOL ret;
+    int i;
+
+    /* more classes than the server has hash buckets */
+    for (i = 0; i < 300; i++)
+    {
+        sprintf(name, "many_classes_%d", i);
+        memset(&cls, 0, sizeof(cls));
+        cls.style = (i % 2) ? CS_GLOBALCLASS : 0;
+        cls.lpfnWndProc = DefWindowProcA;
+        cls.cbWndExtra = (i % 8) * sizeof(LONG);
+        cls.hInstance = hinst;
+        cls.lpszClassName = name;
+        atoms[i] = RegisterClassA(&cls);
+        ok(atoms[i] != 0, "RegisterClass(%s) failed %u\n", name, GetLastError());
+    }
+
+    /* unregister every third class, the others must still be found */
+    for (i = 0; i < 300; i += 3)
+    {
+        sprintf(name, "many_classes_%d", i);
+        ret = UnregisterClassA(name, hinst);
+        ok(ret, "UnregisterClass(%s) failed %u\n", name, GetLastError());
+    }
+
+    for (i = 0; i < 300; i++)
+    {
+        sprintf(name, "many_classes_%d", i);
+        SetLastError(0xdeadbeef);
+        hwnd = CreateWindowA(name, NULL, WS_OVERLAPPED, 0, 0, 10, 10, 0, 0, hinst, NULL);
+        if (i % 3 == 0)
+        {
+            ok(!hwnd, "%s: window created for an unregistered class\n", name);
+            ok(GetLastError() == ERROR_CANNOT_FIND_WND_CLASS, "%s: wrong error %u\n", name, GetLastError());
+            continue;
+        }
+        ok(hwnd != 0, "%s: CreateWindow failed %u\n", name, GetLastError());
+        if (!hwnd) continue;
+        ok(GetClassWord(hwnd, GCW_ATOM) == atoms[i], "%s: wrong atom %04x\n", name, GetClassWord(hwnd, GCW_ATOM));
+        ok(GetClassLongA(hwnd, GCL_CBWNDEXTRA) == (i % 8) * sizeof(LONG), "%s: wrong extra bytes %u\n",
+           name, GetClassLongA(hwnd, GCL_CBWNDEXTRA));
+        if (i % 8)
+        {
+            SetWindowLongA(hwnd, (i % 8 - 1) * sizeof(LONG), i);
+            ok(GetWindowLongA(hwnd, (i % 8 - 1) * sizeof(LONG)) == i, "%s: wrong extra value\n", name);
+        }
+        DestroyWindow(hwnd);
+    }
+
+    /* re-registering a freed name gives a working class again */
+    sprintf(name, "many_classes_%d", 0);
+    memset(&cls, 0, sizeof(cls));
+    cls.lpfnWndProc = DefWindowProcA;
+    cls.hInstance = hinst;
+    cls.lpszClassName = name;
+    ok(RegisterClassA(&cls) != 0, "RegisterClass(%s) failed %u\n", name, GetLastError());
+    hwnd = CreateWindowA(name, NULL, WS_OVERLAPPED, 0, 0, 10, 10, 0, 0, hinst, NULL);
+    ok(hwnd != 0, "%s: CreateWindow failed %u\n", name, GetLastError());
+    DestroyWindow(hwnd);
+
+    for (i = 0; i < 300; i++)
+    {
+        if (i % 3 == 0 && i) continue;
+        sprintf(name, "many_classes_%d", i);
+        ret = UnregisterClassA(name, hinst);
+        ok(ret, "UnregisterClass(%s) failed %u\n", name, GetLastError());
+    }
+}
+
 static void test_icons(void)
 {
     WNDCLASSEXW wcex, ret_wcex;
@@ -1128,6 +1204,7 @@ START_TEST(class)
     test_styles();
     test_builtinproc();
     test_icons();
+    test_many_classes();
     test_comctl32_classes();
 
     /* this test unregisters the Button class so it should be executed at the end */
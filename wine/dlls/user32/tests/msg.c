@@ -10332,6 +10332,95 @@ done:
     flush_events();
 }
 
+static void test_posted_message_order(void)
+{
+    HWND hwnd[2];
+    MSG msg;
+    BOOL ret;
+    int i, count, last;
+    DWORD start;
+
+    hwnd[0] = CreateWindowA("TestWindowClass", "order1", WS_OVERLAPPEDWINDOW,
+                            100, 100, 200, 200, 0, 0, 0, NULL);
+    hwnd[1] = CreateWindowA("TestWindowClass", "order2", WS_OVERLAPPEDWINDOW,
+                            100, 100, 200, 200, 0, 0, 0, NULL);
+    ok(hwnd[0] && hwnd[1], "CreateWindow failed\n");
+    flush_events();
+    while (PeekMessageA(&msg, 0, WM_USER, WM_USER + 2, PM_REMOVE)) ;
+
+    /* interleave windows and message codes */
+    for (i = 0; i < 60; i++)
+    {
+        ret = PostMessageA(hwnd[i % 2], WM_USER + i % 3, i, 0);
+        ok(ret, "PostMessage %d failed %u\n", i, GetLastError());
+    }
+
+    /* remove one window/code pair; the messages come out in posting order */
+    last = -1;
+    count = 0;
+    while (PeekMessageA(&msg, hwnd[0], WM_USER + 1, WM_USER + 1, PM_REMOVE))
+    {
+        ok(msg.hwnd == hwnd[0], "wrong window %p\n", msg.hwnd);
+        ok(msg.message == WM_USER + 1, "wrong message %04x\n", msg.message);
+        ok((int)msg.wParam > last, "message %ld after %d\n", msg.wParam, last);
+        ok(msg.wParam % 6 == 4, "unexpected message %ld\n", msg.wParam);
+        last = msg.wParam;
+        count++;
+    }
+    ok(count == 10, "removed %d messages\n", count);
+
+    /* a window filter returns the oldest message of that window */
+    ret = PeekMessageA(&msg, hwnd[1], 0, 0, PM_REMOVE);
+    ok(ret, "no message for the second window\n");
+    ok(msg.hwnd == hwnd[1] && msg.wParam == 1 && msg.message == WM_USER + 1,
+       "got %p %04x %ld\n", msg.hwnd, msg.message, msg.wParam);
+
+    /* a code filter returns the oldest message with that code across windows */
+    ret = PeekMessageA(&msg, 0, WM_USER + 2, WM_USER + 2, PM_REMOVE);
+    ok(ret, "no WM_USER+2 message\n");
+    ok(msg.hwnd == hwnd[0] && msg.wParam == 2, "got %p %04x %ld\n", msg.hwnd, msg.message, msg.wParam);
+
+    /* everything left comes out in posting order */
+    last = -1;
+    count = 0;
+    while (PeekMessageA(&msg, 0, WM_USER, WM_USER + 2, PM_REMOVE))
+    {
+        ok(msg.hwnd == hwnd[msg.wParam % 2], "%ld: wrong window %p\n", msg.wParam, msg.hwnd);
+        ok(msg.message == WM_USER + msg.wParam % 3, "%ld: wrong message %04x\n", msg.wParam, msg.message);
+        ok((int)msg.wParam > last, "message %ld after %d\n", msg.wParam, last);
+        ok(msg.wParam % 6 != 4 && msg.wParam != 1 && msg.wParam != 2, "message %ld already removed\n", msg.wParam);
+        last = msg.wParam;
+        count++;
+    }
+    ok(count == 48, "got %d remaining messages\n", count);
+
+    /* a filtered peek for the last message shouldn't have to walk the others */
+    for (i = 0; i < 5000; i++)
+        if (!PostMessageA(hwnd[0], WM_USER, i, 0)) break;
+    ok(i == 5000, "posted only %d messages\n", i);
+    PostMessageA(hwnd[1], WM_USER + 1, 0x1234, 0);
+
+    start = GetTickCount();
+    for (i = 0; i < 1000; i++)
+    {
+        ret = PeekMessageA(&msg, hwnd[1], WM_USER + 1, WM_USER + 1, PM_NOREMOVE);
+        if (!ret || msg.wParam != 0x1234) break;
+    }
+    ok(i == 1000, "filtered peek failed at %d\n", i);
+    trace("1000 filtered peeks behind 5000 messages took %u ms\n", GetTickCount() - start);
+
+    ret = PeekMessageA(&msg, hwnd[1], WM_USER + 1, WM_USER + 1, PM_REMOVE);
+    ok(ret && msg.wParam == 0x1234, "wrong message %ld\n", msg.wParam);
+    ret = PeekMessageA(&msg, 0, WM_USER, WM_USER, PM_REMOVE);
+    ok(ret && msg.wParam == 0, "wrong first message %ld\n", msg.wParam);
+    while (PeekMessageA(&msg, 0, WM_USER, WM_USER + 2, PM_REMOVE)) ;
+
+    DestroyWindow(hwnd[0]);
+    DestroyWindow(hwnd[1]);
+    flush_events();
+    flush_sequence();
+}
+
 static INT_PTR CALLBACK wm_quit_dlg_proc(HWND hwnd, UINT message, WPARAM wp, LPARAM lp)
 {
     struct recvd_message msg;
@@ -14341,6 +14430,7 @@ START_TEST(msg)
     test_ShowWindow();
     test_PeekMessage();
     test_PeekMessage2();
+    test_posted_message_order();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
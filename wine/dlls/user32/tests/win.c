@@ -7180,6 +7180,131 @@ todo_wine
     ok(ret, "UnregisterClass(my_window) failed\n");
 }
 
+static BOOL point_in_vis_rgn( HWND hwnd, HWND child )
+{
+    HRGN hrgn = CreateRectRgn( 0, 0, 0, 0 );
+    RECT rect;
+    POINT pt;
+    BOOL ret;
+    HDC hdc;
+
+    GetWindowRect( child, &rect );
+    pt.x = (rect.left + rect.right) / 2;
+    pt.y = (rect.top + rect.bottom) / 2;
+    hdc = GetDC( hwnd );
+    ok( GetRandomRgn( hdc, hrgn, SYSRGN ) != 0, "GetRandomRgn failed\n" );
+    ret = PtInRegion( hrgn, pt.x, pt.y );
+    ReleaseDC( hwnd, hdc );
+    DeleteObject( hrgn );
+    return ret;
+}
+
+static void test_many_children_from_point(void)
+{
+    WNDCLASSA cls;
+    HWND parent, large, hwnd, child[64];
+    POINT pt, gap;
+    RECT rect;
+    DWORD start;
+    int i, ret;
+
+    memset(&cls, 0, sizeof(cls));
+    cls.lpfnWndProc = DefWindowProcA;
+    cls.hInstance = GetModuleHandleA(NULL);
+    cls.lpszClassName = "hit_test_class";
+    ret = RegisterClassA(&cls);
+    ok(ret, "RegisterClass(hit_test_class) failed\n");
+
+    parent = CreateWindowExA(WS_EX_TOPMOST, "hit_test_class", NULL,
+                             WS_POPUP | WS_VISIBLE | WS_CLIPCHILDREN,
+                             100, 100, 400, 400, 0, 0, GetModuleHandleA(NULL), NULL);
+    ok(parent != 0, "CreateWindowEx failed\n");
+
+    /* enough children for the server to index them */
+    for (i = 0; i < 64; i++)
+    {
+        child[i] = CreateWindowExA(0, "hit_test_class", NULL, WS_CHILD | WS_VISIBLE,
+                                   (i % 8) * 50 + 5, (i / 8) * 50 + 5, 40, 40,
+                                   parent, 0, GetModuleHandleA(NULL), NULL);
+        ok(child[i] != 0, "CreateWindowEx %d failed\n", i);
+    }
+    flush_events( TRUE );
+
+    /* the cached visible region of the parent follows the children */
+    if (!is_win9x)
+    {
+        ok(!point_in_vis_rgn(parent, child[1]), "child area not clipped\n");
+        ShowWindow(child[1], SW_HIDE);
+        ok(point_in_vis_rgn(parent, child[1]), "hidden child area still clipped\n");
+        ShowWindow(child[1], SW_SHOWNA);
+        ok(!point_in_vis_rgn(parent, child[1]), "shown child area not clipped\n");
+    }
+
+    for (i = 0; i < 64; i++)
+    {
+        GetWindowRect(child[i], &rect);
+        pt.x = (rect.left + rect.right) / 2;
+        pt.y = (rect.top + rect.bottom) / 2;
+        hwnd = WindowFromPoint(pt);
+        ok(hwnd == child[i], "%d: expected %p, got %p\n", i, child[i], hwnd);
+    }
+
+    /* a child covering the whole client area, at the bottom of the z-order */
+    large = CreateWindowExA(0, "hit_test_class", NULL, WS_CHILD | WS_VISIBLE, 0, 0, 400, 400,
+                            parent, 0, GetModuleHandleA(NULL), NULL);
+    ok(large != 0, "CreateWindowEx failed\n");
+    SetWindowPos(large, HWND_BOTTOM, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
+
+    gap.x = 102;
+    gap.y = 102;
+    hwnd = WindowFromPoint(gap);
+    ok(hwnd == large, "expected %p, got %p\n", large, hwnd);
+
+    GetWindowRect(child[9], &rect);
+    pt.x = (rect.left + rect.right) / 2;
+    pt.y = (rect.top + rect.bottom) / 2;
+    hwnd = WindowFromPoint(pt);
+    ok(hwnd == child[9], "expected %p, got %p\n", child[9], hwnd);
+
+    /* hidden children are skipped */
+    ShowWindow(child[9], SW_HIDE);
+    hwnd = WindowFromPoint(pt);
+    ok(hwnd == large, "expected %p, got %p\n", large, hwnd);
+    ShowWindow(child[9], SW_SHOWNA);
+
+    /* moving a child updates both its old and new place, z-order decides overlaps */
+    GetWindowRect(child[0], &rect);
+    pt.x = (rect.left + rect.right) / 2;
+    pt.y = (rect.top + rect.bottom) / 2;
+    SetWindowPos(child[0], HWND_TOP, 7 * 50 + 5, 7 * 50 + 5, 0, 0, SWP_NOSIZE | SWP_NOACTIVATE);
+    hwnd = WindowFromPoint(pt);
+    ok(hwnd == large, "expected %p, got %p\n", large, hwnd);
+    GetWindowRect(child[63], &rect);
+    pt.x = (rect.left + rect.right) / 2;
+    pt.y = (rect.top + rect.bottom) / 2;
+    hwnd = WindowFromPoint(pt);
+    ok(hwnd == child[0], "expected %p, got %p\n", child[0], hwnd);
+    SetWindowPos(child[63], HWND_TOP, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
+    hwnd = WindowFromPoint(pt);
+    ok(hwnd == child[63], "expected %p, got %p\n", child[63], hwnd);
+
+    /* moving the parent keeps the hits in client coordinates */
+    SetWindowPos(parent, 0, 150, 150, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE);
+    GetWindowRect(child[20], &rect);
+    pt.x = (rect.left + rect.right) / 2;
+    pt.y = (rect.top + rect.bottom) / 2;
+    hwnd = WindowFromPoint(pt);
+    ok(hwnd == child[20], "expected %p, got %p\n", child[20], hwnd);
+
+    start = GetTickCount();
+    for (i = 0; i < 1000; i++) WindowFromPoint(pt);
+    trace("1000 WindowFromPoint calls over 65 children took %u ms\n", GetTickCount() - start);
+
+    DestroyWindow(parent);
+    ret = UnregisterClassA("hit_test_class", cls.hInstance);
+    ok(ret, "UnregisterClass(hit_test_class) failed\n");
+}
+
 static void test_map_points(void)
 {
     BOOL ret;
@@ -7469,6 +7594,153 @@ todo_wine
     DestroyWindow(parent);
 }
 
+static BOOL CALLBACK count_props_proc(HWND hwnd, LPSTR str, HANDLE data, ULONG_PTR lparam)
+{
+    int *count = (int *)lparam, i;
+
+    if (IS_INTRESOURCE(str) || sscanf(str, "prop_%d", &i) != 1) return TRUE;
+    ok(data == (HANDLE)(INT_PTR)(i + 1), "%s: wrong data %p\n", str, data);
+    ok(i % 3, "%s: removed property enumerated\n", str);
+    (*count)++;
+    return TRUE;
+}
+
+static void test_window_properties(void)
+{
+    char name[32];
+    HANDLE data;
+    HWND hwnd;
+    DWORD start;
+    int i, count;
+
+    hwnd = CreateWindowExA(0, "MainWindowClass", NULL, WS_POPUP, 0, 0, 10, 10,
+                           NULL, NULL, GetModuleHandleA(0), 0);
+    ok(hwnd != 0, "CreateWindowEx failed\n");
+
+    /* enough properties for the server table to grow a few times */
+    for (i = 0; i < 200; i++)
+    {
+        sprintf(name, "prop_%d", i);
+        ok(SetPropA(hwnd, name, (HANDLE)(INT_PTR)(i + 1)), "SetProp(%s) failed\n", name);
+    }
+
+    /* remove every third one, the others must survive the shifted slots */
+    for (i = 0; i < 200; i += 3)
+    {
+        sprintf(name, "prop_%d", i);
+        data = RemovePropA(hwnd, name);
+        ok(data == (HANDLE)(INT_PTR)(i + 1), "RemoveProp(%s) returned %p\n", name, data);
+    }
+
+    for (i = 0; i < 200; i++)
+    {
+        sprintf(name, "prop_%d", i);
+        data = GetPropA(hwnd, name);
+        if (i % 3) ok(data == (HANDLE)(INT_PTR)(i + 1), "GetProp(%s) returned %p\n", name, data);
+        else ok(!data, "GetProp(%s) returned %p after removal\n", name, data);
+    }
+
+    /* setting an existing property replaces its value */
+    ok(SetPropA(hwnd, "prop_1", (HANDLE)0xdead), "SetProp failed\n");
+    data = GetPropA(hwnd, "prop_1");
+    ok(data == (HANDLE)0xdead, "GetProp returned %p\n", data);
+    SetPropA(hwnd, "prop_1", (HANDLE)2);
+
+    count = 0;
+    EnumPropsExA(hwnd, count_props_proc, (LPARAM)&count);
+    ok(count == 133, "enumerated %d properties\n", count);
+
+    sprintf(name, "prop_%d", 199);
+    start = GetTickCount();
+    for (i = 0; i < 10000; i++) GetPropA(hwnd, name);
+    trace("10000 GetProp calls with 133 properties took %u ms\n", GetTickCount() - start);
+
+    for (i = 0; i < 200; i++)
+    {
+        if (!(i % 3)) continue;
+        sprintf(name, "prop_%d", i);
+        data = RemovePropA(hwnd, name);
+        ok(data == (HANDLE)(INT_PTR)(i + 1), "RemoveProp(%s) returned %p\n", name, data);
+    }
+
+    count = 0;
+    EnumPropsExA(hwnd, count_props_proc, (LPARAM)&count);
+    ok(!count, "enumerated %d properties after removal\n", count);
+
+    DestroyWindow(hwnd);
+}
+
+static void test_update_region_rects(void)
+{
+    static const RECT client = {0, 0, 200, 200};
+    HWND hwnd;
+    HRGN rgn, expect, tmp;
+    RECT rc[3];
+    unsigned int seed = 12345;
+    int i, j, ret, failures = 0;
+
+    hwnd = CreateWindowExA(0, "MainWindowClass", NULL, WS_POPUP | WS_VISIBLE,
+                           0, 0, 200, 200, NULL, NULL, GetModuleHandleA(0), 0);
+    ok(hwnd != 0, "CreateWindowEx failed\n");
+
+    rgn = CreateRectRgn(0, 0, 0, 0);
+    expect = CreateRectRgn(0, 0, 0, 0);
+    tmp = CreateRectRgn(0, 0, 0, 0);
+
+    /* single rectangles, partly outside of the window, go through the
+     * rectangle shortcuts of the server region code; compare with gdi32 */
+    for (i = 0; i < 300; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            seed = seed * 1103515245 + 12345;
+            rc[j].left = (seed >> 8) % 240 - 20;
+            rc[j].top = (seed >> 16) % 240 - 20;
+            seed = seed * 1103515245 + 12345;
+            rc[j].right = rc[j].left + (seed >> 8) % 120 + 1;
+            rc[j].bottom = rc[j].top + (seed >> 16) % 120 + 1;
+        }
+
+        ValidateRect(hwnd, NULL);
+        InvalidateRect(hwnd, &rc[0], FALSE);
+        if (i % 2) InvalidateRect(hwnd, &rc[1], FALSE);
+        ValidateRect(hwnd, &rc[2]);
+
+        SetRectRgn(expect, rc[0].left, rc[0].top, rc[0].right, rc[0].bottom);
+        if (i % 2)
+        {
+            SetRectRgn(tmp, rc[1].left, rc[1].top, rc[1].right, rc[1].bottom);
+            CombineRgn(expect, expect, tmp, RGN_OR);
+        }
+        SetRectRgn(tmp, client.left, client.top, client.right, client.bottom);
+        CombineRgn(expect, expect, tmp, RGN_AND);
+        SetRectRgn(tmp, rc[2].left, rc[2].top, rc[2].right, rc[2].bottom);
+        CombineRgn(expect, expect, tmp, RGN_DIFF);
+
+        ret = GetUpdateRgn(hwnd, rgn, FALSE);
+        ok(ret != ERROR, "%d: GetUpdateRgn failed\n", i);
+        if (!EqualRgn(rgn, expect) && failures++ < 10)
+            ok(0, "%d: wrong update region for (%d,%d)-(%d,%d) (%d,%d)-(%d,%d) minus (%d,%d)-(%d,%d)\n", i,
+               rc[0].left, rc[0].top, rc[0].right, rc[0].bottom,
+               rc[1].left, rc[1].top, rc[1].right, rc[1].bottom,
+               rc[2].left, rc[2].top, rc[2].right, rc[2].bottom);
+    }
+    ok(!failures, "%d wrong update regions\n", failures);
+
+    /* validating a rectangle that covers the update region empties it */
+    SetRect(&rc[0], 10, 10, 50, 50);
+    SetRect(&rc[1], 5, 5, 60, 60);
+    ValidateRect(hwnd, NULL);
+    InvalidateRect(hwnd, &rc[0], FALSE);
+    ValidateRect(hwnd, &rc[1]);
+    ok(GetUpdateRgn(hwnd, rgn, FALSE) == NULLREGION, "update region not empty\n");
+
+    DeleteObject(tmp);
+    DeleteObject(expect);
+    DeleteObject(rgn);
+    DestroyWindow(hwnd);
+}
+
 START_TEST(win)
 {
     HMODULE user32 = GetModuleHandleA( "user32.dll" );
@@ -7521,6 +7793,7 @@ START_TEST(win)
 
     /* Add the tests below this line */
     test_child_window_from_point();
+    test_many_children_from_point();
     test_thick_child_size(hwndMain);
     test_fullscreen();
     test_hwnd_message();
@@ -7579,6 +7852,8 @@ START_TEST(win)
     test_winregion();
     test_map_points();
     test_update_region();
+    test_update_region_rects();
+    test_window_properties();
 
     /* add the tests above this line */
     if (hhook) UnhookWindowsHookEx(hhook);
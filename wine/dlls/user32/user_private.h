@@ -187,8 +187,11 @@ struct user_thread_info
     HWND                          top_window;             /* Desktop window */
     HWND                          msg_window;             /* HWND_MESSAGE parent window */
     RAWINPUT                     *rawinput;
+    const struct __server_queue_slot *queue_slot;         /* Shared queue status, NULL if none */
+    DWORD                         queue_slot_seq;         /* Sequence number of the queue slot */
+    DWORD                         queue_slot_time;        /* Time of last get_message call */
 
-    ULONG                         pad[8];                 /* Available for more data */
+    ULONG                         pad[4];                 /* Available for more data */
 };
 
 struct hook_extra_info
@@ -1879,6 +1879,41 @@ static void WINAPI ws2_async_apc( void *arg, IO_STATUS_BLOCK *iosb, ULONG reserv
     HeapFree( GetProcessHeap(), 0, wsa );
 }
 
+#ifdef CONFIG_UNIFIED_KERNEL
+#define WS2_DIRECT_BUFFERS 8
+
+/* data of register_async for a transfer done by the kernel */
+struct ws2_direct
+{
+    client_ptr_t   apc;                          /* APC to queue once the transfer is done */
+    async_buffer_t buffers[WS2_DIRECT_BUFFERS];  /* client buffers */
+};
+
+/***********************************************************************
+ *              WS2_add_direct_buffers  (INTERNAL)
+ *
+ * Pass the buffers of a plain overlapped transfer along with register_async,
+ * so that the kernel moves the data itself once the socket is ready instead
+ * of waking us up to do it.
+ */
+static void WS2_add_direct_buffers( struct register_async_request *req, const struct ws2_async *wsa,
+                                    struct ws2_direct *direct )
+{
+    unsigned int i, count = wsa->n_iovecs - wsa->first_iovec;
+
+    if (wsa->addr || wsa->control || wsa->flags || !count || count > WS2_DIRECT_BUFFERS) return;
+
+    direct->apc = wine_server_client_ptr( ws2_async_apc );
+    for (i = 0; i < count; i++)
+    {
+        direct->buffers[i].ptr   = wine_server_client_ptr( wsa->iovec[wsa->first_iovec + i].iov_base );
+        direct->buffers[i].size  = wsa->iovec[wsa->first_iovec + i].iov_len;
+        direct->buffers[i].__pad = 0;
+    }
+    wine_server_add_data( req, direct, FIELD_OFFSET( struct ws2_direct, buffers[count] ) );
+}
+#endif
+
 /***********************************************************************
  *              WS2_recv                (INTERNAL)
  *
@@ -4449,6 +4484,9 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
     ULONG_PTR cvalue = (lpOverlapped && ((ULONG_PTR)lpOverlapped->hEvent & 1) == 0) ? (ULONG_PTR)lpOverlapped : 0;
     DWORD bytes_sent;
     BOOL is_blocking;
+#ifdef CONFIG_UNIFIED_KERNEL
+    struct ws2_direct direct;
+#endif
 
     TRACE("socket %04lx, wsabuf %p, nbufs %d, flags %d, to %p, tolen %d, ovl %p, func %p\n",
           s, lpBuffers, dwBufferCount, dwFlags,
@@ -4519,6 +4557,10 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
                 req->async.arg      = wine_server_client_ptr( wsa );
                 req->async.event    = wine_server_obj_handle( lpCompletionRoutine ? 0 : lpOverlapped->hEvent );
                 req->async.cvalue   = cvalue;
+#ifdef CONFIG_UNIFIED_KERNEL
+                /* the kernel only reports what it sent itself */
+                if (n == -1) WS2_add_direct_buffers( req, wsa, &direct );
+#endif
                 err = wine_server_call( req );
             }
             SERVER_END_REQ;
@@ -6445,6 +6487,9 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
     BOOL is_blocking;
     DWORD timeout_start = GetTickCount();
     ULONG_PTR cvalue = (lpOverlapped && ((ULONG_PTR)lpOverlapped->hEvent & 1) == 0) ? (ULONG_PTR)lpOverlapped : 0;
+#ifdef CONFIG_UNIFIED_KERNEL
+    struct ws2_direct direct;
+#endif
 
     TRACE("socket %04lx, wsabuf %p, nbufs %d, flags %d, from %p, fromlen %d, ovl %p, func %p\n",
           s, lpBuffers, dwBufferCount, *lpFlags, lpFrom,
@@ -6521,6 +6566,9 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
                     req->async.arg      = wine_server_client_ptr( wsa );
                     req->async.event    = wine_server_obj_handle( lpCompletionRoutine ? 0 : lpOverlapped->hEvent );
                     req->async.cvalue   = cvalue;
+#ifdef CONFIG_UNIFIED_KERNEL
+                    WS2_add_direct_buffers( req, wsa, &direct );
+#endif
                     err = wine_server_call( req );
                 }
                 SERVER_END_REQ;
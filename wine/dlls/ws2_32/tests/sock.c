@@ -4365,6 +4365,99 @@ static void ok_event_sequence(SOCKET s, HANDLE hEvent, const LPARAM *seq, const
 
 #define ok_event_seq (winetest_set_location(__FILE__, __LINE__), 0) ? (void)0 : ok_event_sequence
 
+static DWORD WINAPI echo_socket_thread(LPVOID arg)
+{
+    char buffer[0x4000];
+    SOCKET sock = *(SOCKET*)arg;
+    int ret;
+
+    while ((ret = recv(sock, buffer, sizeof(buffer), 0)) > 0)
+        if (send(sock, buffer, ret, 0) != ret) break;
+    return 0;
+}
+
+static void test_overlapped_echo(void)
+{
+    const DWORD buflen = 4 * 1024 * 1024;
+    SOCKET src, dst;
+    HANDLE thread;
+    OVERLAPPED send_ov, recv_ov;
+    WSABUF buf;
+    char *send_buf, *recv_buf;
+    DWORD i, id, ret, sent, received = 0, bytes, flags, start, ticks;
+    int size = 0x1000;
+
+    if (tcp_socketpair(&src, &dst) != 0)
+    {
+        ok(0, "creating socket pair failed, skipping test\n");
+        return;
+    }
+    /* a small send buffer makes the overlapped send complete in many pieces */
+    ret = setsockopt(src, SOL_SOCKET, SO_SNDBUF, (char *)&size, sizeof(size));
+    ok(!ret, "setsockopt SO_SNDBUF failed: %d\n", WSAGetLastError());
+
+    send_buf = HeapAlloc(GetProcessHeap(), 0, buflen);
+    recv_buf = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, buflen);
+    for (i = 0; i < buflen; i++) send_buf[i] = (i * 13) ^ (i >> 10);
+
+    thread = CreateThread(NULL, 0, echo_socket_thread, &dst, 0, &id);
+    ok(thread != NULL, "CreateThread failed, error %d\n", GetLastError());
+
+    memset(&send_ov, 0, sizeof(send_ov));
+    memset(&recv_ov, 0, sizeof(recv_ov));
+    send_ov.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    recv_ov.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+
+    start = GetTickCount();
+    buf.buf = send_buf;
+    buf.len = buflen;
+    ret = WSASend(src, &buf, 1, &sent, 0, &send_ov, NULL);
+    ok(!ret || WSAGetLastError() == ERROR_IO_PENDING, "WSASend failed %d - %d\n", ret, WSAGetLastError());
+
+    /* read the echo back while the send is still going on */
+    while (received < buflen)
+    {
+        buf.buf = recv_buf + received;
+        buf.len = min(buflen - received, 0x10000);
+        flags = 0;
+        ResetEvent(recv_ov.hEvent);
+        ret = WSARecv(src, &buf, 1, &bytes, &flags, &recv_ov, NULL);
+        if (ret && WSAGetLastError() == ERROR_IO_PENDING)
+        {
+            ret = WaitForSingleObject(recv_ov.hEvent, 10000);
+            ok(ret == WAIT_OBJECT_0, "recv wait failed %d\n", ret);
+            if (ret != WAIT_OBJECT_0) break;
+            ret = !WSAGetOverlappedResult(src, &recv_ov, &bytes, FALSE, &flags);
+        }
+        ok(!ret, "WSARecv failed %d - %d\n", ret, WSAGetLastError());
+        if (ret || !bytes) break;
+        received += bytes;
+    }
+    ok(received == buflen, "received %u bytes, expected %u\n", received, buflen);
+
+    ret = WaitForSingleObject(send_ov.hEvent, 10000);
+    ok(ret == WAIT_OBJECT_0, "send wait failed %d\n", ret);
+    ret = WSAGetOverlappedResult(src, &send_ov, &sent, FALSE, &flags);
+    ok(ret, "WSAGetOverlappedResult failed %d\n", WSAGetLastError());
+    ok(sent == buflen, "sent %u bytes, expected %u\n", sent, buflen);
+    ticks = GetTickCount() - start;
+
+    /* a send that was restarted from the beginning would show up here */
+    ok(!memcmp(send_buf, recv_buf, received), "echoed data differs\n");
+    trace("overlapped echo: %u KB in %u ms\n", received / 1024, ticks);
+
+    shutdown(src, SD_SEND);
+    ret = WaitForSingleObject(thread, 10000);
+    ok(ret == WAIT_OBJECT_0, "echo thread didn't exit\n");
+    CloseHandle(thread);
+    CloseHandle(send_ov.hEvent);
+    CloseHandle(recv_ov.hEvent);
+    closesocket(src);
+    closesocket(dst);
+    HeapFree(GetProcessHeap(), 0, send_buf);
+    HeapFree(GetProcessHeap(), 0, recv_buf);
+}
+
 static void test_events(int useMessages)
 {
     SOCKET server = INVALID_SOCKET;
@@ -7358,6 +7451,7 @@ START_TEST( sock )
 
     /* this is an io heavy test, do it at the end so the kernel doesn't start dropping packets */
     test_send();
+    test_overlapped_echo();
     test_synchronous_WSAIoctl();
 
     Exit();
@@ -53,6 +53,8 @@ enum syscall
 	Nt_WineService,
 	Nt_KillThread,
 	Nt_KillProcess,
+	Nt_WineServiceBatch,
+	Nt_WineServiceWait,
 	Nt_MaxNum
 };
 
@@ -61,6 +63,17 @@ extern void server_kill_thread(LONG exit_code);
 extern void server_kill_process(LONG exit_code);
 #endif
 
+/* wake bits of a thread message queue, in a page mapped read-only in the
+ * process of the thread and updated by the kernel whenever they change; as
+ * long as no bit of interest is set the queue has nothing to return */
+struct __server_queue_slot
+{
+    unsigned int wake_bits;     /* QS_* bits of the pending messages, QS_PAINT included */
+    unsigned int changed_bits;  /* QS_* bits set since they were last cleared */
+    unsigned int __pad;
+    unsigned int seq;           /* bumped each time the slot is reused */
+};
+
 struct __server_iovec
 {
     const void  *ptr;
@@ -81,11 +94,52 @@ struct __server_request_info
     struct __server_iovec data[__SERVER_MAX_DATA];  /* request variable size data */
 };
 
+#define __SERVER_MAX_BATCH 16
+
+/* used by Nt_WineServiceBatch */
+struct __server_request_batch
+{
+    unsigned int                  count;  /* number of requests */
+    unsigned int                  done;   /* number of requests run by the server */
+    struct __server_request_info *reqs[__SERVER_MAX_BATCH];  /* requests, run in order */
+};
+
+#ifdef CONFIG_UNIFIED_KERNEL
+#define SERVER_SYNC_SLOTS  4096        /* number of slots in a process sync page */
+#define SERVER_SYNC_SIZE   (SERVER_SYNC_SLOTS * sizeof(struct __server_sync_slot))
+#define SERVER_SYNC_OFFSET 0x10000000  /* mmap offset of the sync page in SYSCALL_FILE */
+
+#define SERVER_SYNC_AUTO_EVENT    1
+#define SERVER_SYNC_MANUAL_EVENT  2
+#define SERVER_SYNC_SEMAPHORE     3
+
+#define SERVER_SYNC_SIGNALED      0x00000001  /* event state */
+#define SERVER_SYNC_COUNT_MASK    0x7fffffff  /* semaphore count */
+
+/* copy of the state of an event or semaphore in the sync page of a process;
+ * the page is written by the kernel only and mapped read-only, so it can
+ * answer queries that don't change the state but never replaces the server */
+struct __server_sync_slot
+{
+    unsigned int state;   /* SERVER_SYNC_* state bits, or the semaphore count */
+    unsigned int max;     /* maximum semaphore count */
+    unsigned int type;    /* SERVER_SYNC_* object type */
+    unsigned int seq;     /* bumped each time the slot is reused */
+};
+
+#define SERVER_QUEUE_SLOTS  256         /* number of slots in the queue status page of a process */
+#define SERVER_QUEUE_SIZE   (SERVER_QUEUE_SLOTS * sizeof(struct __server_queue_slot))
+#define SERVER_QUEUE_OFFSET 0x20000000  /* mmap offset of the queue status page in SYSCALL_FILE */
+#endif
+
 extern unsigned int wine_server_call( void *req_ptr );
+extern unsigned int wine_server_call_batch( void * const *req_ptrs, unsigned int count, unsigned int *done );
+extern NTSTATUS CDECL wine_server_close_handles( const HANDLE *handles, unsigned int count );
 extern void CDECL wine_server_send_fd( int fd );
 extern int CDECL wine_server_fd_to_handle( int fd, unsigned int access, unsigned int attributes, HANDLE *handle );
 extern int CDECL wine_server_handle_to_fd( HANDLE handle, unsigned int access, int *unix_fd, unsigned int *options );
 extern void CDECL wine_server_release_fd( HANDLE handle, int unix_fd );
+extern const struct __server_queue_slot * CDECL wine_server_map_queue_page(void);
 
 /* do a server call and set the last error code */
 static inline unsigned int wine_server_call_err( void *req_ptr )
@@ -271,6 +271,24 @@ typedef struct
 } async_data_t;
 
 
+typedef struct
+{
+    client_ptr_t    ptr;
+    data_size_t     size;
+    data_size_t     __pad;
+} async_buffer_t;
+
+
+typedef struct
+{
+    apc_param_t     ckey;
+    apc_param_t     cvalue;
+    apc_param_t     information;
+    unsigned int    status;
+    unsigned int    __pad;
+} completion_msg_t;
+
+
 
 struct hardware_msg_data
 {
@@ -1288,11 +1306,7 @@ struct query_semaphore_request
 struct query_semaphore_reply
 {
     struct reply_header __header;
-#ifdef CONFIG_UNIFIED_KERNEL
     unsigned int current_count;
-#else
-    unsigned int current;
-#endif
     unsigned int max;
 };
 
@@ -1398,9 +1412,8 @@ struct get_handle_fd_reply
     int          cacheable;
     unsigned int access;
     unsigned int options;
-#ifdef CONFIG_UNIFIED_KERNEL
     int          fd;
-#endif
+    char __pad_28[4];
 };
 enum server_fd_type
 {
@@ -2359,6 +2372,8 @@ struct write_process_memory_request
 struct write_process_memory_reply
 {
     struct reply_header __header;
+    data_size_t  written;
+    char __pad_12[4];
 };
 
 
@@ -2817,7 +2832,9 @@ struct get_msg_queue_reply
 {
     struct reply_header __header;
     obj_handle_t handle;
-    char __pad_12[4];
+    unsigned int slot;
+    unsigned int slot_seq;
+    char __pad_20[4];
 };
 
 
@@ -3113,6 +3130,7 @@ struct register_async_request
     int          type;
     async_data_t async;
     int          count;
+    /* VARARG(buffers,async_buffers); */
     char __pad_60[4];
 };
 struct register_async_reply
@@ -4914,6 +4932,19 @@ struct remove_completion_reply
 
 
 
+struct remove_completions_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct remove_completions_reply
+{
+    struct reply_header __header;
+    /* VARARG(msgs,completions); */
+};
+
+
+
 struct query_completion_request
 {
     struct request_header __header;
@@ -5088,6 +5119,22 @@ struct set_suspend_context_reply
 };
 
 
+
+struct get_sync_slot_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_sync_slot_reply
+{
+    struct reply_header __header;
+    unsigned int index;
+    unsigned int seq;
+    unsigned int access;
+    char __pad_20[4];
+};
+
+
 enum request
 {
     REQ_new_process,
@@ -5334,6 +5381,7 @@ enum request
     REQ_open_completion,
     REQ_add_completion,
     REQ_remove_completion,
+    REQ_remove_completions,
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
@@ -5345,6 +5393,7 @@ enum request
     REQ_update_rawinput_devices,
     REQ_get_suspend_context,
     REQ_set_suspend_context,
+    REQ_get_sync_slot,
     REQ_NB_REQUESTS
 };
 
@@ -5596,6 +5645,7 @@ union generic_request
     struct open_completion_request open_completion_request;
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
+    struct remove_completions_request remove_completions_request;
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
@@ -5607,6 +5657,7 @@ union generic_request
     struct update_rawinput_devices_request update_rawinput_devices_request;
     struct get_suspend_context_request get_suspend_context_request;
     struct set_suspend_context_request set_suspend_context_request;
+    struct get_sync_slot_request get_sync_slot_request;
 };
 union generic_reply
 {
@@ -5856,6 +5907,7 @@ union generic_reply
     struct open_completion_reply open_completion_reply;
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
+    struct remove_completions_reply remove_completions_reply;
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
@@ -5867,8 +5919,9 @@ union generic_reply
     struct update_rawinput_devices_reply update_rawinput_devices_reply;
     struct get_suspend_context_reply get_suspend_context_reply;
     struct set_suspend_context_reply set_suspend_context_reply;
+    struct get_sync_slot_reply get_sync_slot_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 454
+#define SERVER_PROTOCOL_VERSION 461
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -253,6 +253,44 @@ DECL_HANDLER(remove_completion)
     release_object( completion );
 }
 
+/* get as many completions from completion port as fit in the reply */
+DECL_HANDLER(remove_completions)
+{
+    struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+    data_size_t count = get_reply_max_size() / sizeof(completion_msg_t);
+    completion_msg_t *msgs;
+    struct list *entry;
+    struct comp_msg *msg;
+    data_size_t i;
+
+    if (!completion) return;
+
+    if (!completion->depth) set_error( STATUS_PENDING );
+    else if (!count) set_error( STATUS_BUFFER_TOO_SMALL );
+    else
+    {
+        if (count > completion->depth) count = completion->depth;
+        if ((msgs = set_reply_data_size( count * sizeof(*msgs) )))
+        {
+            for (i = 0; i < count; i++)
+            {
+                entry = list_head( &completion->queue );
+                list_remove( entry );
+                completion->depth--;
+                msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
+                msgs[i].ckey        = msg->ckey;
+                msgs[i].cvalue      = msg->cvalue;
+                msgs[i].information = msg->information;
+                msgs[i].status      = msg->status;
+                msgs[i].__pad       = 0;
+                free( msg );
+            }
+        }
+    }
+
+    release_object( completion );
+}
+
 /* get queue depth for completion port */
 DECL_HANDLER(query_completion)
 {
@@ -414,3 +414,9 @@ DECL_HANDLER(open_keyed_event)
     }
     if (root) release_object( root );
 }
+
+/* get the shared sync slot of an object; only the kernel module has a sync page */
+DECL_HANDLER(get_sync_slot)
+{
+    set_error( STATUS_NOT_SUPPORTED );
+}
@@ -1184,7 +1184,10 @@ DECL_HANDLER(write_process_memory)
     if ((process = get_process_from_handle( req->handle, PROCESS_VM_WRITE )))
     {
         data_size_t len = get_req_data_size();
-        if (len) write_process_memory( process, req->addr, len, get_req_data() );
+        if (len)
+        {
+            if (write_process_memory( process, req->addr, len, get_req_data() )) reply->written = len;
+        }
         else set_error( STATUS_INVALID_PARAMETER );
         release_object( process );
     }
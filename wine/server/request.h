@@ -350,6 +350,7 @@ DECL_HANDLER(create_completion);
 DECL_HANDLER(open_completion);
 DECL_HANDLER(add_completion);
 DECL_HANDLER(remove_completion);
+DECL_HANDLER(remove_completions);
 DECL_HANDLER(query_completion);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
@@ -361,6 +362,7 @@ DECL_HANDLER(set_cursor);
 DECL_HANDLER(update_rawinput_devices);
 DECL_HANDLER(get_suspend_context);
 DECL_HANDLER(set_suspend_context);
+DECL_HANDLER(get_sync_slot);
 
 #ifdef WANT_REQUEST_HANDLERS
 
@@ -611,6 +613,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_open_completion,
     (req_handler)req_add_completion,
     (req_handler)req_remove_completion,
+    (req_handler)req_remove_completions,
     (req_handler)req_query_completion,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
@@ -622,6 +625,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_update_rawinput_devices,
     (req_handler)req_get_suspend_context,
     (req_handler)req_set_suspend_context,
+    (req_handler)req_get_sync_slot,
 };
 
 C_ASSERT( sizeof(affinity_t) == 8 );
@@ -892,7 +896,7 @@ C_ASSERT( FIELD_OFFSET(struct release_semaphore_reply, prev_count) == 8 );
 C_ASSERT( sizeof(struct release_semaphore_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_semaphore_request, handle) == 12 );
 C_ASSERT( sizeof(struct query_semaphore_request) == 16 );
-C_ASSERT( FIELD_OFFSET(struct query_semaphore_reply, current) == 8 );
+C_ASSERT( FIELD_OFFSET(struct query_semaphore_reply, current_count) == 8 );
 C_ASSERT( FIELD_OFFSET(struct query_semaphore_reply, max) == 12 );
 C_ASSERT( sizeof(struct query_semaphore_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct open_semaphore_request, access) == 12 );
@@ -934,7 +938,8 @@ C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, type) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, cacheable) == 12 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, access) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, options) == 20 );
-C_ASSERT( sizeof(struct get_handle_fd_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_handle_fd_reply, fd) == 24 );
+C_ASSERT( sizeof(struct get_handle_fd_reply) == 32 );
 C_ASSERT( FIELD_OFFSET(struct flush_file_request, handle) == 12 );
 C_ASSERT( sizeof(struct flush_file_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct flush_file_reply, event) == 8 );
@@ -1251,6 +1256,8 @@ C_ASSERT( sizeof(struct read_process_memory_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct write_process_memory_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct write_process_memory_request, addr) == 16 );
 C_ASSERT( sizeof(struct write_process_memory_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct write_process_memory_reply, written) == 8 );
+C_ASSERT( sizeof(struct write_process_memory_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_key_request, parent) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_key_request, access) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_key_request, attributes) == 20 );
@@ -1395,7 +1402,9 @@ C_ASSERT( FIELD_OFFSET(struct init_atom_table_reply, table) == 8 );
 C_ASSERT( sizeof(struct init_atom_table_reply) == 16 );
 C_ASSERT( sizeof(struct get_msg_queue_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, handle) == 8 );
-C_ASSERT( sizeof(struct get_msg_queue_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, slot) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, slot_seq) == 16 );
+C_ASSERT( sizeof(struct get_msg_queue_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_fd_request, handle) == 12 );
 C_ASSERT( sizeof(struct set_queue_fd_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_mask_request, wake_mask) == 12 );
@@ -2150,6 +2159,9 @@ C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, cvalue) == 16 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, information) == 24 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, status) == 32 );
 C_ASSERT( sizeof(struct remove_completion_reply) == 40 );
+C_ASSERT( FIELD_OFFSET(struct remove_completions_request, handle) == 12 );
+C_ASSERT( sizeof(struct remove_completions_request) == 16 );
+C_ASSERT( sizeof(struct remove_completions_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_request, handle) == 12 );
 C_ASSERT( sizeof(struct query_completion_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_reply, depth) == 8 );
@@ -2200,6 +2212,12 @@ C_ASSERT( sizeof(struct update_rawinput_devices_request) == 16 );
 C_ASSERT( sizeof(struct get_suspend_context_request) == 16 );
 C_ASSERT( sizeof(struct get_suspend_context_reply) == 8 );
 C_ASSERT( sizeof(struct set_suspend_context_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_sync_slot_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_sync_slot_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_sync_slot_reply, index) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_sync_slot_reply, seq) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_sync_slot_reply, access) == 16 );
+C_ASSERT( sizeof(struct get_sync_slot_reply) == 24 );
 
 #endif  /* WANT_REQUEST_HANDLERS */
 